@@ -4,6 +4,7 @@ import argparse
 import ast
 from multiprocessing import cpu_count, Pool
 import os.path
+import shutil
 import subprocess
 import tempfile
 from typing import List
@@ -15,6 +16,51 @@ class ArgumentError(Exception):
     pass
 
 
+def _render_with_uade_scope(songfile: str, regfile: str, wavefile: str,
+                            videofile: str, args) -> int:
+    # uade-scope writes raw RGB frames that are piped to ffmpeg. The wave
+    # file is written first, because ffmpeg opens it before reading frames.
+    cp = subprocess.run([args.uade_scope, '--no-video', '--wave', wavefile,
+                         regfile])
+    if cp.returncode != 0:
+        print('uade-scope failed for {}'.format(songfile))
+        return 1
+
+    print('Generating video file {} with uade-scope'.format(videofile))
+    scope = subprocess.Popen(
+        [args.uade_scope, '--fps', str(args.fps), regfile],
+        stdout=subprocess.PIPE)
+    cp = subprocess.run([
+        args.ffmpeg,
+        '-f', 'rawvideo',
+        '-pix_fmt', 'rgb24',
+        '-s', '1280x720',
+        '-framerate', str(args.fps),
+        '-i', '-',
+        '-i', wavefile,
+        '-y',
+        '-pix_fmt', 'yuv420p',
+        videofile],
+        stdin=scope.stdout,
+        stdout=subprocess.PIPE,
+        stderr=subprocess.PIPE)
+    scope.stdout.close()
+    scope_returncode = scope.wait()
+
+    if cp.returncode != 0:
+        print('ffmpeg failed. STDOUT:\n\n{}\n\nSTDERR:\n\n{}\n'.format(
+            cp.stdout.decode(), cp.stderr.decode()))
+        print()
+        print('Failed to create video for {}'.format(songfile))
+        return 1
+
+    if scope_returncode != 0:
+        print('uade-scope failed for {}'.format(songfile))
+        return 1
+
+    return 0
+
+
 def _process_songfile(songfile: str,
                       args,
                       uade123_arg_list: List[str],
@@ -35,6 +81,12 @@ def _process_songfile(songfile: str,
 
         wavefile = os.path.join(tmpdir, bname + '.wav')
 
+        videofile = os.path.join(args.target_dir, bname + '.mp4')
+
+        if shutil.which(args.uade_scope) is not None:
+            return _render_with_uade_scope(songfile, regfile, wavefile,
+                                           videofile, args)
+
         print('Generating oscilloscope images from {}'.format(regfile))
         write_audio.main(['--target-dir', tmpdir, '--wave', wavefile,
                           '--fps', str(args.fps)] + write_audio_options_list +
@@ -42,8 +94,6 @@ def _process_songfile(songfile: str,
 
         image_pattern = os.path.join(tmpdir, 'output_%06d.png')
 
-        videofile = os.path.join(args.target_dir, bname + '.mp4')
-
         print('Generating video file {}'.format(videofile))
 
         cp = subprocess.run([
@@ -96,6 +146,10 @@ def main() -> int:
         '--recursive', '-r', action='store_true',
         help='Scan directories recursively')
     parser.add_argument('--uade123', default='uade123', help='Path to uade123')
+    parser.add_argument(
+        '--uade-scope', default='uade-scope',
+        help=('Path to uade-scope. Images are rendered with the slower '
+              'Python implementation if uade-scope is not found.'))
     parser.add_argument(
         '--uade123-args', type=ast.literal_eval, default={},
         help=('Pass given argument to uade123. This is written as a Python '
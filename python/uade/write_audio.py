@@ -2,6 +2,7 @@ import argparse
 from collections import deque
 import os
 import statistics
+import zlib
 from PIL import Image, ImageDraw
 import wave
 from tqdm import tqdm
@@ -30,6 +31,24 @@ PAULA_EVENT_LCL = 6
 PAULA_EVENT_LOOP = 7
 PAULA_EVENT_OUTPUT = 8
 
+HEADER_SIZE = 16
+MAGIC_V1 = b'uade_osc_0\x00\xec\x171\x03\t'
+MAGIC_V2 = b'uade_osc_1\x00\xec\x171\x03\t'
+
+V1_FRAME_SIZE = 12
+
+V2_BLOCK_HEADER_SIZE = 9
+V2_BLOCK_RAW = 0
+V2_BLOCK_ZLIB = 1
+
+V2_RECORD_OUTPUT = 1
+V2_RECORD_PAULA_EVENT = 2
+V2_RECORD_LEFT_RIGHT = 3
+
+# Frame types returned by read_frames()
+FRAME_OUTPUT = 0
+FRAME_PAULA_EVENT = 1
+
 PAULA_EVENTS = {
     PAULA_EVENT_VOL: 'vol',
     PAULA_EVENT_PER: 'per',
@@ -118,12 +137,144 @@ class AudioChannels:
         return min(self.normalisers)
 
 
+def _read_v1_frames(reg_file, progress_bar):
+    while True:
+        # See src/write_audio.c: struct uade_write_audio_frame. It describes
+        # the data format of the frame.
+        frame = reg_file.read(V1_FRAME_SIZE)
+        progress_bar.update(len(frame))
+        if len(frame) == 0:
+            break
+
+        # Read an unsigned 24-bit time delta value
+        tdelta = int.from_bytes(frame[1:4], 'big')
+
+        tdelta_control = frame[0]
+        if tdelta_control == 0:
+            # This frame contains new PCM values for each channel
+            values = []
+            for index in range(4, V1_FRAME_SIZE, 2):
+                v = int.from_bytes(frame[index:(index + 2)], 'big')
+                if v >= 0x8000:
+                    v -= 65536
+                values.append(v)
+            yield (tdelta, FRAME_OUTPUT, values)
+        elif tdelta_control == 0x80:
+            # This frame is a register write or a loop event
+            event = (frame[4], frame[5], int.from_bytes(frame[6:8], 'big'))
+            yield (tdelta, FRAME_PAULA_EVENT, event)
+        else:
+            raise NotImplementedError(
+                'Unsupported control byte: {}. '
+                'This is probably a bug or a format extension.'.format(
+                    tdelta_control))
+
+
+def _read_varint(data: bytes, pos: int):
+    x = 0
+    shift = 0
+    while True:
+        b = data[pos]
+        pos += 1
+        x |= (b & 0x7f) << shift
+        if b < 0x80:
+            return x, pos
+        shift += 7
+
+
+def _read_signed_varint(data: bytes, pos: int):
+    x, pos = _read_varint(data, pos)
+    return (x >> 1) ^ -(x & 1), pos
+
+
+def _read_v2_records(data: bytes, values: List[int]):
+    pos = 0
+    while pos < len(data):
+        record_type = data[pos]
+        pos += 1
+        if record_type == V2_RECORD_OUTPUT:
+            tdelta, pos = _read_varint(data, pos)
+            mask = data[pos]
+            pos += 1
+            for i in range(NUM_AMIGA_CHANNELS):
+                if mask & (1 << i):
+                    diff, pos = _read_signed_varint(data, pos)
+                    values[i] += diff
+            yield (tdelta, FRAME_OUTPUT, list(values))
+        elif record_type == V2_RECORD_PAULA_EVENT:
+            tdelta, pos = _read_varint(data, pos)
+            channel_and_type = data[pos]
+            pos += 1
+            event_value, pos = _read_varint(data, pos)
+            event = (channel_and_type >> 4, channel_and_type & 0xf,
+                     event_value)
+            yield (tdelta, FRAME_PAULA_EVENT, event)
+        elif record_type == V2_RECORD_LEFT_RIGHT:
+            tdelta, pos = _read_varint(data, pos)
+            left, pos = _read_signed_varint(data, pos)
+            right, pos = _read_signed_varint(data, pos)
+            yield (tdelta, FRAME_PAULA_EVENT,
+                   (0, PAULA_EVENT_OUTPUT, left & 0xffff))
+            yield (0, FRAME_PAULA_EVENT,
+                   (1, PAULA_EVENT_OUTPUT, right & 0xffff))
+        else:
+            raise NotImplementedError(
+                'Unsupported record type: {}'.format(record_type))
+
+
+def _read_v2_frames(reg_file, progress_bar):
+    # See src/write_audio.c for the description of the format
+    values = [0] * NUM_AMIGA_CHANNELS
+    while True:
+        header = reg_file.read(V2_BLOCK_HEADER_SIZE)
+        progress_bar.update(len(header))
+        if len(header) == 0:
+            break
+        if len(header) != V2_BLOCK_HEADER_SIZE:
+            raise ValueError('Truncated block header')
+
+        block_type = header[0]
+        records_size = int.from_bytes(header[1:5], 'big')
+        data_size = int.from_bytes(header[5:9], 'big')
+
+        data = reg_file.read(data_size)
+        progress_bar.update(len(data))
+        if len(data) != data_size:
+            raise ValueError('Truncated block')
+
+        if block_type == V2_BLOCK_ZLIB:
+            data = zlib.decompress(data)
+        elif block_type != V2_BLOCK_RAW:
+            raise NotImplementedError(
+                'Unsupported block type: {}'.format(block_type))
+        if len(data) != records_size:
+            raise ValueError('Invalid block size')
+
+        yield from _read_v2_records(data, values)
+
+
+def read_frames(reg_file, progress_bar):
+    """Yields (tdelta, frame_type, data) tuples from a write-audio file.
+
+    Time advances by tdelta before the frame takes effect. For FRAME_OUTPUT
+    data is a list of channel outputs. For FRAME_PAULA_EVENT data is a
+    (channel, event_type, event_value) tuple.
+    """
+    header = reg_file.read(HEADER_SIZE)
+    progress_bar.update(len(header))
+
+    if header == MAGIC_V1:
+        yield from _read_v1_frames(reg_file, progress_bar)
+    elif header == MAGIC_V2:
+        yield from _read_v2_frames(reg_file, progress_bar)
+    else:
+        raise ValueError('Unknown write-audio file header')
+
+
 def _handle_paula_event(audio_channels: AudioChannels, outputs, wave_file,
-                        frame, args):
-    channel_nr = frame[4]
+                        event, args):
+    channel_nr, event_type, event_value = event
     assert channel_nr >= 0 and channel_nr < NUM_AMIGA_CHANNELS
-    event_type = frame[5]
-    event_value = int.from_bytes(frame[6:8], 'big')
     channel = audio_channels.channels[channel_nr]
     if args.verbose:
         event_type_str = PAULA_EVENTS.get(event_type)
@@ -146,15 +297,11 @@ def _handle_paula_event(audio_channels: AudioChannels, outputs, wave_file,
             outputs[1] = None
 
 
-def _handle_paula_channel_output(audio_channels: AudioChannels, frame):
+def _handle_paula_channel_output(audio_channels: AudioChannels,
+                                 values: List[int]):
     # Handle Audio channel output
-    index = 4
-    for channel in audio_channels.channels:
-        v = int.from_bytes(frame[index:(index + 2)], 'big')
-        if v >= 0x8000:
-            v -= 65536
+    for channel, v in zip(audio_channels.channels, values):
         channel.value = v
-        index += 2
 
 
 class FrameImage:
@@ -272,16 +419,8 @@ def main(main_args=None):
         reg_file_size = reg_file.seek(0, 2)
         reg_file.seek(0, 0)
 
-    HEADER_SIZE = 16
-    FRAME_SIZE = 12
-
     progress_bar = tqdm(total=reg_file_size, disable=args.batch)
 
-    header = reg_file.read(HEADER_SIZE)
-    progress_bar.update(len(header))
-
-    assert header == b'uade_osc_0\x00\xec\x171\x03\t'
-
     num_images = 0
 
     wave_file = wave.open(args.wave, 'wb')
@@ -293,20 +432,17 @@ def main(main_args=None):
 
     audio_channels = AudioChannels(args.normalisation_length)
 
-    while True:
-        # See src/write_audio.c: struct uade_write_audio_frame. It describes
-        # the data format of the frame.
-        frame = reg_file.read(FRAME_SIZE)
-        progress_bar.update(len(frame))
-        if len(frame) == 0:
-            break
+    for tdelta, frame_type, data in read_frames(reg_file, progress_bar):
+        # Unchanged outputs are merged in version 2 files. Advance at most
+        # one video frame at a time so that each step renders one image.
+        while tdelta > 0:
+            step = min(tdelta, VIDEO_FRAME_TICKS)
+            tdelta -= step
 
-        # Read an unsigned 24-bit time delta value
-        tdelta_time = frame[1:4]
-        tdelta = int.from_bytes(tdelta_time, 'big')
+            im = _advance_time(audio_channels, step, args)
+            if im is None:
+                continue
 
-        im = _advance_time(audio_channels, tdelta, args)
-        if im is not None:
             if args.manual:
                 print('image frame', num_images)
                 im.show()
@@ -318,19 +454,11 @@ def main(main_args=None):
             im.save(fname, args.image_format)
             num_images += 1
 
-        tdelta_control = frame[0]
-        if tdelta_control == 0:
-            # This frame contains new PCM values for each channel
-            _handle_paula_channel_output(audio_channels, frame)
-        elif tdelta_control == 0x80:
-            # This frame is a register write or a loop event
-            _handle_paula_event(audio_channels, outputs, wave_file, frame,
-                                args)
+        if frame_type == FRAME_OUTPUT:
+            _handle_paula_channel_output(audio_channels, data)
         else:
-            raise NotImplementedError(
-                'Unsupported control byte: {}. '
-                'This is probably a bug or a format extension.'.format(
-                    tdelta_control))
+            _handle_paula_event(audio_channels, outputs, wave_file, data,
+                                args)
 
     wave_file.close()
     reg_file.close()
@@ -9,6 +9,9 @@
   */
 
 #include <math.h>
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
 
 #include "sysconfig.h"
 #include "sysdeps.h"
@@ -29,40 +32,82 @@
 
 #include "text_scope.h"
 #include "write_audio.h"
+#include "paula_trace.h"
+#include "savestate.h"
+#include "uadestats.h"
 
 
-struct audio_channel_data audio_channel[4];
-static void (*sample_handler) (void);
-static void (*sample_prehandler) (unsigned long best_evtime);
+MACHINE_LOCAL struct audio_slice_data audio_slice;
+MACHINE_LOCAL struct audio_channel_data audio_channel[4];
+static MACHINE_LOCAL void (*sample_handler) (void);
+static MACHINE_LOCAL void (*sample_prehandler) (unsigned long best_evtime);
+/* The sinc resampler mixes BLEPs of the filters, so its output is final */
+static MACHINE_LOCAL int sample_handler_filters;
 
 /* Average time in bus cycles to output a new sample */
-static float sample_evtime_interval;
-static float next_sample_evtime;
+static MACHINE_LOCAL float sample_evtime_interval;
+static MACHINE_LOCAL float next_sample_evtime;
+
+MACHINE_LOCAL int sound_available;
+
+static MACHINE_LOCAL int use_text_scope;
+
+static MACHINE_LOCAL int use_stems;
+
+static MACHINE_LOCAL struct uade_write_audio *write_audio_state;
 
-int sound_available;
+static MACHINE_LOCAL int sound_use_filter = FILTER_MODEL_A500;
 
-static int use_text_scope;
+static MACHINE_LOCAL unsigned long last_audio_cycles;
 
-static struct uade_write_audio *write_audio_state;
+static MACHINE_LOCAL int audperhack;
 
-static int sound_use_filter = FILTER_MODEL_A500;
+/* Filter state of up to four channels. Each stage is an array over the
+   channels, so that filter_frames() computes a stage of all channels in
+   one vector operation. */
+static MACHINE_LOCAL struct filter_state {
+    float rc1[4], rc2[4], rc3[4], rc4[4], rc5[4];
+} sound_filter_state, stem_filter_state;
 
-/* denormals are very small floating point numbers that force FPUs into slow
-   mode. All lowpass filters using floats are suspectible to denormals unless
-   a small offset is added to avoid very small floating point numbers. */
-#define DENORMAL_OFFSET (1E-10)
+/* The fir resampler integrates Paula output into bins of FIR_BIN_CYCLES bus
+ * cycles, and computes each output sample from the last FIR_TAPS bins with
+ * a lowpass FIR. The FIR has one phase for each cycle offset inside a bin,
+ * so the output is computed at the exact cycle where it is due. Bins are
+ * appended to a linear buffer, and FIR_TAPS bins of history are moved to
+ * the beginning when it becomes full. */
+#define FIR_BIN_CYCLES 32
+#define FIR_TAPS 128
+#define FIR_BLOCK 1024
+/* Kaiser window parameter. 8 gives about 80 dB stopband attenuation. */
+#define FIR_KAISER_BETA 8.0
 
-static unsigned long last_audio_cycles;
+static MACHINE_LOCAL struct fir_state {
+    float bins[FIR_TAPS + FIR_BLOCK][4];
+    int nbins;              /* Number of complete bins */
+    int bin_cycles;         /* Cycles integrated into acc */
+    int acc[4];
+} fir_state;
 
-static int audperhack;
+/* Coefficients in reverse order, that is, fir_coeffs[p][FIR_TAPS - 1] is
+   for the last complete bin when p cycles of the next bin have passed */
+static MACHINE_LOCAL float fir_coeffs[FIR_BIN_CYCLES][FIR_TAPS];
 
-static struct filter_state {
-    float rc1, rc2, rc3, rc4, rc5;
-} sound_filter_state[2];
+/* Without stems only the left and right mixes of the bins are filtered,
+   which halves the work. Two bins of the mix fill one vector, so the
+   coefficients are repeated for the left and the right channel. The mix is
+   computed from fir_state.bins, and is thus not saved in snapshots. */
+static MACHINE_LOCAL float fir_mix[FIR_TAPS + FIR_BLOCK][2];
+static MACHINE_LOCAL float fir_mix_coeffs[FIR_BIN_CYCLES][2 * FIR_TAPS];
 
-static float a500e_filter1_a0;
-static float a500e_filter2_a0;
-static float filter_a0; /* a500 and a1200 use the same */
+/* BLEP tables of the sinc resampler are generated when they are first
+   needed, for the current length and cutoff */
+static MACHINE_LOCAL int *sinc_tables[SINC_TABLES];
+static MACHINE_LOCAL int sinc_length = SINC_DEFAULT_LENGTH;
+static MACHINE_LOCAL double sinc_cutoff = 21000.0;
+
+static MACHINE_LOCAL float a500e_filter1_a0;
+static MACHINE_LOCAL float a500e_filter2_a0;
+static MACHINE_LOCAL float filter_a0; /* a500 and a1200 use the same */
 
 
 static inline int clamp_sample(int o)
@@ -78,6 +123,48 @@ static inline int clamp_sample(int o)
 }
 
 
+/* Denormals are very small floating point numbers that force FPUs into slow
+ * mode. The filters decay into denormals when the output goes silent, so
+ * they run with denormals flushed to zero. The mode is only set around the
+ * filter loop, because the 68881 emulation in fpp.c uses the host FPU and
+ * must get IEEE results. Other hosts filter with the default mode. */
+#if defined(__SSE__)
+#define FLUSH_DENORMALS_BITS 0x8040 /* MXCSR FTZ | DAZ */
+static inline unsigned long flush_denormals_begin(void)
+{
+    unsigned long csr = _mm_getcsr();
+    _mm_setcsr(csr | FLUSH_DENORMALS_BITS);
+    return csr;
+}
+static inline void flush_denormals_end(unsigned long csr)
+{
+    _mm_setcsr(csr);
+}
+#elif defined(__aarch64__)
+#define FLUSH_DENORMALS_BITS (1 << 24) /* FPCR FZ */
+static inline unsigned long flush_denormals_begin(void)
+{
+    unsigned long fpcr;
+    __asm__ __volatile__ ("mrs %0, fpcr" : "=r" (fpcr));
+    __asm__ __volatile__ ("msr fpcr, %0" : : "r" (fpcr | FLUSH_DENORMALS_BITS));
+    return fpcr;
+}
+static inline void flush_denormals_end(unsigned long fpcr)
+{
+    __asm__ __volatile__ ("msr fpcr, %0" : : "r" (fpcr));
+}
+#else
+static inline unsigned long flush_denormals_begin(void)
+{
+    return 0;
+}
+static inline void flush_denormals_end(unsigned long mode)
+{
+    (void) mode;
+}
+#endif
+
+
 /* Amiga has two separate filtering circuits per channel, a static RC filter
  * on A500 and the LED filter. This code emulates both.
  * 
@@ -92,41 +179,91 @@ static inline int clamp_sample(int o)
  *
  * The current filtering should be accurate to 2 dB with the filter on,
  * and to 1 dB with the filter off.
+ *
+ * filter_frames() filters frames of nch channels in place. nch is a constant
+ * in each caller, so the loops over channels become vector code.
 */
-
-static int filter(int input, struct filter_state *fs)
+static inline void filter_frames(uae_u16 *buf, int frames,
+				 struct filter_state *fs, const int nch)
 {
-    float tmp, normal_output, led_output;
+    const float a1 = a500e_filter1_a0, b1 = 1 - a500e_filter1_a0;
+    const float a2 = a500e_filter2_a0, b2 = 1 - a500e_filter2_a0;
+    const float a = filter_a0, b = 1 - filter_a0;
+    const int led = gui_ledstate;
+    float rc1[4], rc2[4], rc3[4], rc4[4], rc5[4];
+    float out[4];
+    int i, c;
+
+    /* Local copies do not alias buf, so they stay in registers */
+    memcpy(rc1, fs->rc1, sizeof rc1);
+    memcpy(rc2, fs->rc2, sizeof rc2);
+    memcpy(rc3, fs->rc3, sizeof rc3);
+    memcpy(rc4, fs->rc4, sizeof rc4);
+    memcpy(rc5, fs->rc5, sizeof rc5);
 
     switch (sound_use_filter) {
-    case FILTER_MODEL_A500: 
-	fs->rc1 = a500e_filter1_a0 * input + (1 - a500e_filter1_a0) * fs->rc1 + DENORMAL_OFFSET;
-	fs->rc2 = a500e_filter2_a0 * fs->rc1 + (1-a500e_filter2_a0) * fs->rc2;
-	normal_output = fs->rc2;
-
-	fs->rc3 = filter_a0 * normal_output + (1 - filter_a0) * fs->rc3;
-	fs->rc4 = filter_a0 * fs->rc3       + (1 - filter_a0) * fs->rc4;
-	fs->rc5 = filter_a0 * fs->rc4       + (1 - filter_a0) * fs->rc5;
-
-	led_output = fs->rc5;
-        break;
+    case FILTER_MODEL_A500:
+	for (i = 0; i < frames; i++, buf += nch) {
+	    for (c = 0; c < nch; c++) {
+		rc1[c] = a1 * (uae_s16) buf[c] + b1 * rc1[c];
+		rc2[c] = a2 * rc1[c] + b2 * rc2[c];
+		rc3[c] = a * rc2[c] + b * rc3[c];
+		rc4[c] = a * rc3[c] + b * rc4[c];
+		rc5[c] = a * rc4[c] + b * rc5[c];
+		out[c] = led ? rc5[c] : rc2[c];
+		buf[c] = clamp_sample((int) out[c]);
+	    }
+	}
+	break;
 
     case FILTER_MODEL_A1200:
-        normal_output = input;
-
-        fs->rc2 = filter_a0 * normal_output + (1 - filter_a0) * fs->rc2 + DENORMAL_OFFSET;
-        fs->rc3 = filter_a0 * fs->rc2       + (1 - filter_a0) * fs->rc3;
-        fs->rc4 = filter_a0 * fs->rc3       + (1 - filter_a0) * fs->rc4;
-
-        led_output = fs->rc4;
-        break;
+	for (i = 0; i < frames; i++, buf += nch) {
+	    for (c = 0; c < nch; c++) {
+		float normal_output = (uae_s16) buf[c];
+		rc2[c] = a * normal_output + b * rc2[c];
+		rc3[c] = a * rc2[c] + b * rc3[c];
+		rc4[c] = a * rc3[c] + b * rc4[c];
+		out[c] = led ? rc4[c] : normal_output;
+		buf[c] = clamp_sample((int) out[c]);
+	    }
+	}
+	break;
 
     default:
 	fprintf(stderr, "Unknown filter mode\n");
-	exit(1);
+	uadecore_exit(1);
     }
 
-    return clamp_sample(gui_ledstate ? led_output : normal_output);
+    memcpy(fs->rc1, rc1, sizeof rc1);
+    memcpy(fs->rc2, rc2, sizeof rc2);
+    memcpy(fs->rc3, rc3, sizeof rc3);
+    memcpy(fs->rc4, rc4, sizeof rc4);
+    memcpy(fs->rc5, rc5, sizeof rc5);
+}
+
+/* Filters the frames written after the previous call, and gives the
+ * filtered frames to the write_audio records of them. This is called
+ * before the sound buffer is sent or discarded, and before the filter
+ * configuration or the LED changes. */
+void audio_filter_sound_buffer (void)
+{
+    int frames = (sndbufpt - sndbuffilterpt) / 2;
+
+    if (frames > 0 && sound_use_filter && !sample_handler_filters) {
+	uae_u16 *stems = stembuffer + 2 * (sndbuffilterpt - sndbuffer);
+	unsigned long mode = flush_denormals_begin();
+
+	filter_frames(sndbuffilterpt, frames, &sound_filter_state, 2);
+	if (use_stems)
+	    filter_frames(stems, frames, &stem_filter_state, 4);
+
+	flush_denormals_end(mode);
+    }
+    if (frames > 0 && write_audio_state != NULL)
+	uade_write_audio_complete_left_right(write_audio_state,
+					     (const int16_t *) sndbuffilterpt,
+					     frames);
+    sndbuffilterpt = sndbufpt;
 }
 
 
@@ -143,10 +280,16 @@ static void check_sound_buffers (void)
 
     if (uadecore_audio_output) {
 	if (bytes == uadecore_read_size) {
+	    audio_filter_sound_buffer();
+	    if (use_stems)
+		uadecore_send_stems(stembuffer, bytes / 4);
 	    uadecore_check_sound_buffers(uadecore_read_size);
 	    sndbufpt = sndbuffer;
+	    sndbuffilterpt = sndbuffer;
 	}
     } else {
+	/* Skipped frames are filtered to keep the filter state continuous */
+	audio_filter_sound_buffer();
 	uadecore_audio_skip += bytes;
 	/* if sound core doesn't report audio output start in 3 seconds from
 	   the reboot, begin audio output anyway */
@@ -155,27 +298,50 @@ static void check_sound_buffers (void)
 	    uadecore_audio_output = 1;
 	}
 	sndbufpt = sndbuffer;
+	sndbuffilterpt = sndbuffer;
     }
 }
 
+static void trace_output(void)
+{
+    paula_trace_output(audio_slice.output);
+}
+
 static inline void write_left_right(int left, int right)
 {
-    if (write_audio_state != NULL)
-	    uade_write_audio_write_left_right(write_audio_state, left, right);
+    if (paula_trace_flags && uadecore_audio_output && !uadecore_reboot)
+	trace_output();
 
     *(sndbufpt++) = left;
     *(sndbufpt++) = right;
 
+    /* The filtered samples are written by audio_filter_sound_buffer() */
+    if (write_audio_state != NULL)
+	uade_write_audio_defer_left_right(write_audio_state);
+
     check_sound_buffers();
 }
 
+/* Stores the outputs of the frame that write_left_right() writes next.
+   Outputs are scaled like the mixed output in sample_backend(), and
+   audio_filter_sound_buffer() filters them like the mixed output, so
+   left = stem 0 + stem 3 and right = stem 1 + stem 2 before clamping. */
+static void write_stems(const int output[4])
+{
+    uae_u16 *stems = stembuffer + 2 * (sndbufpt - sndbuffer);
+    int i;
+
+    for (i = 0; i < 4; i++)
+	stems[i] = output[i] << (16 - 14 - 1);
+}
+
 static inline void sample_backend(int left, int right)
 {
 #if AUDIO_DEBUG
     int nr;
     for (nr = 0; nr < 4; nr++) {
 	struct audio_channel_data *cdp = audio_channel + nr;
-	if (cdp->state != 0 && cdp->datpt != 0 && (dmacon & (1 << nr)) && cdp->datpt >= cdp->datptend) {
+	if (audio_slice.state[nr] != 0 && cdp->datpt != 0 && (dmacon & (1 << nr)) && cdp->datpt >= cdp->datptend) {
 	    fprintf(stderr, "Audio output overrun on channel %d: %.8x/%.8x\n", nr, cdp->datpt, cdp->datptend);
 	}
     }
@@ -184,12 +350,7 @@ static inline void sample_backend(int left, int right)
     /* samples are in range -16384 (-128*64*2) and 16256 (127*64*2) */
     left <<= 16 - 14 - 1;
     right <<= 16 - 14 - 1;
-    /* [-32768, 32512] */
-
-    if (sound_use_filter) {
-	left = filter(left, &sound_filter_state[0]);
-	right = filter(right, &sound_filter_state[1]);
-    }
+    /* [-32768, 32512], filtered later by audio_filter_sound_buffer() */
 
     write_left_right(left, right);
 }
@@ -197,13 +358,10 @@ static inline void sample_backend(int left, int right)
 
 static void sample16s_handler (void)
 {
-    int output[4];
-    int i;
+    const int *output = audio_slice.output;
 
-    for (i = 0; i < 4; i++) {
-	output[i] = audio_channel[i].current_sample * audio_channel[i].vol;
-	output[i] &= audio_channel[i].adk_mask;
-    }
+    if (use_stems)
+	write_stems(output);
 
     sample_backend(output[0] + output[3], output[1] + output[2]);
 }
@@ -225,9 +383,35 @@ static void sample16si_anti_handler (void)
 	audio_channel[i].sample_accum_time = 0;
     }
 
+    if (use_stems)
+	write_stems(output);
+
     sample_backend(output[0] + output[3], output[1] + output[2]);
 }
 
+static void free_sinc_tables(void)
+{
+    int i;
+
+    for (i = 0; i < SINC_TABLES; i++) {
+	free(sinc_tables[i]);
+	sinc_tables[i] = NULL;
+    }
+}
+
+static const int *get_sinc_table(enum sinc_table type)
+{
+    if (sinc_tables[type] == NULL) {
+	int *table = malloc(sinc_length * sizeof table[0]);
+	if (table == NULL || sinctable_generate(table, type, sinc_length, sinc_cutoff)) {
+	    fprintf(stderr, "uadecore: Can not generate sinc table\n");
+	    uadecore_exit(1);
+	}
+	sinc_tables[type] = table;
+    }
+    return sinc_tables[type];
+}
+
 /* this interpolator performs BLEP mixing (bleps are shaped like integrated sinc
  * functions) with a type of BLEP that matches the filtering configuration. */
 static void sample16si_sinc_handler (void)
@@ -237,13 +421,13 @@ static void sample16si_sinc_handler (void)
     int output[4];
 
     if (sound_use_filter) {
-	n = (sound_use_filter == FILTER_MODEL_A500) ? 0 : 2;
+	n = (sound_use_filter == FILTER_MODEL_A500) ? SINC_A500_OFF : SINC_A1200_OFF;
         if (gui_ledstate)
             n += 1;
     } else {
-	n = 4;
+	n = SINC_VANILLA;
     }
-    winsinc = winsinc_integral[n];
+    winsinc = get_sinc_table(n);
     
     for (i = 0; i < 4; i += 1) {
         int j;
@@ -254,7 +438,7 @@ static void sample16si_sinc_handler (void)
         int offsetpos = acd->sinc_queue_head & (SINC_QUEUE_LENGTH - 1);
         for (j = 0; j < SINC_QUEUE_LENGTH; j += 1) {
             int age = acd->sinc_queue_time - acd->sinc_queue[offsetpos].time;
-            if (age >= SINC_QUEUE_MAX_AGE)
+            if (age >= sinc_length)
                 break;
             sum -= winsinc[age] * acd->sinc_queue[offsetpos].output;
             offsetpos = (offsetpos + 1) & (SINC_QUEUE_LENGTH - 1);
@@ -262,6 +446,12 @@ static void sample16si_sinc_handler (void)
         output[i] = sum >> 16;
     }
 
+    if (use_stems) {
+	uae_u16 *stems = stembuffer + 2 * (sndbufpt - sndbuffer);
+	for (i = 0; i < 4; i++)
+	    stems[i] = clamp_sample(output[i]);
+    }
+
     const int left = clamp_sample(output[0] + output[3]);
     const int right = clamp_sample(output[1] + output[2]);
 
@@ -269,6 +459,70 @@ static void sample16si_sinc_handler (void)
 }
 
 
+/* This resampler lowpass filters the output of Paula with a polyphase FIR
+ * from bins that fir_prehandler() integrates. See fir_state. */
+static void sample16si_fir_handler (void)
+{
+    const struct fir_state *fs = &fir_state;
+    float sum0[4] = {0, 0, 0, 0};
+    float sum1[4] = {0, 0, 0, 0};
+    float sum2[4] = {0, 0, 0, 0};
+    float sum3[4] = {0, 0, 0, 0};
+    int output[4];
+    int i, j;
+    int left, right;
+
+    /* Each inner loop is one vector multiply and add. Four partial sums
+       hide the latency of the adds. */
+    if (use_stems) {
+	const float *c = fir_coeffs[fs->bin_cycles];
+	const float (*x)[4] = &fs->bins[fs->nbins - FIR_TAPS];
+
+	for (i = 0; i < FIR_TAPS; i += 4) {
+	    for (j = 0; j < 4; j++)
+		sum0[j] += c[i] * x[i][j];
+	    for (j = 0; j < 4; j++)
+		sum1[j] += c[i + 1] * x[i + 1][j];
+	    for (j = 0; j < 4; j++)
+		sum2[j] += c[i + 2] * x[i + 2][j];
+	    for (j = 0; j < 4; j++)
+		sum3[j] += c[i + 3] * x[i + 3][j];
+	}
+	for (j = 0; j < 4; j++)
+	    output[j] = lrintf((sum0[j] + sum1[j]) + (sum2[j] + sum3[j]));
+	write_stems(output);
+
+	left = output[0] + output[3];
+	right = output[1] + output[2];
+    } else {
+	/* Two bins of the left and right mix per vector */
+	const float *c = fir_mix_coeffs[fs->bin_cycles];
+	const float *x = fir_mix[fs->nbins - FIR_TAPS];
+
+	for (i = 0; i < 2 * FIR_TAPS; i += 16) {
+	    for (j = 0; j < 4; j++)
+		sum0[j] += c[i + j] * x[i + j];
+	    for (j = 0; j < 4; j++)
+		sum1[j] += c[i + 4 + j] * x[i + 4 + j];
+	    for (j = 0; j < 4; j++)
+		sum2[j] += c[i + 8 + j] * x[i + 8 + j];
+	    for (j = 0; j < 4; j++)
+		sum3[j] += c[i + 12 + j] * x[i + 12 + j];
+	}
+	for (j = 0; j < 4; j++)
+	    sum0[j] = (sum0[j] + sum1[j]) + (sum2[j] + sum3[j]);
+	left = lrintf(sum0[0] + sum0[2]);
+	right = lrintf(sum0[1] + sum0[3]);
+    }
+
+    /* The FIR rings, so the mixed output can exceed Paula's range */
+    left = left > 16383 ? 16383 : (left < -16384 ? -16384 : left);
+    right = right > 16383 ? 16383 : (right < -16384 ? -16384 : right);
+
+    sample_backend(left, right);
+}
+
+
 static void anti_prehandler(unsigned long best_evtime)
 {
     int i;
@@ -276,24 +530,46 @@ static void anti_prehandler(unsigned long best_evtime)
     /* Handle accumulator antialiasiation */
     for (i = 0; i < 4; i++) {
 	struct audio_channel_data *acd = &audio_channel[i];
-	const int output = (acd->current_sample * acd->vol) & acd->adk_mask;
-	acd->sample_accum += output * best_evtime;
+	acd->sample_accum += audio_slice.output[i] * best_evtime;
 	acd->sample_accum_time += best_evtime;
     }
 }
 
-static void uade_write_audio_handler(unsigned long best_evtime)
+static void fir_prehandler(unsigned long best_evtime)
 {
+    struct fir_state *fs = &fir_state;
     int i;
-    int output[4];
 
-    /* Handle accumulator antialiasiation */
-    for (i = 0; i < 4; i++) {
-	struct audio_channel_data *acd = &audio_channel[i];
-	output[i] = (acd->current_sample * acd->vol) & acd->adk_mask;
+    while (best_evtime > 0) {
+	int n = FIR_BIN_CYCLES - fs->bin_cycles;
+	if (n > best_evtime)
+	    n = best_evtime;
+
+	for (i = 0; i < 4; i++)
+	    fs->acc[i] += audio_slice.output[i] * n;
+	fs->bin_cycles += n;
+	best_evtime -= n;
+
+	if (fs->bin_cycles == FIR_BIN_CYCLES) {
+	    if (fs->nbins == FIR_TAPS + FIR_BLOCK) {
+		memmove(fs->bins, &fs->bins[FIR_BLOCK], FIR_TAPS * sizeof fs->bins[0]);
+		memmove(fir_mix, &fir_mix[FIR_BLOCK], FIR_TAPS * sizeof fir_mix[0]);
+		fs->nbins = FIR_TAPS;
+	    }
+	    for (i = 0; i < 4; i++)
+		fs->bins[fs->nbins][i] = fs->acc[i];
+	    fir_mix[fs->nbins][0] = fs->acc[0] + fs->acc[3];
+	    fir_mix[fs->nbins][1] = fs->acc[1] + fs->acc[2];
+	    memset(fs->acc, 0, sizeof fs->acc);
+	    fs->nbins++;
+	    fs->bin_cycles = 0;
+	}
     }
+}
 
-    uade_write_audio_write(write_audio_state, output, best_evtime);
+static void uade_write_audio_handler(unsigned long best_evtime)
+{
+    uade_write_audio_write(write_audio_state, audio_slice.output, best_evtime);
 }
 
 static void sinc_prehandler(unsigned long best_evtime)
@@ -302,7 +578,7 @@ static void sinc_prehandler(unsigned long best_evtime)
 
     for (i = 0; i < 4; i++) {
 	struct audio_channel_data *acd = &audio_channel[i];
-	const int output = (acd->current_sample * acd->vol) & acd->adk_mask;
+	const int output = audio_slice.output[i];
 
         /* if output state changes, record the state change and also
          * write data into sinc queue for mixing in the BLEP */
@@ -324,23 +600,30 @@ static void audio_handler (int nr)
 {
     struct audio_channel_data *cdp = audio_channel + nr;
 
-    switch (cdp->state) {
+    uadecore_stats.audio_handler_calls++;
+
+    switch (audio_slice.state[nr]) {
      case 0:
 	fprintf(stderr, "Bug in sound code\n");
 	break;
 
      case 1:
 	/* We come here at the first hsync after DMA was turned on. */
-	cdp->evtime = maxhpos;
+	audio_slice.evtime[nr] = maxhpos;
 
-	cdp->state = 5;
+	audio_slice.state[nr] = 5;
 	INTREQ(0x8000 | (0x80 << nr));
 	if (cdp->wlen != 1)
 	    cdp->wlen = (cdp->wlen - 1) & 0xFFFF;
 	cdp->nextdat = chipmem_bank.wget(cdp->pt);
 
-	if (write_audio_state != NULL && cdp->pt == cdp->lc)
-	    uade_write_audio_set_state(write_audio_state, nr, PET_LOOP, 0);
+	if (cdp->pt == cdp->lc) {
+	    uadecore_stats.paula_events++;
+	    if (write_audio_state != NULL)
+		uade_write_audio_set_state(write_audio_state, nr, PET_LOOP, 0);
+	    if (paula_trace_flags)
+		paula_trace_event(nr, PET_LOOP, 0);
+	}
 
 	cdp->nextdatpt = cdp->pt;
 	cdp->nextdatptend = cdp->ptend;
@@ -352,15 +635,16 @@ static void audio_handler (int nr)
 
      case 5:
 	/* We come here at the second hsync after DMA was turned on. */
-	cdp->evtime = cdp->per;
+	audio_slice.evtime[nr] = cdp->per;
 	cdp->dat = cdp->nextdat;
 
 	cdp->datpt = cdp->nextdatpt;
 	cdp->datptend = cdp->nextdatptend;
 
-	cdp->current_sample = (uae_s8) (cdp->dat >> 8);
+	audio_slice.current_sample[nr] = (uae_s8) (cdp->dat >> 8);
+	audio_slice.output_dirty = 1;
 
-	cdp->state = 2;
+	audio_slice.state[nr] = 2;
 	{
 	    int audav = adkcon & (1 << nr);
 	    int audap = adkcon & (16 << nr);
@@ -372,10 +656,11 @@ static void audio_handler (int nr)
 
      case 2:
 	/* We come here when a 2->3 transition occurs */
-	cdp->current_sample = (uae_s8)(cdp->dat & 0xFF);
-	cdp->evtime = cdp->per;
+	audio_slice.current_sample[nr] = (uae_s8)(cdp->dat & 0xFF);
+	audio_slice.output_dirty = 1;
+	audio_slice.evtime[nr] = cdp->per;
 
-	cdp->state = 3;
+	audio_slice.state[nr] = 3;
 
 	/* Period attachment? */
 	if (adkcon & (0x10 << nr)) {
@@ -402,17 +687,18 @@ static void audio_handler (int nr)
 
      case 3:
 	/* We come here when a 3->2 transition occurs */
-	cdp->evtime = cdp->per;
+	audio_slice.evtime[nr] = cdp->per;
 
 	if ((INTREQR() & (0x80 << nr)) && !cdp->dmaen) {
-	    cdp->state = 0;
-	    cdp->current_sample = 0;
+	    audio_slice.state[nr] = 0;
+	    audio_slice.current_sample[nr] = 0;
+	    audio_slice.output_dirty = 1;
 	    break;
 	} else {
 	    int audav = adkcon & (1 << nr);
 	    int audap = adkcon & (16 << nr);
 	    int napnav = (!audav && !audap) || audav;
-	    cdp->state = 2;
+	    audio_slice.state[nr] = 2;
 
 	    if ((cdp->intreq2 && cdp->dmaen && napnav)
 		|| (napnav && !cdp->dmaen)) {
@@ -425,7 +711,8 @@ static void audio_handler (int nr)
 	    cdp->datpt = cdp->nextdatpt;
 	    cdp->datptend = cdp->nextdatptend;
 
-	    cdp->current_sample = (uae_s8) (cdp->dat >> 8);
+	    audio_slice.current_sample[nr] = (uae_s8) (cdp->dat >> 8);
+	    audio_slice.output_dirty = 1;
 
 	    if (cdp->dmaen && napnav)
 		cdp->data_written = 2;
@@ -433,21 +720,46 @@ static void audio_handler (int nr)
 	    /* Volume attachment? */
 	    if (audav) {
 		if (nr < 3) {
-		    (cdp+1)->vol = cdp->dat;
+		    audio_slice.vol[nr + 1] = cdp->dat;
 		}
 	    }
 	}
 	break;
 
      default:
-	cdp->state = 0;
+	audio_slice.state[nr] = 0;
 	break;
     }
 }
 
 
+void audio_savestate (struct savestate *ss)
+{
+    /* Snapshots are taken when the sound buffer is empty. Pending frames
+       are filtered with the state that they belong to before restoring. */
+    if (ss->mode == SAVESTATE_RESTORE)
+	flush_sound ();
+
+    savestate_var (ss, audio_slice);
+    savestate_var (ss, audio_channel);
+    savestate_var (ss, sound_filter_state);
+    savestate_var (ss, stem_filter_state);
+    savestate_var (ss, fir_state);
+    savestate_var (ss, last_audio_cycles);
+    savestate_var (ss, next_sample_evtime);
+
+    if (ss->mode == SAVESTATE_RESTORE) {
+	int i;
+	for (i = 0; i < FIR_TAPS + FIR_BLOCK; i++) {
+	    fir_mix[i][0] = fir_state.bins[i][0] + fir_state.bins[i][3];
+	    fir_mix[i][1] = fir_state.bins[i][1] + fir_state.bins[i][2];
+	}
+    }
+}
+
 void audio_reset (void)
 {
+    memset (&audio_slice, 0, sizeof audio_slice);
     memset (audio_channel, 0, sizeof audio_channel);
     audio_channel[0].per = 65535;
     audio_channel[1].per = 65535;
@@ -459,11 +771,28 @@ void audio_reset (void)
 
     audperhack = 0;
 
-    memset(sound_filter_state, 0, sizeof sound_filter_state);
+    memset(&sound_filter_state, 0, sizeof sound_filter_state);
+    memset(&stem_filter_state, 0, sizeof stem_filter_state);
+
+    /* The FIR starts with silence as history */
+    memset(&fir_state, 0, sizeof fir_state);
+    memset(fir_mix, 0, sizeof fir_mix);
+    fir_state.nbins = FIR_TAPS;
 
     audio_set_resampler(NULL);
 
     use_text_scope = 0;
+    use_stems = 0;
+
+    paula_trace_set(0, 1);
+}
+
+void audio_cleanup (void)
+{
+    free_sinc_tables();
+    audio_filter_sound_buffer();
+    uade_write_audio_close(write_audio_state);
+    write_audio_state = NULL;
 }
 
 void audio_set_write_audio_fname(const char *fname)
@@ -494,11 +823,13 @@ static float rc_calculate_a0(int sample_rate, int cutoff_freq)
 
 void audio_set_filter(int filter_type, int filter_force)
 {
+  audio_filter_sound_buffer();
+
   /* If filter_type is zero, filtering is disabled, but if it's
      non-zero, it contains the filter type (a500 or a1200) */
   if (filter_type < 0 || filter_type >= FILTER_MODEL_UPPER_BOUND) {
     fprintf(stderr, "Invalid filter number: %d\n", filter_type);
-    exit(1);
+    uadecore_exit(1);
   }
   sound_use_filter = filter_type;
 
@@ -512,8 +843,72 @@ void audio_set_filter(int filter_type, int filter_force)
 }
 
 
+/* Modified Bessel function of the first kind, order 0 */
+static double bessel_i0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    int k;
+
+    for (k = 1; k < 50; k++) {
+	term *= (x / (2 * k)) * (x / (2 * k));
+	sum += term;
+	if (term < sum * 1E-12)
+	    break;
+    }
+    return sum;
+}
+
+/* Computes fir_coeffs[][] for the given output rate. The prototype filter is
+ * a Kaiser windowed sinc that is FIR_TAPS * FIR_BIN_CYCLES bus cycles long.
+ * The cutoff is set so that the transition band ends below the Nyquist
+ * frequency. Each phase is normalized to unity DC gain. */
+static void fir_calculate_coeffs(int rate)
+{
+    const double length = FIR_TAPS * FIR_BIN_CYCLES;
+    double cutoff = 0.45 * rate;
+    double fc;
+    int p, k;
+
+    if (cutoff > 20000)
+	cutoff = 20000;
+    /* Cutoff in cycles per bus cycle */
+    fc = cutoff / SOUNDTICKS;
+
+    for (p = 0; p < FIR_BIN_CYCLES; p++) {
+	double c[FIR_TAPS];
+	double sum = 0;
+
+	for (k = 0; k < FIR_TAPS; k++) {
+	    /* Distance of the output from the center of the bin in cycles */
+	    double t = (k + 0.5) * FIR_BIN_CYCLES + p;
+	    double x = t - length / 2;
+	    double u = 2 * t / length - 1;
+	    double w = 0;
+	    double sinc = 2 * fc;
+	    if (x != 0)
+		sinc = sin(2 * M_PI * fc * x) / (M_PI * x);
+	    if (u > -1 && u < 1)
+		w = bessel_i0(FIR_KAISER_BETA * sqrt(1 - u * u)) / bessel_i0(FIR_KAISER_BETA);
+	    c[k] = sinc * w;
+	    sum += c[k];
+	}
+
+	/* A bin is a sum of FIR_BIN_CYCLES outputs */
+	for (k = 0; k < FIR_TAPS; k++)
+	    fir_coeffs[p][FIR_TAPS - 1 - k] = c[k] / (sum * FIR_BIN_CYCLES);
+	for (k = 0; k < FIR_TAPS; k++) {
+	    fir_mix_coeffs[p][2 * k] = fir_coeffs[p][k];
+	    fir_mix_coeffs[p][2 * k + 1] = fir_coeffs[p][k];
+	}
+    }
+}
+
+
 void audio_set_rate(int rate)
 {
+    double cutoff;
+
     sample_evtime_interval = ((float) SOUNDTICKS) / rate;
 
     /* Although these numbers are in Hz, these values should not be taken to
@@ -525,20 +920,51 @@ void audio_set_rate(int rate)
     a500e_filter1_a0 = rc_calculate_a0(rate, 6200);
     a500e_filter2_a0 = rc_calculate_a0(rate, 20000);
     filter_a0 = rc_calculate_a0(rate, 7000);
+
+    fir_calculate_coeffs(rate);
+
+    /* The BLEPs have a 21 kHz cutoff for 44.1 kHz and up. Frequencies above
+       22 kHz alias over 20 kHz, and are thus inaudible. Lower rates scale
+       the cutoff down. */
+    cutoff = rate >= 44100 ? 21000.0 : 21000.0 * rate / 44100;
+    if (cutoff != sinc_cutoff) {
+	free_sinc_tables();
+	sinc_cutoff = cutoff;
+    }
 }
 
 
 void audio_set_resampler(char *name)
 {
+    audio_filter_sound_buffer();
+    sample_handler_filters = 0;
     sample_handler = sample16si_anti_handler;
     sample_prehandler = anti_prehandler;
 
     if (name == NULL || strcasecmp(name, "default") == 0)
 	return;
 
-    if (strcasecmp(name, "sinc") == 0) {
+    if (strncasecmp(name, "sinc", 4) == 0 && (name[4] == 0 || name[4] == ':')) {
+	/* "sinc:length" sets the BLEP length in bus cycles */
+	int length = SINC_DEFAULT_LENGTH;
+	if (name[4] == ':') {
+	    length = atoi(&name[5]);
+	    if (length < SINC_MIN_LENGTH || length > SINC_MAX_LENGTH || (length & (length - 1))) {
+		fprintf(stderr, "\nInvalid sinc length: %s. Use a power of two from %d to %d.\n",
+			&name[5], SINC_MIN_LENGTH, SINC_MAX_LENGTH);
+		length = SINC_DEFAULT_LENGTH;
+	    }
+	}
+	if (length != sinc_length) {
+	    free_sinc_tables();
+	    sinc_length = length;
+	}
 	sample_handler = sample16si_sinc_handler;
 	sample_prehandler = sinc_prehandler;
+	sample_handler_filters = 1;
+    } else if (strcasecmp(name, "fir") == 0) {
+	sample_handler = sample16si_fir_handler;
+	sample_prehandler = fir_prehandler;
     } else if (strcasecmp(name, "none") == 0) {
 	sample_handler = sample16s_handler;
 	sample_prehandler = NULL;
@@ -554,10 +980,16 @@ void audio_use_text_scope(void)
 }
 
 
-/* update_audio() emulates actions of audio state machine since it was last
+void audio_use_stems(void)
+{
+    use_stems = 1;
+}
+
+
+/* run_audio() emulates actions of audio state machine since it was last
    time called. One can assume it is called at least once per horizontal
    line and possibly more often. */
-void update_audio (void)
+static void run_audio (void)
 {
     /* Number of cycles that has passed since last call to update_audio() */
     unsigned long n_cycles = cycles - last_audio_cycles;
@@ -568,11 +1000,16 @@ void update_audio (void)
 	unsigned long rounded;
 	float f;
 
+	if (audio_slice.output_dirty) {
+	    for (i = 0; i < 4; i++)
+		audio_slice.output[i] = (audio_slice.current_sample[i] * audio_slice.vol[i]) & audio_slice.adk_mask[i];
+	    audio_slice.output_dirty = 0;
+	}
+
 	for (i = 0; i < 4; i++) {
-	    if (audio_channel[i].state != 0 && (
-		    best_evtime > audio_channel[i].evtime)) {
-		best_evtime = audio_channel[i].evtime;
-	    }
+	    unsigned long evtime = audio_slice.state[i] != 0 ? audio_slice.evtime[i] : best_evtime;
+	    if (best_evtime > evtime)
+		best_evtime = evtime;
 	}
 
 	/* next_sample_evtime >= 0 so floor() behaves as expected */
@@ -600,7 +1037,7 @@ void update_audio (void)
 	}
 
 	for (i = 0; i < 4; i++)
-	    audio_channel[i].evtime -= best_evtime;
+	    audio_slice.evtime[i] -= best_evtime;
 
 	n_cycles -= best_evtime;
 
@@ -614,7 +1051,7 @@ void update_audio (void)
 
 	/* Call audio state machines if needed */
 	for (i = 0; i < 4; i++) {
-	    if (audio_channel[i].evtime == 0 && audio_channel[i].state != 0)
+	    if (audio_slice.evtime[i] == 0 && audio_slice.state[i] != 0)
 		audio_handler(i);
 	}
     }
@@ -623,6 +1060,29 @@ void update_audio (void)
 }
 
 
+/* Reading the clock on every call would cost more than the emulation, so
+   only every STATS_AUDIO_INTERVAL'th call is timed for uadecore_stats. IPC
+   that happens inside the sample handler is not audio time. */
+#define STATS_AUDIO_INTERVAL 64
+
+void update_audio (void)
+{
+    static MACHINE_LOCAL unsigned int calls;
+    uint64_t t, ipc_ns;
+
+    if ((++calls % STATS_AUDIO_INTERVAL) != 0) {
+	run_audio ();
+	return;
+    }
+
+    ipc_ns = uadecore_stats.ipc_ns;
+    t = uadecore_stats_ns ();
+    run_audio ();
+    t = uadecore_stats_ns () - t - (uadecore_stats.ipc_ns - ipc_ns);
+    uadecore_stats.audio_ns += STATS_AUDIO_INTERVAL * t;
+}
+
+
 void AUDxDAT (int nr, uae_u16 v)
 {
     struct audio_channel_data *cdp = audio_channel + nr;
@@ -632,16 +1092,20 @@ void AUDxDAT (int nr, uae_u16 v)
     if (write_audio_state != NULL)
 	uade_write_audio_set_state(write_audio_state, nr, PET_DAT, v);
 
+    uadecore_stats.paula_events++;
     update_audio ();
 
+    if (paula_trace_flags)
+	paula_trace_event(nr, PET_DAT, v);
+
     cdp->dat = v;
     cdp->datpt = 0;
 
-    if (cdp->state == 0 && !(INTREQR() & (0x80 << nr))) {
-	cdp->state = 2;
+    if (audio_slice.state[nr] == 0 && !(INTREQR() & (0x80 << nr))) {
+	audio_slice.state[nr] = 2;
 	INTREQ(0x8000 | (0x80 << nr));
 	/* data_written = 2 ???? */
-	cdp->evtime = cdp->per;
+	audio_slice.evtime[nr] = cdp->per;
     }
 }
 
@@ -653,8 +1117,12 @@ void AUDxLCH (int nr, uae_u16 v)
     if (write_audio_state != NULL)
 	uade_write_audio_set_state(write_audio_state, nr, PET_LCH, v);
 
+    uadecore_stats.paula_events++;
     update_audio ();
 
+    if (paula_trace_flags)
+	paula_trace_event(nr, PET_LCH, v);
+
     audio_channel[nr].lc = (audio_channel[nr].lc & 0xffff) | ((uae_u32)v << 16);
 }
 
@@ -666,8 +1134,12 @@ void AUDxLCL (int nr, uae_u16 v)
     if (write_audio_state != NULL)
 	uade_write_audio_set_state(write_audio_state, nr, PET_LCL, v);
 
+    uadecore_stats.paula_events++;
     update_audio ();
 
+    if (paula_trace_flags)
+	paula_trace_event(nr, PET_LCL, v);
+
     audio_channel[nr].lc = (audio_channel[nr].lc & ~0xffff) | (v & 0xFFFE);
 }
 
@@ -679,8 +1151,12 @@ void AUDxPER (int nr, uae_u16 v)
     if (write_audio_state != NULL)
 	uade_write_audio_set_state(write_audio_state, nr, PET_PER, v);
 
+    uadecore_stats.paula_events++;
     update_audio ();
 
+    if (paula_trace_flags)
+	paula_trace_event(nr, PET_PER, v);
+
     if (v == 0)
 	v = 65535;
     else if (v < 16) {
@@ -705,8 +1181,12 @@ void AUDxLEN (int nr, uae_u16 v)
     if (write_audio_state != NULL)
 	uade_write_audio_set_state(write_audio_state, nr, PET_LEN, v);
 
+    uadecore_stats.paula_events++;
     update_audio ();
 
+    if (paula_trace_flags)
+	paula_trace_event(nr, PET_LEN, v);
+
     audio_channel[nr].len = v;
 }
 
@@ -720,7 +1200,12 @@ void AUDxVOL (int nr, uae_u16 v)
     if (write_audio_state != NULL)
 	uade_write_audio_set_state(write_audio_state, nr, PET_VOL, v);
 
+    uadecore_stats.paula_events++;
     update_audio ();
 
-    audio_channel[nr].vol = v2;
+    if (paula_trace_flags)
+	paula_trace_event(nr, PET_VOL, v);
+
+    audio_slice.vol[nr] = v2;
+    audio_slice.output_dirty = 1;
 }
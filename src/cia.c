@@ -16,6 +16,8 @@
 #include "memory.h"
 #include "custom.h"
 #include "cia.h"
+#include "savestate.h"
+#include "audio.h"
 
 #include "uadectl.h"
 
@@ -35,30 +37,30 @@
 #define RTC_F_STOP     2
 #define RTC_F_RSET     1
 
-static unsigned int clock_control_d = RTC_D_ADJ + RTC_D_HOLD;
-static unsigned int clock_control_e = 0;
-static unsigned int clock_control_f = RTC_F_24_12;
+static MACHINE_LOCAL unsigned int clock_control_d = RTC_D_ADJ + RTC_D_HOLD;
+static MACHINE_LOCAL unsigned int clock_control_e = 0;
+static MACHINE_LOCAL unsigned int clock_control_f = RTC_F_24_12;
 
-unsigned int ciaaicr,ciaaimask,ciabicr,ciabimask;
-unsigned int ciaacra,ciaacrb,ciabcra,ciabcrb;
-unsigned long ciaata,ciaatb,ciabta,ciabtb;
-unsigned long ciaatod,ciabtod,ciaatol,ciabtol,ciaaalarm,ciabalarm;
-int ciaatlatch,ciabtlatch;
+MACHINE_LOCAL unsigned int ciaaicr,ciaaimask,ciabicr,ciabimask;
+MACHINE_LOCAL unsigned int ciaacra,ciaacrb,ciabcra,ciabcrb;
+MACHINE_LOCAL unsigned long ciaata,ciaatb,ciabta,ciabtb;
+MACHINE_LOCAL unsigned long ciaatod,ciabtod,ciaatol,ciabtol,ciaaalarm,ciabalarm;
+MACHINE_LOCAL int ciaatlatch,ciabtlatch;
 
-unsigned int ciaapra, ciabpra;
+MACHINE_LOCAL unsigned int ciaapra, ciabpra;
 
-unsigned int gui_ledstate;
-int gui_ledstate_forced = 0;
+MACHINE_LOCAL unsigned int gui_ledstate;
+MACHINE_LOCAL int gui_ledstate_forced = 0;
 
-static unsigned long ciaala,ciaalb,ciabla,ciablb;
-static int ciaatodon, ciabtodon;
-static unsigned int ciaaprb,ciaadra,ciaadrb,ciaasdr;
-static unsigned int ciabprb,ciabdra,ciabdrb,ciabsdr;
-static int div10;
-static int kbstate, kback, ciaasdr_unread = 0;
+static MACHINE_LOCAL unsigned long ciaala,ciaalb,ciabla,ciablb;
+static MACHINE_LOCAL int ciaatodon, ciabtodon;
+static MACHINE_LOCAL unsigned int ciaaprb,ciaadra,ciaadrb,ciaasdr;
+static MACHINE_LOCAL unsigned int ciabprb,ciabdra,ciabdrb,ciabsdr;
+static MACHINE_LOCAL int div10;
+static MACHINE_LOCAL int kbstate, kback, ciaasdr_unread = 0;
 
-static int prtopen;
-static FILE *prttmp;
+static MACHINE_LOCAL int prtopen;
+static MACHINE_LOCAL FILE *prttmp;
 
 static void setclr(unsigned int *p, unsigned int val)
 {
@@ -96,7 +98,7 @@ static void RethinkICRB(void)
     }
 }
 
-static int lastdiv10;
+static MACHINE_LOCAL int lastdiv10;
 
 static void CIA_update(void)
 {
@@ -238,7 +240,7 @@ void diskindex_handler(void)
 
 void CIA_hsync_handler(void)
 {
-    static unsigned int keytime = 0, sleepyhead = 0;
+    static MACHINE_LOCAL unsigned int keytime = 0, sleepyhead = 0;
 
     if (ciabtodon)
 	ciabtod++;
@@ -367,17 +369,22 @@ static uae_u8 ReadCIAB(unsigned int addr)
 static void WriteCIAA(uae_u16 addr,uae_u8 val)
 {
     int oldled, oldovl;
+    unsigned int newled;
     switch(addr & 0xf) {
      case 0:
 	oldovl = ciaapra & 1;
 	oldled = ciaapra & 2;
 	ciaapra = (ciaapra & ~0x3) | (val & 0x3); 
-	gui_ledstate = 0;
+	newled = 0;
 	if (!gui_ledstate_forced) {
-	  gui_ledstate = (~ciaapra & 2) >> 1;
+	  newled = (~ciaapra & 2) >> 1;
 	} else {
-	  gui_ledstate = gui_ledstate_forced & 1;
+	  newled = gui_ledstate_forced & 1;
 	}
+	/* Frames before the LED change are filtered with the old state */
+	if (newled != gui_ledstate)
+	  audio_filter_sound_buffer();
+	gui_ledstate = newled;
 	/* we don't want to have ersatzkickfile or kickstart roms in uade */
 	/*
 	if ((ciaapra & 1) != oldovl) {
@@ -628,6 +635,54 @@ void CIA_reset(void)
     */
 }
 
+void cia_savestate(struct savestate *ss)
+{
+    savestate_var(ss, ciaaicr);
+    savestate_var(ss, ciaaimask);
+    savestate_var(ss, ciaacra);
+    savestate_var(ss, ciaacrb);
+    savestate_var(ss, ciaapra);
+    savestate_var(ss, ciaaprb);
+    savestate_var(ss, ciaadra);
+    savestate_var(ss, ciaadrb);
+    savestate_var(ss, ciaasdr);
+    savestate_var(ss, ciaata);
+    savestate_var(ss, ciaatb);
+    savestate_var(ss, ciaala);
+    savestate_var(ss, ciaalb);
+    savestate_var(ss, ciaatod);
+    savestate_var(ss, ciaatol);
+    savestate_var(ss, ciaaalarm);
+    savestate_var(ss, ciaatlatch);
+    savestate_var(ss, ciaatodon);
+
+    savestate_var(ss, ciabicr);
+    savestate_var(ss, ciabimask);
+    savestate_var(ss, ciabcra);
+    savestate_var(ss, ciabcrb);
+    savestate_var(ss, ciabpra);
+    savestate_var(ss, ciabprb);
+    savestate_var(ss, ciabdra);
+    savestate_var(ss, ciabdrb);
+    savestate_var(ss, ciabsdr);
+    savestate_var(ss, ciabta);
+    savestate_var(ss, ciabtb);
+    savestate_var(ss, ciabla);
+    savestate_var(ss, ciablb);
+    savestate_var(ss, ciabtod);
+    savestate_var(ss, ciabtol);
+    savestate_var(ss, ciabalarm);
+    savestate_var(ss, ciabtlatch);
+    savestate_var(ss, ciabtodon);
+
+    savestate_var(ss, div10);
+    savestate_var(ss, lastdiv10);
+    savestate_var(ss, gui_ledstate);
+    savestate_var(ss, clock_control_d);
+    savestate_var(ss, clock_control_e);
+    savestate_var(ss, clock_control_f);
+}
+
 void dumpcia(void)
 {
     fprintf(stderr,"A: CRA: %02x, CRB: %02x, IMASK: %02x, TOD: %08lx %7s TA: %04lx, TB: %04lx\n",
@@ -647,7 +702,7 @@ static void cia_lput (uaecptr, uae_u32) REGPARAM;
 static void cia_wput (uaecptr, uae_u32) REGPARAM;
 static void cia_bput (uaecptr, uae_u32) REGPARAM;
 
-addrbank cia_bank = {
+MACHINE_LOCAL addrbank cia_bank = {
     cia_lget, cia_wget, cia_bget,
     cia_lput, cia_wput, cia_bput,
     default_xlate, default_check
@@ -699,7 +754,7 @@ static void clock_lput (uaecptr, uae_u32) REGPARAM;
 static void clock_wput (uaecptr, uae_u32) REGPARAM;
 static void clock_bput (uaecptr, uae_u32) REGPARAM;
 
-addrbank clock_bank = {
+MACHINE_LOCAL addrbank clock_bank = {
     clock_lget, clock_wget, clock_bget,
     clock_lput, clock_wput, clock_bput,
     default_xlate, default_check
@@ -24,35 +24,36 @@
 #include "cia.h"
 #include "audio.h"
 #include "osemu.h"
+#include "savestate.h"
 
 #include "uadectl.h"
 
-static unsigned int n_consecutive_skipped = 0;
-static unsigned int total_skipped = 0;
+static MACHINE_LOCAL unsigned int n_consecutive_skipped = 0;
+static MACHINE_LOCAL unsigned int total_skipped = 0;
 
 #define SPRITE_COLLISIONS
 
 /* Mouse and joystick emulation */
 
-static int buttonstate[3];
-static int mouse_x, mouse_y;
-int joy0button, joy1button;
-unsigned int joy0dir, joy1dir;
+static MACHINE_LOCAL int buttonstate[3];
+static MACHINE_LOCAL int mouse_x, mouse_y;
+MACHINE_LOCAL int joy0button, joy1button;
+MACHINE_LOCAL unsigned int joy0dir, joy1dir;
 
 /* Events */
 
-unsigned long int cycles, nextevent, is_lastline;
-static int rpt_did_reset;
-struct ev eventtab[ev_max];
+MACHINE_LOCAL unsigned long int cycles, nextevent, is_lastline;
+static MACHINE_LOCAL int rpt_did_reset;
+MACHINE_LOCAL struct ev eventtab[ev_max];
 
-static int vpos;
-static uae_u16 lof;
-static int next_lineno;
-static int lof_changed = 0;
+static MACHINE_LOCAL int vpos;
+static MACHINE_LOCAL uae_u16 lof;
+static MACHINE_LOCAL int next_lineno;
+static MACHINE_LOCAL int lof_changed = 0;
 
 static const int dskdelay = 2; /* FIXME: ??? */
 
-static uae_u32 sprtaba[256],sprtabb[256];
+static MACHINE_LOCAL uae_u32 sprtaba[256],sprtabb[256];
 
 /*
  * Hardware registers of all sorts.
@@ -60,54 +61,54 @@ static uae_u32 sprtaba[256],sprtabb[256];
 
 static void custom_wput_1 (int, uaecptr, uae_u32) REGPARAM;
 
-static uae_u16 cregs[256];
+static MACHINE_LOCAL uae_u16 cregs[256];
 
-uae_u16 intena,intreq;
-uae_u16 dmacon;
-uae_u16 adkcon; /* used by audio code */
+MACHINE_LOCAL uae_u16 intena,intreq;
+MACHINE_LOCAL uae_u16 dmacon;
+MACHINE_LOCAL uae_u16 adkcon; /* used by audio code */
 
-static uae_u32 cop1lc,cop2lc,copcon;
+static MACHINE_LOCAL uae_u32 cop1lc,cop2lc,copcon;
  
-int maxhpos = MAXHPOS_PAL;
-int maxvpos = MAXVPOS_PAL;
-int minfirstline = MINFIRSTLINE_PAL;
-int vblank_endline = VBLANK_ENDLINE_PAL;
-int vblank_hz = VBLANK_HZ_PAL;
-static int fmode;
-static unsigned int beamcon0, new_beamcon0;
-static int ntscmode = 0;
+MACHINE_LOCAL int maxhpos = MAXHPOS_PAL;
+MACHINE_LOCAL int maxvpos = MAXVPOS_PAL;
+MACHINE_LOCAL int minfirstline = MINFIRSTLINE_PAL;
+MACHINE_LOCAL int vblank_endline = VBLANK_ENDLINE_PAL;
+MACHINE_LOCAL int vblank_hz = VBLANK_HZ_PAL;
+static MACHINE_LOCAL int fmode;
+static MACHINE_LOCAL unsigned int beamcon0, new_beamcon0;
+static MACHINE_LOCAL int ntscmode = 0;
 
 #define MAX_SPRITES 32
 
 /* This is but an educated guess. It seems to be correct, but this stuff
  * isn't documented well. */
 enum sprstate { SPR_stop, SPR_restart, SPR_waiting_start, SPR_waiting_stop };
-static enum sprstate sprst[8];
-static int spron[8];
-static uaecptr sprpt[8];
-static int sprxpos[8], sprvstart[8], sprvstop[8];
+static MACHINE_LOCAL enum sprstate sprst[8];
+static MACHINE_LOCAL int spron[8];
+static MACHINE_LOCAL uaecptr sprpt[8];
+static MACHINE_LOCAL int sprxpos[8], sprvstart[8], sprvstop[8];
 
-static unsigned int sprdata[MAX_SPRITES], sprdatb[MAX_SPRITES], sprctl[MAX_SPRITES], sprpos[MAX_SPRITES];
-static int sprarmed[MAX_SPRITES], sprite_last_drawn_at[MAX_SPRITES];
-static int last_sprite_point, nr_armed;
+static MACHINE_LOCAL unsigned int sprdata[MAX_SPRITES], sprdatb[MAX_SPRITES], sprctl[MAX_SPRITES], sprpos[MAX_SPRITES];
+static MACHINE_LOCAL int sprarmed[MAX_SPRITES], sprite_last_drawn_at[MAX_SPRITES];
+static MACHINE_LOCAL int last_sprite_point, nr_armed;
 
-static uae_u32 bpl1dat, bpl2dat, bpl3dat, bpl4dat, bpl5dat, bpl6dat, bpl7dat, bpl8dat;
-static uae_s16 bpl1mod, bpl2mod;
+static MACHINE_LOCAL uae_u32 bpl1dat, bpl2dat, bpl3dat, bpl4dat, bpl5dat, bpl6dat, bpl7dat, bpl8dat;
+static MACHINE_LOCAL uae_s16 bpl1mod, bpl2mod;
 
-static uaecptr bplpt[8];
+static MACHINE_LOCAL uaecptr bplpt[8];
 #ifndef SMART_UPDATE
-static char *real_bplpt[8];
+static MACHINE_LOCAL char *real_bplpt[8];
 #endif
 
-static unsigned int bplcon0, bplcon1, bplcon2, bplcon3, bplcon4;
-static int nr_planes_from_bplcon0, corrected_nr_planes_from_bplcon0;
-static unsigned int diwstrt, diwstop, diwhigh;
-static int diwhigh_written;
-static unsigned int ddfstrt, ddfstop;
+static MACHINE_LOCAL unsigned int bplcon0, bplcon1, bplcon2, bplcon3, bplcon4;
+static MACHINE_LOCAL int nr_planes_from_bplcon0, corrected_nr_planes_from_bplcon0;
+static MACHINE_LOCAL unsigned int diwstrt, diwstop, diwhigh;
+static MACHINE_LOCAL int diwhigh_written;
+static MACHINE_LOCAL unsigned int ddfstrt, ddfstop;
 
-static uae_u32 dskpt;
-static uae_u16 dsklen, dsksync;
-static int dsklength;
+static MACHINE_LOCAL uae_u32 dskpt;
+static MACHINE_LOCAL uae_u16 dsklen, dsksync;
+static MACHINE_LOCAL int dsklength;
 
 /* The display and data fetch windows */
 
@@ -116,13 +117,13 @@ enum diw_states
     DIW_waiting_start, DIW_waiting_stop
 };
 
-static int plffirstline, plflastline, plfstrt, plfstop, plflinelen;
-static int diwfirstword, diwlastword;
-static enum diw_states diwstate, hdiwstate;
+static MACHINE_LOCAL int plffirstline, plflastline, plfstrt, plfstop, plflinelen;
+static MACHINE_LOCAL int diwfirstword, diwlastword;
+static MACHINE_LOCAL enum diw_states diwstate, hdiwstate;
 
 /* Sprite collisions */
-static uae_u16 clxdat, clxcon;
-static int clx_sprmask;
+static MACHINE_LOCAL uae_u16 clxdat, clxcon;
+static MACHINE_LOCAL int clx_sprmask;
 
 enum copper_states {
     COP_stop,
@@ -143,39 +144,39 @@ struct copper {
     enum diw_states vdiw;
 };
 
-static struct copper cop_state;
+static MACHINE_LOCAL struct copper cop_state;
 
 static void prepare_copper_1 (void);
 
-int dskdmaen; /* used in cia.c */
+MACHINE_LOCAL int dskdmaen; /* used in cia.c */
 
 /*
  * Statistics
  */
 
 /* Used also by bebox.cpp */
-static unsigned long int msecs = 0, lastframetime = 0;
-unsigned long int frametime = 0, timeframes = 0;
-static unsigned long int seconds_base;
-int bogusframe;
+static MACHINE_LOCAL unsigned long int msecs = 0, lastframetime = 0;
+MACHINE_LOCAL unsigned long int frametime = 0, timeframes = 0;
+static MACHINE_LOCAL unsigned long int seconds_base;
+MACHINE_LOCAL int bogusframe;
 
 
-static int current_change_set;
+static MACHINE_LOCAL int current_change_set;
 
-static struct sprite_draw *curr_sprite_positions, *prev_sprite_positions;
-static struct color_change *curr_color_changes, *prev_color_changes;
-static struct draw_info *curr_drawinfo, *prev_drawinfo;
-static struct color_entry *curr_color_tables, *prev_color_tables;
+static MACHINE_LOCAL struct sprite_draw *curr_sprite_positions, *prev_sprite_positions;
+static MACHINE_LOCAL struct color_change *curr_color_changes, *prev_color_changes;
+static MACHINE_LOCAL struct draw_info *curr_drawinfo, *prev_drawinfo;
+static MACHINE_LOCAL struct color_entry *curr_color_tables, *prev_color_tables;
 
-static int next_color_change, next_sprite_draw, next_delay_change;
-static int next_color_entry, remembered_color_entry;
-static int color_src_match, color_dest_match, color_compare_result;
+static MACHINE_LOCAL int next_color_change, next_sprite_draw, next_delay_change;
+static MACHINE_LOCAL int next_color_entry, remembered_color_entry;
+static MACHINE_LOCAL int color_src_match, color_dest_match, color_compare_result;
 
 /* These few are only needed during/at the end of the scanline, and don't
  * have to be remembered. */
-static int decided_bpl1mod, decided_bpl2mod, decided_nr_planes, decided_res;
+static MACHINE_LOCAL int decided_bpl1mod, decided_bpl2mod, decided_nr_planes, decided_res;
 
-static char thisline_changed;
+static MACHINE_LOCAL char thisline_changed;
 
 
 #ifdef SMART_UPDATE
@@ -184,13 +185,13 @@ static char thisline_changed;
 #define MARK_LINE_CHANGED do { ; } while (0)
 #endif
 
-static int modulos_added, plane_decided, color_decided, very_broken_program;
+static MACHINE_LOCAL int modulos_added, plane_decided, color_decided, very_broken_program;
 
 /*
  * helper functions
  */
 
-int rpt_available = 0;
+MACHINE_LOCAL int rpt_available = 0;
 
 void reset_frame_rate_hack (void)
 {
@@ -245,7 +246,7 @@ inline int current_hpos (void)
     return cycles - eventtab[ev_hsync].oldcycles;
 }
 
-static int broken_plane_sub[8];
+static MACHINE_LOCAL int broken_plane_sub[8];
 
 /* set PAL or NTSC timing variables */
 
@@ -282,16 +283,16 @@ static void init_hz (void)
 
 static const int docal = 60, xcaloff = 40, ycaloff = 20;
 static const int calweight = 3;
-static int lastsampledmx, lastsampledmy;
-static int lastspr0x,lastspr0y,lastdiffx,lastdiffy,spr0pos,spr0ctl;
-static int mstepx,mstepy,xoffs=defxoffs,yoffs=defyoffs;
-static int sprvbfl;
+static MACHINE_LOCAL int lastsampledmx, lastsampledmy;
+static MACHINE_LOCAL int lastspr0x,lastspr0y,lastdiffx,lastdiffy,spr0pos,spr0ctl;
+static MACHINE_LOCAL int mstepx,mstepy,xoffs=defxoffs,yoffs=defyoffs;
+static MACHINE_LOCAL int sprvbfl;
 
-static int lastmx, lastmy;
-static int newmousecounters;
-static int ievent_alive = 0;
+static MACHINE_LOCAL int lastmx, lastmy;
+static MACHINE_LOCAL int newmousecounters;
+static MACHINE_LOCAL int ievent_alive = 0;
 
-static int timehack_alive = 0;
+static MACHINE_LOCAL int timehack_alive = 0;
 
 static uae_u32 timehack_helper (void)
 {
@@ -431,19 +432,20 @@ static void DMACON (uae_u16 v)
 
 	cdp->dmaen = (dmacon & 0x200) && (dmacon & (1<<i));
 	if (cdp->dmaen) {
-	    if (cdp->state == 0) {
-		cdp->state = 1;
+	    if (audio_slice.state[i] == 0) {
+		audio_slice.state[i] = 1;
 		cdp->pt = cdp->lc;
 		cdp->ptend = cdp->lc + 2 * (cdp->len ? cdp->len : 65536);
 		cdp->wper = cdp->per;
 		cdp->wlen = cdp->len;
 		cdp->data_written = 2;
-		cdp->evtime = eventtab[ev_hsync].evtime - cycles;
+		audio_slice.evtime[i] = eventtab[ev_hsync].evtime - cycles;
 	    }
 	} else {
-	    if (cdp->state == 1 || cdp->state == 5) {
-		cdp->state = 0;
-		cdp->current_sample = 0;
+	    if (audio_slice.state[i] == 1 || audio_slice.state[i] == 5) {
+		audio_slice.state[i] = 0;
+		audio_slice.current_sample[i] = 0;
+		audio_slice.output_dirty = 1;
 	    }
 	}
     }
@@ -473,10 +475,11 @@ static void ADKCON (uae_u16 v)
 
     setclr (&adkcon,v);
     t = adkcon | (adkcon >> 4);
-    audio_channel[0].adk_mask = (((t >> 0) & 1) - 1);
-    audio_channel[1].adk_mask = (((t >> 1) & 1) - 1);
-    audio_channel[2].adk_mask = (((t >> 2) & 1) - 1);
-    audio_channel[3].adk_mask = (((t >> 3) & 1) - 1);
+    audio_slice.adk_mask[0] = (((t >> 0) & 1) - 1);
+    audio_slice.adk_mask[1] = (((t >> 1) & 1) - 1);
+    audio_slice.adk_mask[2] = (((t >> 2) & 1) - 1);
+    audio_slice.adk_mask[3] = (((t >> 3) & 1) - 1);
+    audio_slice.output_dirty = 1;
 }
 
 static void BEAMCON0 (uae_u16 v)
@@ -654,7 +657,7 @@ static uae_u16 DSKDATR (void)
   return 0;
 }
 
-static uae_u16 potgo_value;
+static MACHINE_LOCAL uae_u16 potgo_value;
 
 static void POTGO (uae_u16 v)
 {
@@ -687,7 +690,7 @@ static uae_u16 POTGOR (void)
 
 static uae_u16 POT0DAT (void)
 {
-    static uae_u16 cnt = 0;
+    static MACHINE_LOCAL uae_u16 cnt = 0;
     if (JSEM_ISMOUSE (0, &currprefs)) {
 	if (buttonstate[2])
 	    cnt = ((cnt + 1) & 0xFF) | (cnt & 0xFF00);
@@ -735,7 +738,7 @@ static int cycles_for_plane[9][8] = {
     { 1, -1, 1, -1, 1, -1, 1, -1 }
 };
 
-static unsigned int waitmasktab[256];
+static MACHINE_LOCAL unsigned int waitmasktab[256];
 
 #define COP_OFFSET 4
 
@@ -1251,7 +1254,7 @@ static void hsync_handler (void)
 	    cdp->data_written = 0;
 
 #if AUDIO_DEBUG	   
-	    if (cdp->state != 0 && cdp->pt >= cdp->ptend) {
+	    if (audio_slice.state[nr] != 0 && cdp->pt >= cdp->ptend) {
 		fprintf(stderr, "Audio DMA fetch overrun on channel %d: %.8x/%.8x\n", nr, cdp->pt, cdp->ptend);
 	    }
 #endif
@@ -1264,7 +1267,7 @@ static void hsync_handler (void)
 	    if (cdp->wlen != 1)
 		cdp->pt += 2;
 
-	    if (cdp->state == 2 || cdp->state == 3) {
+	    if (audio_slice.state[nr] == 2 || audio_slice.state[nr] == 3) {
 		if (cdp->wlen == 1) {
 		    cdp->pt = cdp->lc;
 		    cdp->ptend = cdp->lc + 2 * (cdp->len ? cdp->len : 65536);
@@ -1350,6 +1353,45 @@ void customreset (void)
 #endif
 }
 
+void custom_savestate (struct savestate *ss)
+{
+    int i;
+
+    savestate_var (ss, intena);
+    savestate_var (ss, intreq);
+    savestate_var (ss, dmacon);
+    savestate_var (ss, adkcon);
+    savestate_var (ss, potgo_value);
+    savestate_var (ss, vpos);
+    savestate_var (ss, lof);
+    savestate_var (ss, beamcon0);
+    savestate_var (ss, new_beamcon0);
+    savestate_var (ss, maxhpos);
+    savestate_var (ss, maxvpos);
+    savestate_var (ss, minfirstline);
+    savestate_var (ss, vblank_endline);
+    savestate_var (ss, vblank_hz);
+    savestate_var (ss, cop1lc);
+    savestate_var (ss, cop2lc);
+    savestate_var (ss, copcon);
+    savestate_var (ss, cop_state);
+    savestate_var (ss, dskdmaen);
+    savestate_var (ss, sprarmed);
+    savestate_var (ss, ievent_alive);
+    savestate_var (ss, timehack_alive);
+    savestate_var (ss, rpt_did_reset);
+    savestate_var (ss, cycles);
+    savestate_var (ss, nextevent);
+    savestate_var (ss, is_lastline);
+
+    /* Event handlers are fixed, only the timing is saved */
+    for (i = 0; i < ev_max; i++) {
+	savestate_var (ss, eventtab[i].active);
+	savestate_var (ss, eventtab[i].evtime);
+	savestate_var (ss, eventtab[i].oldcycles);
+    }
+}
+
 void dumpcustom (void)
 {
     write_log ("DMACON: %x INTENA: %x INTREQ: %x VPOS: %x HPOS: %x CYCLES: %ld\n", DMACONR(),
@@ -1411,7 +1453,7 @@ static void custom_lput (uaecptr, uae_u32) REGPARAM;
 static void custom_wput (uaecptr, uae_u32) REGPARAM;
 static void custom_bput (uaecptr, uae_u32) REGPARAM;
 
-addrbank custom_bank = {
+MACHINE_LOCAL addrbank custom_bank = {
     custom_lget, custom_wget, custom_bget,
     custom_lput, custom_wput, custom_bput,
     default_xlate, default_check
@@ -21,12 +21,12 @@
 #include "debug.h"
 #include "cia.h"
 
-static int debugger_active = 0;
-static uaecptr skipaddr;
-static int do_skip;
-static int wait_interrupt;
-int debugging = 0;
-int debug_interrupt_happened;
+static MACHINE_LOCAL int debugger_active = 0;
+static MACHINE_LOCAL uaecptr skipaddr;
+static MACHINE_LOCAL int do_skip;
+static MACHINE_LOCAL int wait_interrupt;
+MACHINE_LOCAL int debugging = 0;
+MACHINE_LOCAL int debug_interrupt_happened;
 
 void activate_debugger (void)
 {
@@ -38,13 +38,13 @@ void activate_debugger (void)
     debugging = 1;
 }
 
-int firsthist = 0;
-int lasthist = 0;
+MACHINE_LOCAL int firsthist = 0;
+MACHINE_LOCAL int lasthist = 0;
 #ifdef NEED_TO_DEBUG_BADLY
-struct regstruct history[MAX_HIST];
-union flagu historyf[MAX_HIST];
+MACHINE_LOCAL struct regstruct history[MAX_HIST];
+MACHINE_LOCAL union flagu historyf[MAX_HIST];
 #else
-uaecptr history[MAX_HIST];
+MACHINE_LOCAL uaecptr history[MAX_HIST];
 #endif
 
 
@@ -265,7 +265,7 @@ static void modulesearch (void)
 static void cheatsearch (char **c)
 {
     uae_u8 *p = get_real_address (0);
-    static uae_u32 *vlist = NULL;
+    static MACHINE_LOCAL uae_u32 *vlist = NULL;
     uae_u32 ptr;
     uae_u32 val = 0;
     uae_u32 type = 0; /* not yet */
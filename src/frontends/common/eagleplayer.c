@@ -27,6 +27,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #define OPTION_DELIMITER ","
 
@@ -76,25 +77,26 @@ static const struct epconfattr string_options[] = {
 };
 
 
-static int ufcompare(const void *a, const void *b);
+/*
+ * Process-wide list of loaded eagleplayer stores. A store is loaded once
+ * per eagleplayer.conf and shared by all states. It is kept in the list
+ * after the last state releases it so that new states get it for free.
+ * A store is replaced if eagleplayer.conf is modified.
+ */
+static pthread_mutex_t playerstore_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct eagleplayerstore *playerstores;
+
 static struct eagleplayerstore *read_eagleplayer_conf(const char *filename);
 
 
 static struct eagleplayer *get_eagleplayer(const char *extension,
 					   struct eagleplayerstore *playerstore);
 
-static struct eagleplayerstore *try_playerstore_path(const char *path)
-{
-	char formatsfile[PATH_MAX];
-	snprintf(formatsfile, sizeof formatsfile, "%s/eagleplayer.conf", path);
-	return read_eagleplayer_conf(formatsfile);
-}
-
 static int load_playerstore(struct uade_state *state)
 {
 	const char *basedir = state->config.basedir.name;
 	if (state->playerstore == NULL)
-		state->playerstore = try_playerstore_path(basedir);
+		state->playerstore = uade_acquire_playerstore(basedir);
 
 	if (state->playerstore == NULL)
 		uade_warning("Tried to load eagleplayer.conf from %s, "
@@ -103,7 +105,7 @@ static int load_playerstore(struct uade_state *state)
 	return state->playerstore != NULL;
 }
 
-void uade_free_playerstore(struct eagleplayerstore *ps)
+static void free_playerstore(struct eagleplayerstore *ps)
 {
 	size_t i;
 	struct uade_attribute *node;
@@ -131,10 +133,96 @@ void uade_free_playerstore(struct eagleplayerstore *ps)
 	}
 	free_and_null(ps->players);
 	free_and_null(ps->map);
+	free_and_null(ps->table);
+	free_and_null(ps->filename);
 	memset(ps, 0, sizeof ps[0]);
 	free_and_null(ps);
 }
 
+/* Must be called with playerstore_mutex held */
+static struct eagleplayerstore *find_playerstore(const char *filename,
+						 time_t mtime)
+{
+	struct eagleplayerstore **pp = &playerstores;
+	struct eagleplayerstore *ps;
+
+	while ((ps = *pp) != NULL) {
+		if (strcmp(ps->filename, filename) != 0) {
+			pp = &ps->next;
+			continue;
+		}
+		if (ps->mtime == mtime)
+			return ps;
+		/* eagleplayer.conf has been modified. Drop the old store. */
+		if (ps->refcount == 0) {
+			*pp = ps->next;
+			free_playerstore(ps);
+			continue;
+		}
+		pp = &ps->next;
+	}
+	return NULL;
+}
+
+/*
+ * Returns a shared, immutable eagleplayer store for basedir, loading
+ * eagleplayer.conf if necessary. Release it with uade_release_playerstore().
+ */
+struct eagleplayerstore *uade_acquire_playerstore(const char *basedir)
+{
+	char filename[PATH_MAX];
+	struct stat st;
+	struct eagleplayerstore *ps;
+	struct eagleplayerstore *loaded;
+
+	snprintf(filename, sizeof filename, "%s/eagleplayer.conf", basedir);
+	if (stat(filename, &st))
+		return NULL;
+
+	pthread_mutex_lock(&playerstore_mutex);
+	ps = find_playerstore(filename, st.st_mtime);
+	if (ps != NULL)
+		ps->refcount++;
+	pthread_mutex_unlock(&playerstore_mutex);
+	if (ps != NULL)
+		return ps;
+
+	/* Parse outside the lock. Another thread may load the same file. */
+	loaded = read_eagleplayer_conf(filename);
+	if (loaded == NULL)
+		return NULL;
+	loaded->filename = strdup(filename);
+	if (loaded->filename == NULL) {
+		free_playerstore(loaded);
+		return NULL;
+	}
+	loaded->mtime = st.st_mtime;
+
+	pthread_mutex_lock(&playerstore_mutex);
+	ps = find_playerstore(filename, st.st_mtime);
+	if (ps == NULL) {
+		ps = loaded;
+		loaded = NULL;
+		ps->next = playerstores;
+		playerstores = ps;
+	}
+	ps->refcount++;
+	pthread_mutex_unlock(&playerstore_mutex);
+
+	free_playerstore(loaded);
+	return ps;
+}
+
+void uade_release_playerstore(struct eagleplayerstore *ps)
+{
+	if (ps == NULL)
+		return;
+	pthread_mutex_lock(&playerstore_mutex);
+	assert(ps->refcount > 0);
+	ps->refcount--;
+	pthread_mutex_unlock(&playerstore_mutex);
+}
+
 static void try_extension(struct uade_detection_info *detectioninfo,
 			  const char *ext, struct uade_state *state)
 {
@@ -320,24 +408,66 @@ int uade_parse_attribute_from_string(struct uade_attribute **attributelist,
 	return 0;
 }
 
-/* Compare function for bsearch() and qsort() to sort eagleplayers with
-   respect to name extension. */
-static int ufcompare(const void *a, const void *b)
+/* Case insensitive FNV-1a hash for the extension table */
+static size_t extension_hash(const char *extension)
 {
-	const struct eagleplayermap *ua = a;
-	const struct eagleplayermap *ub = b;
+	uint32_t h = 2166136261U;
+	const unsigned char *s = (const unsigned char *) extension;
 
-	return strcasecmp(ua->extension, ub->extension);
+	for (; *s != 0; s++) {
+		h ^= tolower(*s);
+		h *= 16777619U;
+	}
+	return h;
+}
+
+static struct eagleplayermap **find_extension_slot(
+	const char *extension, const struct eagleplayerstore *ps)
+{
+	size_t mask = ps->tablesize - 1;
+	size_t i = extension_hash(extension) & mask;
+
+	while (ps->table[i] != NULL &&
+	       strcasecmp(ps->table[i]->extension, extension) != 0)
+		i = (i + 1) & mask;
+
+	return &ps->table[i];
+}
+
+static int build_extension_table(struct eagleplayerstore *ps)
+{
+	size_t i;
+	struct eagleplayermap **slot;
+
+	/* Keep the load factor at most 0.5 */
+	ps->tablesize = 16;
+	while (ps->tablesize < 2 * ps->nextensions)
+		ps->tablesize *= 2;
+
+	ps->table = calloc(ps->tablesize, sizeof ps->table[0]);
+	if (ps->table == NULL)
+		return -1;
+
+	for (i = 0; i < ps->nextensions; i++) {
+		slot = find_extension_slot(ps->map[i].extension, ps);
+		if (*slot != NULL) {
+			uade_warning("Prefix %s is used by %s and %s in "
+				     "eagleplayer.conf. Using %s.\n",
+				     ps->map[i].extension,
+				     (*slot)->player->playername,
+				     ps->map[i].player->playername,
+				     (*slot)->player->playername);
+			continue;
+		}
+		*slot = &ps->map[i];
+	}
+	return 0;
 }
 
 static struct eagleplayer *get_eagleplayer(const char *extension,
 					   struct eagleplayerstore *ps)
 {
-	struct eagleplayermap *uf = ps->map;
-	struct eagleplayermap *f;
-	struct eagleplayermap key = {.extension = (char *)extension };
-
-	f = bsearch(&key, uf, ps->nextensions, sizeof(uf[0]), ufcompare);
+	struct eagleplayermap *f = *find_extension_slot(extension, ps);
 	if (f == NULL)
 		return NULL;
 
@@ -528,13 +658,15 @@ static struct eagleplayerstore *read_eagleplayer_conf(const char *filename)
 
 	assert(exti == ps->nextensions);
 
-	/* Make the extension map bsearch() ready */
-	qsort(ps->map, ps->nextensions, sizeof(ps->map[0]), ufcompare);
+	if (build_extension_table(ps)) {
+		uade_warning("No memory for extension table.");
+		goto error;
+	}
 
 	return ps;
 
  error:
-	uade_free_playerstore(ps);
+	free_playerstore(ps);
 	if (f != NULL)
 		fclose_and_null(f);
 	return NULL;
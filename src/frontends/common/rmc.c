@@ -4,11 +4,32 @@
 
 #include <bencodetools/bencode.h>
 #include <assert.h>
+#include <ctype.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 #define RMC_PREFIX "l9:rmc\x00\xfb\x13\xf6\x1f\xa2"
 #define RMC_PREFIX_LEN 12
 
+/* Nesting limit for raw bencode data so that recursion stays bounded */
+#define RMC_MAX_DEPTH 64
+
+/*
+ * An RMC file that is read lazily. Only the meta data dictionary is decoded.
+ * Files are looked up from the raw files dictionary on demand, so the file
+ * entries that are never requested are not touched.
+ */
+struct uade_rmc_reader {
+	char *data;
+	size_t size;
+	int mapped;  /* data is mmap()ed instead of malloc()ed */
+	struct bencode *rmc;  /* [magic, meta, {}] */
+	const char *files;  /* Raw files dictionary inside data */
+	const char *filesend;
+};
+
 int uade_is_rmc(const char *buf, size_t size)
 {
 	if (size < RMC_PREFIX_LEN)
@@ -213,6 +234,350 @@ struct uade_file *uade_rmc_get_file(const struct bencode *rmc, const char *name)
 	return uade_file(name, ben_str_val(f), ben_str_len(f));
 }
 
+/*
+ * Parses a raw bencode string at p. Returns a pointer past the string, or
+ * NULL if the data is not a valid string.
+ */
+static const char *parse_raw_str(const char **str, size_t *len,
+				 const char *p, const char *end)
+{
+	size_t n = 0;
+	if (p >= end || !isdigit((unsigned char) *p))
+		return NULL;
+	while (p < end && isdigit((unsigned char) *p)) {
+		if (n > (SIZE_MAX - 9) / 10)
+			return NULL;
+		n = n * 10 + (*p - '0');
+		p++;
+	}
+	if (p >= end || *p != ':' || n > (size_t) (end - p - 1))
+		return NULL;
+	*str = p + 1;
+	*len = n;
+	return p + 1 + n;
+}
+
+/* Returns a pointer past the raw bencode value at p, or NULL on error */
+static const char *skip_raw_value(const char *p, const char *end, int depth)
+{
+	const char *str;
+	size_t len;
+
+	if (p >= end || depth > RMC_MAX_DEPTH)
+		return NULL;
+
+	switch (*p) {
+	case 'i':
+		p = memchr(p, 'e', end - p);
+		return p != NULL ? p + 1 : NULL;
+	case 'l':
+	case 'd':
+		p++;
+		while (p < end && *p != 'e') {
+			p = skip_raw_value(p, end, depth + 1);
+			if (p == NULL)
+				return NULL;
+		}
+		return p < end ? p + 1 : NULL;
+	default:
+		return parse_raw_str(&str, &len, p, end);
+	}
+}
+
+/*
+ * Name search in a raw dictionary. If nocase is set, the search is case
+ * insensitive as in scan_dict(). On success, the value is returned in
+ * [*value, *valueend).
+ */
+static int scan_raw_dict(const char **value, const char **valueend,
+			 const char *dict, const char *dictend,
+			 const char *name, int nocase)
+{
+	const char *p = dict + 1;
+	const char *key;
+	const char *next;
+	const char *match = NULL;
+	const char *matchend = NULL;
+	size_t keylen;
+	size_t namelen = strlen(name);
+
+	if (dict >= dictend || *dict != 'd')
+		return -1;
+
+	while (p < dictend && *p != 'e') {
+		p = parse_raw_str(&key, &keylen, p, dictend);
+		if (p == NULL)
+			return -1;
+		next = skip_raw_value(p, dictend, 1);
+		if (next == NULL)
+			return -1;
+		if (keylen == namelen) {
+			if (memcmp(key, name, namelen) == 0) {
+				/* Exact match */
+				*value = p;
+				*valueend = next;
+				return 0;
+			}
+			if (nocase && match == NULL &&
+			    strncasecmp(key, name, namelen) == 0) {
+				match = p;
+				matchend = next;
+			}
+		}
+		p = next;
+	}
+
+	if (match == NULL)
+		return -1;
+	*value = match;
+	*valueend = matchend;
+	return 0;
+}
+
+/* Returns the number of entries in a raw dictionary, or -1 on error */
+static long count_raw_dict(const char **firstkey, size_t *firstkeylen,
+			   const char *dict, const char *dictend)
+{
+	const char *p = dict + 1;
+	const char *key;
+	size_t keylen;
+	long n = 0;
+
+	while (p < dictend && *p != 'e') {
+		p = parse_raw_str(&key, &keylen, p, dictend);
+		if (p == NULL)
+			return -1;
+		p = skip_raw_value(p, dictend, 1);
+		if (p == NULL)
+			return -1;
+		if (n == 0) {
+			*firstkey = key;
+			*firstkeylen = keylen;
+		}
+		n++;
+	}
+	return n;
+}
+
+static struct uade_file *get_raw_file(const char *name, const char *value,
+				      const char *valueend)
+{
+	const char *data;
+	size_t len;
+	if (parse_raw_str(&data, &len, value, valueend) != valueend)
+		return NULL;
+	return uade_file(name, data, len);
+}
+
+struct uade_file *uade_rmc_reader_get_file(const struct uade_rmc_reader *reader,
+					   const char *name)
+{
+	char path[PATH_MAX];
+	char *namepart;
+	char *separator;
+	const char *files = reader->files;
+	const char *filesend = reader->filesend;
+	const char *f;
+	const char *fend;
+
+	if (name[0] == '.' || name[0] == '/' || strstr(name, "/.") != NULL) {
+		uade_warning("rmc: Reject amiga name: %s\n", name);
+		return NULL;
+	}
+
+	strlcpy(path, name, sizeof path);
+	namepart = path;
+	while (1) {
+		separator = strchr(namepart, '/');
+		if (separator == NULL)
+			break;
+		*separator = 0;
+		/* Scan for a directory */
+		if (scan_raw_dict(&files, &filesend, files, filesend,
+				  namepart, 1))
+			return NULL;
+		namepart = separator + 1;
+	}
+
+	if (scan_raw_dict(&f, &fend, files, filesend, namepart, 1))
+		return NULL;
+
+	return get_raw_file(name, f, fend);
+}
+
+int uade_rmc_reader_get_module(struct uade_file **module,
+			       const struct uade_rmc_reader *reader)
+{
+	const struct bencode *meta = uade_rmc_get_meta(reader->rmc);
+	const struct bencode *songname = ben_dict_get_by_str(meta, "song");
+	char name[PATH_MAX];
+	const char *key = NULL;
+	size_t keylen = 0;
+	const char *value;
+	const char *valueend;
+	long nfiles;
+
+	if (module != NULL)
+		*module = NULL;
+
+	nfiles = count_raw_dict(&key, &keylen, reader->files,
+				reader->filesend);
+	if (nfiles < 0)
+		return -1;
+
+	if (songname == NULL) {
+		if (nfiles != 1) {
+			fprintf(stderr, "Ambiguous song file. Can not select which file to play.\n");
+			return -1;
+		}
+	} else {
+		if (!ben_is_str(songname)) {
+			uade_warning("Non-string song name in RMC meta\n");
+			return -1;
+		}
+		key = ben_str_val(songname);
+		keylen = ben_str_len(songname);
+	}
+
+	if (check_subsongs(meta) < 0)
+		return -1;
+
+	if (keylen >= sizeof name || memchr(key, 0, keylen) != NULL) {
+		uade_warning("Invalid module name in RMC\n");
+		return -1;
+	}
+	memcpy(name, key, keylen);
+	name[keylen] = 0;
+
+	/* The module name is matched exactly, unlike other file names */
+	if (scan_raw_dict(&value, &valueend, reader->files, reader->filesend,
+			  name, 0)) {
+		fprintf(stderr, "Module %s not in the container\n", name);
+		return -1;
+	}
+
+	if (module != NULL) {
+		*module = get_raw_file(name, value, valueend);
+		if (*module == NULL) {
+			uade_warning("Non-string entries in files dictrionary\n");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int append_value(struct bencode *list, struct bencode *value)
+{
+	if (value == NULL)
+		return -1;
+	if (ben_list_append(list, value)) {
+		ben_free(value);
+		return -1;
+	}
+	return 0;
+}
+
+static struct uade_rmc_reader *open_reader(char *data, size_t size,
+					   int mapped)
+{
+	const char *p = data;
+	const char *end = data + size;
+	const char *magic;
+	const char *meta;
+	size_t magiclen;
+	struct bencode *decodedmeta = NULL;
+	struct uade_rmc_reader *reader = calloc(1, sizeof reader[0]);
+	int ret;
+
+	if (reader == NULL)
+		goto error;
+	reader->data = data;
+	reader->size = size;
+	reader->mapped = mapped;
+
+	/* The RMC is a list: [magic, meta, files, ...] */
+	if (p >= end || *p != 'l')
+		goto error;
+	p = parse_raw_str(&magic, &magiclen, p + 1, end);
+	if (p == NULL || magiclen != RMC_MAGIC_LEN ||
+	    memcmp(magic, RMC_MAGIC, RMC_MAGIC_LEN) != 0)
+		goto error;
+	meta = p;
+	p = skip_raw_value(meta, end, 1);
+	if (p == NULL)
+		goto error;
+	decodedmeta = ben_decode(meta, p - meta);
+	if (decodedmeta == NULL || !ben_is_dict(decodedmeta))
+		goto error;
+	reader->files = p;
+	reader->filesend = skip_raw_value(p, end, 1);
+	if (reader->filesend == NULL || *reader->files != 'd')
+		goto error;
+
+	reader->rmc = ben_list();
+	if (reader->rmc == NULL ||
+	    append_value(reader->rmc, ben_blob(RMC_MAGIC, RMC_MAGIC_LEN)))
+		goto error;
+	/* append_value() takes the ownership of meta, also on failure */
+	ret = append_value(reader->rmc, decodedmeta);
+	decodedmeta = NULL;
+	if (ret || append_value(reader->rmc, ben_dict()))
+		goto error;
+
+	if (uade_rmc_reader_get_module(NULL, reader))
+		goto error;
+
+	return reader;
+
+error:
+	ben_free(decodedmeta);
+	if (reader != NULL) {
+		uade_rmc_close(reader);
+	} else if (mapped) {
+		uade_unmap_file(data, size);
+	} else {
+		free(data);
+	}
+	return NULL;
+}
+
+struct uade_rmc_reader *uade_rmc_open(const char *fname)
+{
+	size_t size;
+	char *data = uade_map_file(&size, fname);
+	if (data != NULL)
+		return open_reader(data, size, 1);
+	data = uade_read_file(&size, fname);
+	if (data == NULL)
+		return NULL;
+	return open_reader(data, size, 0);
+}
+
+struct uade_rmc_reader *uade_rmc_open_buffer(void *data, size_t size)
+{
+	if (data == NULL)
+		return NULL;
+	return open_reader(data, size, 0);
+}
+
+void uade_rmc_close(struct uade_rmc_reader *reader)
+{
+	if (reader == NULL)
+		return;
+	ben_free(reader->rmc);
+	if (reader->mapped)
+		uade_unmap_file(reader->data, reader->size);
+	else
+		free(reader->data);
+	free(reader);
+}
+
+struct bencode *uade_rmc_reader_get_rmc(const struct uade_rmc_reader *reader)
+{
+	return reader->rmc;
+}
+
 struct bencode *uade_rmc_get_meta(const struct bencode *rmc)
 {
 	return ben_list_get(rmc, 1);
@@ -239,6 +604,83 @@ const struct bencode *uade_rmc_get_subsongs(const struct bencode *rmc)
 	return ben_dict_get_by_str(uade_rmc_get_meta(rmc), "subsongs");
 }
 
+static const struct bencode *get_checkpoints(const struct bencode *rmc)
+{
+	const struct bencode *checkpoints;
+	const struct bencode *frequency;
+	checkpoints = ben_dict_get_by_str(uade_rmc_get_meta(rmc), "checkpoints");
+	if (!ben_is_dict(checkpoints))
+		return NULL;
+	frequency = ben_dict_get_by_str(checkpoints, "frequency");
+	if (!ben_is_int(frequency) || ben_int_val(frequency) <= 0 ||
+	    ben_int_val(frequency) > 1000000)
+		return NULL;
+	return checkpoints;
+}
+
+int uade_rmc_get_checkpoint_frequency(const struct bencode *rmc)
+{
+	const struct bencode *checkpoints = get_checkpoints(rmc);
+	if (checkpoints == NULL)
+		return 0;
+	return ben_int_val(ben_dict_get_by_str(checkpoints, "frequency"));
+}
+
+int uade_rmc_get_checkpoint_default(const struct bencode *rmc)
+{
+	const struct bencode *checkpoints = get_checkpoints(rmc);
+	const struct bencode *subsong;
+	if (checkpoints == NULL)
+		return -1;
+	subsong = ben_dict_get_by_str(checkpoints, "default");
+	if (!ben_is_int(subsong) || ben_int_val(subsong) < 0 ||
+	    ben_int_val(subsong) > INT_MAX)
+		return -1;
+	return ben_int_val(subsong);
+}
+
+const struct bencode *uade_rmc_get_checkpoint(uint64_t *cpframe,
+					      const struct bencode *rmc,
+					      int subsong, uint64_t frame)
+{
+	const struct bencode *checkpoints = get_checkpoints(rmc);
+	const struct bencode *subsongs;
+	const struct bencode *list = NULL;
+	const struct bencode *snapshot = NULL;
+	struct bencode *key;
+	struct bencode *value;
+	struct bencode *checkpoint;
+	struct bencode *cpf;
+	size_t pos;
+
+	if (checkpoints == NULL)
+		return NULL;
+	subsongs = ben_dict_get_by_str(checkpoints, "subsongs");
+	if (!ben_is_dict(subsongs))
+		return NULL;
+	ben_dict_for_each(key, value, pos, subsongs) {
+		if (ben_is_int(key) && ben_int_val(key) == subsong)
+			list = value;
+	}
+	if (!ben_is_list(list))
+		return NULL;
+
+	ben_list_for_each(checkpoint, pos, list) {
+		if (!ben_is_list(checkpoint) || ben_list_len(checkpoint) != 2)
+			return NULL;
+		cpf = ben_list_get(checkpoint, 0);
+		if (!ben_is_int(cpf) || ben_int_val(cpf) < 0)
+			return NULL;
+		if ((uint64_t) ben_int_val(cpf) > frame)
+			break;
+		if (!ben_is_str(ben_list_get(checkpoint, 1)))
+			return NULL;
+		*cpframe = ben_int_val(cpf);
+		snapshot = ben_list_get(checkpoint, 1);
+	}
+	return snapshot;
+}
+
 int uade_rmc_record_file(struct bencode *rmc, const char *name,
 			 const void *data, size_t len)
 {
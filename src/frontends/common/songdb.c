@@ -56,6 +56,28 @@ static struct uade_content *get_content(const char *md5, struct uade_state *stat
 		       sizeof db->contentchecksums[0], contentcompare);
 }
 
+/*
+ * A content db borrowed from a uade_context is copied before the first
+ * modification. Returns 0 on success, -1 on error.
+ */
+static int unshare_content_db(struct uade_songdb *db)
+{
+	struct uade_content *n;
+
+	if (!db->ccshared)
+		return 0;
+
+	n = malloc(MAX(db->nccalloc, 1) * sizeof(n[0]));
+	if (n == NULL) {
+		fprintf(stderr, "uade: No memory for content db copy.\n");
+		return -1;
+	}
+	memcpy(n, db->contentchecksums, db->nccused * sizeof(n[0]));
+	db->contentchecksums = n;
+	db->ccshared = 0;
+	return 0;
+}
+
 static struct uade_content *create_content_checksum(struct uade_state *state,
 						    const char *md5,
 						    uint32_t playtime)
@@ -63,6 +85,9 @@ static struct uade_content *create_content_checksum(struct uade_state *state,
 	struct uade_content *n;
 	struct uade_songdb *db = &state->songdb;
 
+	if (unshare_content_db(db))
+		return NULL;
+
 	if (db->nccused == db->nccalloc) {
 		db->nccalloc = MAX(db->nccalloc * 2, 16);
 		n = realloc(db->contentchecksums, db->nccalloc * sizeof(n[0]));
@@ -143,6 +168,9 @@ struct uade_content *uade_add_playtime(struct uade_state *state,
 	if (strlen(md5) != 32)
 		return NULL;
 
+	if (unshare_content_db(&state->songdb))
+		return NULL;
+
 	n = get_content(md5, state);
 	if (n != NULL) {
 		update_playtime(state, n, playtime);
@@ -198,6 +226,25 @@ void uade_lookup_song(const struct uade_file *module, struct uade_state *state)
 	}
 }
 
+/*
+ * Returns the playtime of the song in milliseconds from the content
+ * database, or 0 if the playtime is not known. The song is not played.
+ */
+uint32_t uade_lookup_playtime(const struct uade_file *module,
+			      struct uade_state *state)
+{
+	struct uade_content *content;
+	char md5[33];
+
+	md5_from_buffer(md5, sizeof md5, (const uint8_t *) module->data,
+			module->size);
+
+	content = get_content(md5, state);
+	if (content == NULL)
+		return 0;
+	return content->playtime;
+}
+
 static int uade_open_and_lock(const char *filename, int create)
 {
 	int fd, ret;
@@ -268,11 +315,24 @@ static struct uade_content *store_playtime(const char *md5, long playtime,
 
 void uade_free_song_db(struct uade_state *state)
 {
-	free(state->songdb.contentchecksums);
-	free(state->songdb.songstore);
+	if (!state->songdb.ccshared)
+		free(state->songdb.contentchecksums);
+	if (!state->songdb.songstoreshared)
+		free(state->songdb.songstore);
 	memset(&state->songdb, 0, sizeof state->songdb);
 }
 
+/*
+ * Make dst borrow the song.conf and content db data of src. Content db is
+ * copied on write. The owner of src must outlive dst.
+ */
+void uade_share_song_db(struct uade_songdb *dst, const struct uade_songdb *src)
+{
+	*dst = *src;
+	dst->ccshared = (dst->contentchecksums != NULL);
+	dst->songstoreshared = (dst->songstore != NULL);
+}
+
 int uade_read_content_db(const char *filename, struct uade_state *state)
 {
 	char line[1024];
@@ -297,6 +357,9 @@ int uade_read_content_db(const char *filename, struct uade_state *state)
 	int fd;
 	struct uade_content *n;
 
+	if (unshare_content_db(db))
+		return 0;
+
 	/* Try to create a database if it doesn't exist */
 	if (db->contentchecksums == NULL &&
 	    create_content_checksum(state, NULL, 0) == NULL)
@@ -392,6 +455,7 @@ int uade_read_song_conf(const char *filename, struct uade_state *state)
 	db->nsongs = 0;
 	allocated = 16;
 	db->songstore = calloc(allocated, sizeof db->songstore[0]);
+	db->songstoreshared = 0;
 	if (db->songstore == NULL) {
 		uade_warning("No memory for song store.");
 		goto error;
@@ -518,33 +582,58 @@ void uade_save_content_db(const char *filename, struct uade_state *state)
 	uade_debug(state, "uade: Saved %zd entries into content db.\n", db->nccused);
 }
 
+/* Samples whose absolute value is at least this are not silent */
+#define SILENCE_LEVEL (32767 * 1 / 100)
+/* Samples are counted in blocks, so that the inner loop is vector code */
+#define SILENCE_BLOCK 64
+
+static inline int is_loud(int16_t s)
+{
+	return (s >= SILENCE_LEVEL) | (s <= -SILENCE_LEVEL);
+}
+
+/*
+ * Counts samples that are not silent. Counting stops after the first block
+ * where the count reaches limit, because one loud part is enough.
+ */
+static size_t count_loud_samples(const int16_t *sm, size_t nsamples,
+				 size_t limit)
+{
+	size_t count = 0;
+	size_t i = 0;
+	int16_t blockcount;
+	int j;
+
+	for (; (i + SILENCE_BLOCK) <= nsamples; i += SILENCE_BLOCK) {
+		blockcount = 0;
+		for (j = 0; j < SILENCE_BLOCK; j++)
+			blockcount += is_loud(sm[i + j]);
+		count += blockcount;
+		if (count >= limit)
+			return count;
+	}
+	for (; i < nsamples; i++)
+		count += is_loud(sm[i]);
+	return count;
+}
+
 int uade_test_silence(void *buf, size_t size, struct uade_state *state)
 {
-	int i, s, exceptioncount;
-	int16_t *sm;
-	int nsamples;
+	size_t limit;
 	int64_t count = state->song.silencecount;
 	int end = 0;
 
 	if (state->config.silence_timeout < 0)
 		return 0;
 
-	exceptioncount = 0;
-	sm = buf;
-	nsamples = size / 2;
-
-	for (i = 0; i < nsamples; i++) {
-		s = (sm[i] >= 0) ? sm[i] : -sm[i];
-		if (s >= (32767 * 1 / 100)) {
-			exceptioncount++;
-			if (exceptioncount >= (size * 2 / 100)) {
-				count = 0;
-				break;
-			}
-		}
-	}
+	/* The buffer is not silent if 2% of size has loud samples */
+	limit = size * 2 / 100;
+	if (limit == 0)
+		limit = 1;
 
-	if (i == nsamples) {
+	if (count_loud_samples(buf, size / 2, limit) >= limit) {
+		count = 0;
+	} else {
 		count += size;
 		if (count / (UADE_BYTES_PER_FRAME * state->config.frequency) >= state->config.silence_timeout) {
 			count = 0;
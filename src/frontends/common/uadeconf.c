@@ -418,6 +418,7 @@ void uade_merge_configs(struct uade_config *ucd, const struct uade_config *ucs)
 	MERGE_OPTION(score_file);
 	MERGE_OPTION(silence_timeout);
 	MERGE_OPTION(speed_hack);
+	MERGE_OPTION(stems);
 	MERGE_OPTION(subsong_timeout);
 
 	MERGE_OPTION(timeout);
@@ -736,6 +737,10 @@ void uade_config_set_option(struct uade_config *uc, enum uade_option opt,
 		SET_OPTION(speed_hack, 1);
 		break;
 
+	case UC_STEMS:
+		SET_OPTION(stems, 1);
+		break;
+
 	case UC_SUBSONG_TIMEOUT_VALUE:
 		if (value == NULL) {
 			fprintf(stderr,
@@ -96,6 +96,15 @@ static void send_write_audio_file_command(struct uade_ipc *ipc,
 	}
 }
 
+static void send_trace_command(struct uade_state *state)
+{
+	if (state->traceflags == 0)
+		return;
+	if (uade_send_two_u32s(UADE_COMMAND_SET_TRACE, state->traceflags,
+			       state->tracedecimation, &state->ipc))
+		uade_warning("Can not set trace\n");
+}
+
 void uade_subsong_control(int subsong, int command, struct uade_ipc *ipc)
 {
 	assert(subsong >= 0 && subsong < 256);
@@ -179,6 +188,7 @@ int uade_song_initialization(struct uade_file *player, struct uade_file *module,
 	uade_send_filter_command(state);
 	send_resampling_command(ipc, uc);
 	send_write_audio_file_command(ipc, uc);
+	send_trace_command(state);
 
 	if (uc->speed_hack) {
 		if (uade_send_short_message(UADE_COMMAND_SPEED_HACK, ipc)) {
@@ -187,6 +197,13 @@ int uade_song_initialization(struct uade_file *player, struct uade_file *module,
 		}
 	}
 
+	if (uc->stems) {
+		if (uade_send_short_message(UADE_COMMAND_USE_STEMS, ipc)) {
+			fprintf(stderr, "Can not send stems command.\n");
+			goto cleanup;
+		}
+	}
+
 	if (uc->use_ntsc) {
 		if (uade_send_short_message(UADE_COMMAND_SET_NTSC, ipc)) {
 			fprintf(stderr, "Can not send ntsc command.\n");
@@ -76,6 +76,9 @@ static void save_content_db(struct uade_state *state)
 	struct stat st;
 	const char *fname = state->songdb.ccfilename;
 
+	if (!state->songdb.ccmodified)
+		return;
+
 	if (!fname[0] || stat(fname, &st))
 		return;
 
@@ -96,6 +99,46 @@ static int get_bytes_per_second(const struct uade_state *state)
 	return UADE_BYTES_PER_FRAME * uade_get_sampling_rate(state);
 }
 
+/*
+ * Closes the connection to uadecore and lets the pool thread wait for the
+ * process to exit. Returns 1 on success.
+ */
+static int retire_core(struct uade_state *state)
+{
+	struct uade_context *ctx = state->context;
+	pid_t *retired;
+	int ret = 0;
+
+	if (ctx == NULL || state->pid <= 0)
+		return 0;
+
+	pthread_mutex_lock(&ctx->mutex);
+	if (!ctx->poolthreadrunning)
+		goto out;
+	if (ctx->nretired == ctx->maxretired) {
+		retired = realloc(ctx->retired, (2 * ctx->maxretired + 4) *
+				  sizeof retired[0]);
+		if (retired == NULL)
+			goto out;
+		ctx->retired = retired;
+		ctx->maxretired = 2 * ctx->maxretired + 4;
+	}
+	uade_arch_close_ipc(&state->ipc);
+	ctx->retired[ctx->nretired] = state->pid;
+	ctx->nretired++;
+	state->pid = 0;
+	pthread_cond_signal(&ctx->poolcond);
+	ret = 1;
+out:
+	pthread_mutex_unlock(&ctx->mutex);
+	return ret;
+}
+
+static void reap_core(pid_t pid)
+{
+	while (waitpid(pid, NULL, 0) == -1 && errno == EINTR);
+}
+
 void uade_cleanup_state(struct uade_state *state)
 {
 	if (state == NULL)
@@ -107,9 +150,17 @@ void uade_cleanup_state(struct uade_state *state)
 
 	uade_free_song_db(state);
 
-	uade_free_playerstore(state->playerstore);
+	uade_release_playerstore(state->playerstore);
+
+	if (state->hostedmachine) {
+		/* The machine terminates when the connection is closed */
+		uade_atomic_close(state->ipc.in_fd);
+		state->hostedmachine = 0;
+	} else if (!retire_core(state)) {
+		uade_arch_kill_and_wait_uadecore(&state->ipc, &state->pid);
+	}
 
-	uade_arch_kill_and_wait_uadecore(&state->ipc, &state->pid);
+	uade_free_context(state->context);
 
 	memset(state, 0, sizeof(*state));
 
@@ -195,6 +246,56 @@ static int receive_message(struct uade_event *event, struct uade_state *state)
 
 		break;
 
+	case UADE_REPLY_STEMS:
+		event->type = UADE_EVENT_STEMS;
+		data = (uint16_t *) event->data.data;
+		assert(sizeof event->data.data >= um->size);
+		if (um->size % 8) {
+			uade_warning("Invalid stem data size: %u\n", um->size);
+			goto error;
+		}
+		event->data.size = um->size;
+		sm = (uint16_t *) um->data;
+		for (u = 0; u < um->size; u += 2)
+			*data++ = ntohs(*sm++);
+		break;
+
+	case UADE_REPLY_TRACE:
+		event->type = UADE_EVENT_TRACE;
+		assert(sizeof event->data.data >= um->size);
+		event->data.size = um->size;
+		memcpy(event->data.data, um->data, um->size);
+		break;
+
+	case UADE_REPLY_SNAPSHOT:
+		event->type = UADE_EVENT_SNAPSHOT;
+		assert(sizeof event->data.data >= um->size);
+		event->data.size = um->size;
+		memcpy(event->data.data, um->data, um->size);
+		break;
+
+	case UADE_REPLY_STATS:
+		if (um->size < 4 ||
+		    um->size - 4 != 8 * (uint64_t) read_be_u32(um->data)) {
+			uade_warning("Invalid stats size: %u\n", um->size);
+			goto error;
+		}
+		event->type = UADE_EVENT_STATS;
+		assert(sizeof event->data.data >= um->size);
+		event->data.size = um->size;
+		memcpy(event->data.data, um->data, um->size);
+		break;
+
+	case UADE_REPLY_RESTORE:
+		if (um->size != 4) {
+			uade_warning("Invalid restore reply size: %u\n", um->size);
+			goto error;
+		}
+		event->type = UADE_EVENT_RESTORE;
+		event->data.size = um->size;
+		memcpy(event->data.data, um->data, um->size);
+		break;
+
 	case UADE_REPLY_FORMATNAME:
 		event->type = UADE_EVENT_FORMAT_NAME;
 		get_string(event, um);
@@ -299,8 +400,8 @@ struct uade_file *uade_load_amiga_file(const char *name, const char *playerdir,
 	char fname[PATH_MAX];
 
 	/* Do not load file names that contain ':' from rmc container */
-	if (strchr(name, ':') == NULL && state->rmc != NULL)
-		return uade_rmc_get_file(state->rmc, name);
+	if (strchr(name, ':') == NULL && state->rmcreader != NULL)
+		return uade_rmc_reader_get_file(state->rmcreader, name);
 
 	if (uade_find_amiga_file(fname, sizeof fname, name, playerdir))
 		return NULL;
@@ -369,8 +470,13 @@ const char *uade_event_name(const struct uade_event *event)
 	EVENT_CASE(UADE_EVENT_MODULE_NAME);
 	EVENT_CASE(UADE_EVENT_PLAYER_NAME);
 	EVENT_CASE(UADE_EVENT_READY);
+	EVENT_CASE(UADE_EVENT_RESTORE);
+	EVENT_CASE(UADE_EVENT_SNAPSHOT);
+	EVENT_CASE(UADE_EVENT_STATS);
 	EVENT_CASE(UADE_EVENT_SONG_END);
+	EVENT_CASE(UADE_EVENT_STEMS);
 	EVENT_CASE(UADE_EVENT_SUBSONG_INFO);
+	EVENT_CASE(UADE_EVENT_TRACE);
 	default:
 		return "UADE_EVENT_INVALID";
 	}
@@ -395,6 +501,81 @@ static int read_request(struct uade_state *state)
 	return 0;
 }
 
+static int send_snapshot(const uint8_t *snapshot, size_t size,
+			 struct uade_state *state)
+{
+	uint8_t space[UADE_MAX_MESSAGE_SIZE];
+	struct uade_msg *um = (struct uade_msg *) space;
+	const size_t maxchunk = sizeof space - sizeof *um;
+	size_t pos = 0;
+	size_t chunk;
+
+	/* An empty chunk terminates the snapshot */
+	while (1) {
+		chunk = size - pos;
+		if (chunk > maxchunk)
+			chunk = maxchunk;
+		um->msgtype = UADE_COMMAND_RESTORE;
+		um->size = chunk;
+		memcpy(um->data, snapshot + pos, chunk);
+		if (uade_send_message(um, &state->ipc))
+			return -1;
+		if (chunk == 0)
+			return 0;
+		pos += chunk;
+	}
+}
+
+/*
+ * Restores the last RMC checkpoint of 'subsong' before the subsong position
+ * 'seekoffs', if the checkpoint is ahead of 'fromoffs'. Returns 1 if a
+ * checkpoint was restored.
+ */
+static int restore_checkpoint(int subsong, int64_t fromoffs, int64_t seekoffs,
+			      struct uade_state *state)
+{
+	const struct bencode *snapshot;
+	uint64_t cpframe;
+	int64_t cpoffs;
+	int64_t frames;
+	int frequency;
+	int rate = uade_get_sampling_rate(state);
+
+	if (state->rmc == NULL || state->song.nocheckpoints)
+		return 0;
+	frequency = uade_rmc_get_checkpoint_frequency(state->rmc);
+	if (frequency == 0)
+		return 0;
+	if (subsong == uade_rmc_get_checkpoint_default(state->rmc) &&
+	    !state->song.defaultstart)
+		return 0;
+
+	frames = seekoffs / UADE_BYTES_PER_FRAME;
+	snapshot = uade_rmc_get_checkpoint(&cpframe, state->rmc, subsong,
+					   (frames * frequency) / rate);
+	if (snapshot == NULL)
+		return 0;
+	cpoffs = (((int64_t) cpframe * rate) / frequency) * UADE_BYTES_PER_FRAME;
+	if (cpoffs <= fromoffs || cpoffs > seekoffs)
+		return 0;
+
+	if (send_snapshot((const uint8_t *) ben_str_val(snapshot),
+			  ben_str_len(snapshot), state)) {
+		uade_warning("Can not send a checkpoint to uadecore\n");
+		return 0;
+	}
+
+	uade_debug(state, "Restored the checkpoint at frame %llu of subsong %d\n",
+		   (unsigned long long) cpframe, subsong);
+	state->song.checkpointfromoffs = fromoffs;
+	state->song.info.songbytes += cpoffs - fromoffs;
+	state->song.info.subsongbytes = cpoffs;
+	state->song.silencecount = 0;
+	state->song.info.subsongs.cur = subsong;
+	memset(&state->song.endevent, 0, sizeof state->song.endevent);
+	return 1;
+}
+
 /*
  * This function directly commands the uadecore to change subsong,
  * and uade_state does a transition to a new subsong.
@@ -404,6 +585,8 @@ static void set_subsong(struct uade_state *state)
 	int cmd = (state->song.state == UADE_STATE_INITIALIZED) ?
 		UADE_COMMAND_SET_SUBSONG : UADE_COMMAND_CHANGE_SUBSONG;
 	int newsubsong = -1;
+	int defsubsong;
+	int64_t fromoffs;
 
 	if (state->song.nextsubsongtrigger) {
 		newsubsong = state->song.info.subsongs.cur + 1;
@@ -418,18 +601,45 @@ static void set_subsong(struct uade_state *state)
 		switch (state->song.seekmode) {
 		case UADE_SEEK_SUBSONG_RELATIVE:
 			state->song.seeksubsongoffs = state->song.seekoffstrigger;
-			if ((state->song.seeksubsongtrigger != state->song.info.subsongs.cur) ||
-			    (state->song.seeksubsongoffs < state->song.info.subsongbytes)) {
-				newsubsong = state->song.seeksubsongtrigger;
+			newsubsong = state->song.seeksubsongtrigger;
+			if (newsubsong != state->song.info.subsongs.cur ||
+			    state->song.restartsubsong ||
+			    state->song.seeksubsongoffs < state->song.info.subsongbytes) {
+				fromoffs = 0;
+			} else {
+				fromoffs = state->song.info.subsongbytes;
 			}
+			state->song.restartsubsong = 0;
+			if (restore_checkpoint(newsubsong, fromoffs,
+					       state->song.seeksubsongoffs, state))
+				newsubsong = -1;
+			else if (fromoffs > 0)
+				newsubsong = -1;
 			break;
 
 		case UADE_SEEK_SONG_RELATIVE:
 			state->song.seeksongoffs = state->song.seekoffstrigger;
-			if (state->song.seeksongoffs < state->song.info.songbytes) {
-				newsubsong = state->song.info.subsongs.def;
+			defsubsong = state->song.info.subsongs.def;
+			if (state->song.restartsubsong ||
+			    state->song.seeksongoffs < state->song.info.songbytes) {
+				newsubsong = defsubsong;
 				state->song.info.songbytes = 0;
+				fromoffs = 0;
+			} else if (state->song.info.subsongs.cur == defsubsong &&
+				   state->song.info.songbytes == state->song.info.subsongbytes) {
+				fromoffs = state->song.info.songbytes;
+			} else {
+				fromoffs = -1;
 			}
+			state->song.restartsubsong = 0;
+			/*
+			 * Song positions are positions of the default subsong
+			 * until it ends, so its checkpoints can be used
+			 */
+			if (fromoffs >= 0 &&
+			    restore_checkpoint(defsubsong, fromoffs,
+					       state->song.seeksongoffs, state))
+				newsubsong = -1;
 			break;
 
 		default:
@@ -713,6 +923,33 @@ static int get_pending_events(struct uade_state *state)
 	return 0;
 }
 
+/* Returns 1 if the triggered seek position is inside the event data */
+static int seek_starts_in_data(const struct uade_event *event,
+			       const struct uade_state *state)
+{
+	const struct uade_song_state *song = &state->song;
+	uint64_t end;
+
+	if (song->restartsubsong)
+		return 0;
+
+	switch (song->seekmodetrigger) {
+	case UADE_SEEK_SONG_RELATIVE:
+		end = song->info.songbytes;
+		break;
+	case UADE_SEEK_SUBSONG_RELATIVE:
+		if (song->seeksubsongtrigger != song->info.subsongs.cur)
+			return 0;
+		end = song->info.subsongbytes;
+		break;
+	default:
+		return 0;
+	}
+
+	return song->seekoffstrigger >= end - event->data.size &&
+	       song->seekoffstrigger < end;
+}
+
 static int handle_seek(struct uade_event *event, struct uade_state *state)
 {
 	ssize_t diff;
@@ -720,6 +957,25 @@ static int handle_seek(struct uade_event *event, struct uade_state *state)
 	uint64_t curoffs;
 	uint64_t seekoffs;
 
+	/*
+	 * Data that arrives while a seek is triggered was requested before the
+	 * seek. A seek to a position inside this data starts from this data.
+	 * Otherwise set_subsong() would restart the subsong. Other data is
+	 * dropped, and set_subsong() starts the seek.
+	 */
+	if (state->song.seekmodetrigger) {
+		if (!seek_starts_in_data(event, state))
+			return -1;
+		state->song.seekmode = state->song.seekmodetrigger;
+		if (state->song.seekmode == UADE_SEEK_SONG_RELATIVE)
+			state->song.seeksongoffs = state->song.seekoffstrigger;
+		else
+			state->song.seeksubsongoffs = state->song.seekoffstrigger;
+		state->song.seekmodetrigger = 0;
+		state->song.seekoffstrigger = 0;
+		state->song.seeksubsongtrigger = -1;
+	}
+
 	if (!state->song.seekmode)
 		return 0;
 
@@ -799,10 +1055,12 @@ static int handle_data(struct uade_event *event, struct uade_state *state)
 	if (handle_seek(event, state)) {
 		/*
 		 * We don't return -1 on a song end situation, because
-		 * the application must see the song end despite seeking
+		 * the application must see the song end despite seeking.
+		 * The tail before the seek position is dropped, though.
 		 */
 		if (!isend)
 			return -1;
+		event->data.size = 0;
 	}
 
 	nframes = event->data.size / UADE_BYTES_PER_FRAME;
@@ -811,6 +1069,264 @@ static int handle_data(struct uade_event *event, struct uade_state *state)
 	return 0;
 }
 
+/*
+ * Stems arrive before the sample data they belong to. They are kept if the
+ * sample data is passed to the application. 'bytes' is the number of
+ * sample bytes that are passed, or 0 if sample data is dropped.
+ */
+static void commit_stems(size_t bytes, struct uade_state *state)
+{
+	size_t keep = (bytes / UADE_BYTES_PER_FRAME) * UADE_STEM_FRAME_SIZE;
+	if (state->stemspending > keep)
+		fifo_erase_tail(state->stems, state->stemspending - keep);
+	state->stemspending = 0;
+}
+
+static void handle_stems(struct uade_event *event, struct uade_state *state)
+{
+	if (state->stems == NULL) {
+		state->stems = fifo_create();
+		if (state->stems == NULL)
+			uade_die("No memory for stems fifo\n");
+	}
+	if (fifo_write(state->stems, event->data.data, event->data.size))
+		uade_die("No memory for stems\n");
+	state->stemspending += event->data.size;
+}
+
+size_t uade_read_stems(int16_t *data, size_t frames, struct uade_state *state)
+{
+	if (state->stems == NULL)
+		return 0;
+	return fifo_read(data, frames * UADE_STEM_FRAME_SIZE, state->stems) /
+		UADE_STEM_FRAME_SIZE;
+}
+
+/*
+ * Unread trace records beyond this many bytes are dropped and counted, see
+ * uade_get_trace_dropped()
+ */
+#define TRACE_FIFO_LIMIT (1 << 24)
+
+static void handle_trace(struct uade_event *event, struct uade_state *state)
+{
+	struct uade_trace_record r;
+	uint8_t *p = event->data.data;
+	uint8_t *end = p + event->data.size;
+	uint64_t endframe = UINT64_MAX;
+	size_t recsize;
+
+	if (state->traceflags == 0 || state->song.seekmode)
+		return;
+
+	/* Records after the song end describe frames that are cut off */
+	if (state->song.state == UADE_STATE_SONG_END_PENDING) {
+		endframe = (state->song.info.songbytes +
+			    state->song.endevent.songend.tailbytes) /
+			UADE_BYTES_PER_FRAME;
+	}
+
+	if (state->trace == NULL) {
+		state->trace = fifo_create();
+		if (state->trace == NULL) {
+			uade_warning("No memory for trace fifo\n");
+			return;
+		}
+	}
+
+	while (p < end) {
+		memset(&r, 0, sizeof r);
+		r.type = p[0];
+		switch (r.type) {
+		case UADE_TRACE_RECORD_OUTPUT:
+			recsize = UADE_TRACE_OUTPUT_WIRE_SIZE;
+			break;
+		case UADE_TRACE_RECORD_EVENT:
+			recsize = UADE_TRACE_EVENT_WIRE_SIZE;
+			break;
+		default:
+			uade_warning("Invalid trace record: %d\n", r.type);
+			return;
+		}
+		if ((size_t) (end - p) < recsize) {
+			uade_warning("Truncated trace record\n");
+			return;
+		}
+		r.frame = read_be_u32(p + 1);
+		if (r.type == UADE_TRACE_RECORD_OUTPUT) {
+			r.outputs[0] = read_be_u16(p + 5);
+			r.outputs[1] = read_be_u16(p + 7);
+			r.outputs[2] = read_be_u16(p + 9);
+			r.outputs[3] = read_be_u16(p + 11);
+		} else {
+			r.channel = p[5] >> 4;
+			r.event = p[5] & 0xf;
+			r.value = read_be_u16(p + 6);
+		}
+		p += recsize;
+
+		if (r.frame >= endframe)
+			return;
+		if (fifo_len(state->trace) >= TRACE_FIFO_LIMIT) {
+			if (state->song.tracedropped == 0)
+				uade_warning("Trace records are not read. Dropping new records.\n");
+			state->song.tracedropped++;
+			continue;
+		}
+		if (fifo_write(state->trace, &r, sizeof r)) {
+			uade_warning("No memory for trace records\n");
+			return;
+		}
+	}
+}
+
+int uade_set_trace(unsigned int flags, unsigned int decimation,
+		   struct uade_state *state)
+{
+	if ((flags & ~(UADE_TRACE_OUTPUTS | UADE_TRACE_EVENTS)) ||
+	    decimation == 0)
+		return -1;
+	state->traceflags = flags;
+	state->tracedecimation = decimation;
+	return 0;
+}
+
+size_t uade_read_trace(struct uade_trace_record *records, size_t maxrecords,
+		       struct uade_state *state)
+{
+	size_t n;
+	if (state->trace == NULL)
+		return 0;
+	n = fifo_len(state->trace) / sizeof records[0];
+	if (n > maxrecords)
+		n = maxrecords;
+	fifo_read(records, n * sizeof records[0], state->trace);
+	return n;
+}
+
+uint64_t uade_get_trace_dropped(const struct uade_state *state)
+{
+	return state->song.tracedropped;
+}
+
+static int handle_snapshot(struct uade_event *event, struct uade_state *state)
+{
+	size_t size;
+
+	if (state->snapshot == NULL) {
+		state->snapshot = fifo_create();
+		if (state->snapshot == NULL) {
+			uade_warning("No memory for snapshot fifo\n");
+			return -1;
+		}
+	}
+	if (event->data.size > 0) {
+		if (fifo_write(state->snapshot, event->data.data,
+			       event->data.size)) {
+			uade_warning("No memory for snapshot\n");
+			return -1;
+		}
+		return 0;
+	}
+
+	/* An empty chunk completes the snapshot */
+	free(state->snapshotdata);
+	size = fifo_len(state->snapshot);
+	state->snapshotdata = malloc(size > 0 ? size : 1);
+	if (state->snapshotdata == NULL) {
+		uade_warning("No memory for snapshot\n");
+		return -1;
+	}
+	fifo_read(state->snapshotdata, size, state->snapshot);
+	state->snapshotsize = size;
+	state->snapshotpos = state->song.info.subsongbytes;
+	return 0;
+}
+
+static void handle_stats(struct uade_event *event, struct uade_state *state)
+{
+	uint64_t *counters = (uint64_t *) &state->song.stats;
+	size_t n = read_be_u32(event->data.data);
+	uint8_t *p = event->data.data + 4;
+	size_t i;
+
+	/* Counters of a newer uadecore are ignored */
+	if (n > sizeof state->song.stats / sizeof counters[0])
+		n = sizeof state->song.stats / sizeof counters[0];
+	memset(&state->song.stats, 0, sizeof state->song.stats);
+	for (i = 0; i < n; i++) {
+		counters[i] = ((uint64_t) read_be_u32(p) << 32) |
+			      read_be_u32(p + 4);
+		p += 8;
+	}
+	state->song.havestats = 1;
+}
+
+static void handle_restore(struct uade_event *event, struct uade_state *state)
+{
+	if (read_be_u32(event->data.data) == 1)
+		return;
+
+	/*
+	 * uadecore kept playing from the old position. A forward seek in the
+	 * same subsong continues from there. Otherwise the subsong is
+	 * restarted at the next seek.
+	 */
+	uade_warning("uadecore rejected an RMC checkpoint\n");
+	state->song.nocheckpoints = 1;
+	state->song.info.songbytes -= state->song.info.subsongbytes -
+		state->song.checkpointfromoffs;
+	state->song.info.subsongbytes = state->song.checkpointfromoffs;
+	if (state->song.checkpointfromoffs == 0) {
+		state->song.restartsubsong = 1;
+		if (state->song.seekmode == UADE_SEEK_SONG_RELATIVE)
+			set_subsong_and_seek(UADE_SEEK_SONG_RELATIVE, 0,
+					     state->song.seeksongoffs, state);
+		else
+			set_subsong_and_seek(UADE_SEEK_SUBSONG_RELATIVE,
+					     state->song.info.subsongs.cur,
+					     state->song.seeksubsongoffs, state);
+	}
+}
+
+int uade_request_snapshot(struct uade_state *state)
+{
+	struct uade_msg um = {.msgtype = UADE_COMMAND_SNAPSHOT, .size = 0};
+	if (state->song.state == UADE_STATE_INVALID)
+		return -1;
+	return queue_command(state, &um, sizeof um);
+}
+
+void *uade_get_snapshot(size_t *size, int64_t *subsongbytes,
+			struct uade_state *state)
+{
+	void *snapshot = state->snapshotdata;
+	if (snapshot == NULL)
+		return NULL;
+	*size = state->snapshotsize;
+	if (subsongbytes != NULL)
+		*subsongbytes = state->snapshotpos;
+	state->snapshotdata = NULL;
+	state->snapshotsize = 0;
+	return snapshot;
+}
+
+int uade_request_stats(struct uade_state *state)
+{
+	struct uade_msg um = {.msgtype = UADE_COMMAND_GET_STATS, .size = 0};
+	if (state->song.state == UADE_STATE_INVALID)
+		return -1;
+	return queue_command(state, &um, sizeof um);
+}
+
+int uade_get_stats(struct uade_stats *stats, const struct uade_state *state)
+{
+	if (!state->song.havestats)
+		return -1;
+	*stats = state->song.stats;
+	return 0;
+}
+
 static int test_set_debug(struct uade_state *state)
 {
 	if (!state->setdebug)
@@ -839,10 +1355,17 @@ static int receive_messages(struct uade_event *event, struct uade_state *state)
 			break;
 
 		case UADE_EVENT_DATA:
-			if (handle_data(event, state))
+			if (handle_data(event, state)) {
+				commit_stems(0, state);
 				break;
+			}
+			commit_stems(event->data.size, state);
 			return 0;
 
+		case UADE_EVENT_STEMS:
+			handle_stems(event, state);
+			break;
+
 		case UADE_EVENT_READY:
 			ASSERT_SEND_STATE(state);
 
@@ -868,6 +1391,23 @@ static int receive_messages(struct uade_event *event, struct uade_state *state)
 				return error_state(state);
 			break;
 
+		case UADE_EVENT_SNAPSHOT:
+			if (handle_snapshot(event, state))
+				return error_state(state);
+			break;
+
+		case UADE_EVENT_RESTORE:
+			handle_restore(event, state);
+			break;
+
+		case UADE_EVENT_STATS:
+			handle_stats(event, state);
+			break;
+
+		case UADE_EVENT_TRACE:
+			handle_trace(event, state);
+			break;
+
 		default:
 			if (state->song.state != UADE_STATE_SONG_END_PENDING)
 				return 0;
@@ -1088,24 +1628,367 @@ ssize_t uade_read(void *_data, size_t bytes, struct uade_state *state)
 	return copied;
 }
 
-struct uade_state *uade_new_state(const struct uade_config *extraconfig)
+/* Sets the uadecore and uaerc files, and merges extra config */
+static void set_core_files(struct uade_state *state)
 {
-	struct uade_state *state;
-	DIR *bd;
 	char path[PATH_MAX];
+
+	uade_config_set_option(&state->config, UC_UADECORE_FILE,
+			       UADE_CONFIG_UADE_CORE);
+
+	snprintf(path, sizeof path, "%s/uaerc", state->config.basedir.name);
+	uade_config_set_option(&state->config, UC_UAE_CONFIG_FILE, path);
+
+	uade_merge_configs(&state->config, &state->extraconfig);
+}
+
+static int spawn_core(struct uade_ipc *ipc, pid_t *pid,
+		      const char *uadecorefile, const char *uaercfile)
+{
+	if (uade_arch_spawn(ipc, pid, uadecorefile)) {
+		uade_warning("Can not spawn uade: %s\n", uadecorefile);
+		return -1;
+	}
+
+	if (uade_send_string(UADE_COMMAND_CONFIG, uaercfile, ipc)) {
+		uade_warning("Can not send config name: %s\n", strerror(errno));
+		uade_arch_kill_and_wait_uadecore(ipc, pid);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Reaps the retired uadecores that have already exited, so that they do not
+ * pile up as zombies while the pool is not full. Called with ctx->mutex
+ * held.
+ */
+static void reap_exited_cores(struct uade_context *ctx)
+{
+	pid_t ret;
+	int i = 0;
+
+	while (i < ctx->nretired) {
+		ret = waitpid(ctx->retired[i], NULL, WNOHANG);
+		if (ret == 0 || (ret < 0 && errno == EINTR)) {
+			i++;
+			continue;
+		}
+		ctx->nretired--;
+		ctx->retired[i] = ctx->retired[ctx->nretired];
+	}
+}
+
+static void *pool_thread(void *arg)
+{
+	struct uade_context *ctx = arg;
+	struct uade_pooled_core core;
+	struct timespec ts;
+	int ret;
+
+	pid_t pid;
+
+	pthread_mutex_lock(&ctx->mutex);
+	while (!ctx->poolquit) {
+		reap_exited_cores(ctx);
+		if (ctx->npooled >= ctx->poolsize) {
+			if (ctx->nretired == 0) {
+				pthread_cond_wait(&ctx->poolcond, &ctx->mutex);
+				continue;
+			}
+			ctx->nretired--;
+			pid = ctx->retired[ctx->nretired];
+			pthread_mutex_unlock(&ctx->mutex);
+			reap_core(pid);
+			pthread_mutex_lock(&ctx->mutex);
+			continue;
+		}
+
+		pthread_mutex_unlock(&ctx->mutex);
+		memset(&core, 0, sizeof core);
+		ret = spawn_core(&core.ipc, &core.pid, ctx->uadecorefile,
+				 ctx->uaercfile);
+		pthread_mutex_lock(&ctx->mutex);
+
+		if (ret) {
+			ctx->poolstats.failures++;
+			/* Do not spin if uadecore can not be started */
+			clock_gettime(CLOCK_REALTIME, &ts);
+			ts.tv_sec++;
+			pthread_cond_timedwait(&ctx->poolcond, &ctx->mutex,
+					       &ts);
+			continue;
+		}
+
+		ctx->poolstats.spawned++;
+		if (ctx->poolquit || ctx->npooled >= ctx->poolsize) {
+			pthread_mutex_unlock(&ctx->mutex);
+			uade_arch_kill_and_wait_uadecore(&core.ipc, &core.pid);
+			pthread_mutex_lock(&ctx->mutex);
+			continue;
+		}
+		ctx->pool[ctx->npooled] = core;
+		ctx->npooled++;
+	}
+	pthread_mutex_unlock(&ctx->mutex);
+	return NULL;
+}
+
+/* Takes a warm uadecore from the pool. Returns 1 on success. */
+static int checkout_core(struct uade_state *state)
+{
+	struct uade_context *ctx = state->context;
+	int hit = 0;
+
+	pthread_mutex_lock(&ctx->mutex);
+	if (ctx->npooled > 0 &&
+	    strcmp(state->config.uadecore_file.name, ctx->uadecorefile) == 0 &&
+	    strcmp(state->config.uae_config_file.name, ctx->uaercfile) == 0) {
+		ctx->npooled--;
+		state->ipc = ctx->pool[ctx->npooled].ipc;
+		state->pid = ctx->pool[ctx->npooled].pid;
+		ctx->poolstats.hits++;
+		hit = 1;
+		pthread_cond_signal(&ctx->poolcond);
+	} else {
+		ctx->poolstats.misses++;
+	}
+	pthread_mutex_unlock(&ctx->mutex);
+	return hit;
+}
+
+/* Starts a machine in the machine host of the context. Returns 1 on success. */
+static int connect_machine(struct uade_state *state)
+{
+	struct uade_context *ctx = state->context;
+	int ret;
+
+	pthread_mutex_lock(&ctx->mutex);
+	if (ctx->hostpid <= 0 ||
+	    strcmp(state->config.uadecore_file.name, ctx->uadecorefile) != 0) {
+		pthread_mutex_unlock(&ctx->mutex);
+		return 0;
+	}
+	ret = uade_arch_connect_machine(&state->ipc, ctx->hostfd);
+	pthread_mutex_unlock(&ctx->mutex);
+	if (ret)
+		return 0;
+
+	if (uade_send_string(UADE_COMMAND_CONFIG,
+			     state->config.uae_config_file.name, &state->ipc)) {
+		uade_warning("Can not send config name: %s\n", strerror(errno));
+		uade_atomic_close(state->ipc.in_fd);
+		return 0;
+	}
+	state->hostedmachine = 1;
+	return 1;
+}
+
+int uade_context_start_machine_host(struct uade_context *ctx)
+{
+	int ret = 0;
+
+	pthread_mutex_lock(&ctx->mutex);
+	if (ctx->hostpid <= 0 &&
+	    uade_arch_spawn_host(&ctx->hostfd, &ctx->hostpid,
+				 ctx->uadecorefile)) {
+		uade_warning("Can not spawn a machine host: %s\n",
+			     ctx->uadecorefile);
+		ctx->hostpid = 0;
+		ret = -1;
+	}
+	pthread_mutex_unlock(&ctx->mutex);
+	return ret;
+}
+
+int uade_context_set_pool_size(struct uade_context *ctx, int size)
+{
+	struct uade_pooled_core *pool;
+	struct uade_pooled_core core;
+	int ret = 0;
+
+	if (size < 0)
+		return -1;
+
+	pthread_mutex_lock(&ctx->mutex);
+
+	if (size > ctx->poolsize) {
+		pool = realloc(ctx->pool, size * sizeof pool[0]);
+		if (pool == NULL) {
+			ret = -1;
+			goto out;
+		}
+		ctx->pool = pool;
+	}
+	ctx->poolsize = size;
+
+	while (ctx->npooled > size) {
+		ctx->npooled--;
+		core = ctx->pool[ctx->npooled];
+		pthread_mutex_unlock(&ctx->mutex);
+		uade_arch_kill_and_wait_uadecore(&core.ipc, &core.pid);
+		pthread_mutex_lock(&ctx->mutex);
+	}
+
+	if (size > 0 && !ctx->poolthreadrunning) {
+		if (pthread_create(&ctx->poolthread, NULL, pool_thread, ctx)) {
+			uade_warning("Can not create uadecore pool thread\n");
+			ret = -1;
+			goto out;
+		}
+		ctx->poolthreadrunning = 1;
+	}
+	pthread_cond_signal(&ctx->poolcond);
+
+out:
+	pthread_mutex_unlock(&ctx->mutex);
+	return ret;
+}
+
+void uade_context_get_pool_stats(struct uade_pool_stats *stats,
+				 struct uade_context *ctx)
+{
+	pthread_mutex_lock(&ctx->mutex);
+	*stats = ctx->poolstats;
+	stats->idle = ctx->npooled;
+	pthread_mutex_unlock(&ctx->mutex);
+}
+
+struct uade_context *uade_new_context(const struct uade_config *extraconfig)
+{
+	struct uade_context *ctx;
+	struct uade_state *tmp;
 	const char *basedir;
 
-	state = calloc(1, sizeof *state);
-	if (!state)
+	ctx = calloc(1, sizeof *ctx);
+	/* Config files are loaded with the same code as for states */
+	tmp = calloc(1, sizeof *tmp);
+	if (ctx == NULL || tmp == NULL) {
+		free(ctx);
+		free(tmp);
 		return NULL;
+	}
 
 	basedir = NULL;
 	if (extraconfig != NULL && extraconfig->basedir_set)
 		basedir = extraconfig->basedir.name;
 
-	if (!uade_load_initial_config(state, basedir))
+	if (!uade_load_initial_config(tmp, basedir))
 		uade_warning("uadeconfig not loaded\n");
 
+	if (extraconfig)
+		tmp->extraconfig = *extraconfig;
+	else
+		uade_config_set_defaults(&tmp->extraconfig);
+
+	prepare_configs(tmp);
+
+	uade_load_initial_song_conf(tmp);
+	load_content_db(tmp);
+
+	ctx->validconfig = tmp->validconfig;
+	ctx->permconfig = tmp->permconfig;
+	strlcpy(ctx->permconfigname, tmp->permconfigname,
+		sizeof ctx->permconfigname);
+	ctx->songdb = tmp->songdb;
+	strlcpy(ctx->songdbname, tmp->songdbname, sizeof ctx->songdbname);
+	ctx->playerstore = uade_acquire_playerstore(tmp->config.basedir.name);
+
+	set_core_files(tmp);
+	strlcpy(ctx->uadecorefile, tmp->config.uadecore_file.name,
+		sizeof ctx->uadecorefile);
+	strlcpy(ctx->uaercfile, tmp->config.uae_config_file.name,
+		sizeof ctx->uaercfile);
+
+	pthread_mutex_init(&ctx->mutex, NULL);
+	pthread_cond_init(&ctx->poolcond, NULL);
+	ctx->refcount = 1;
+
+	free(tmp);
+	return ctx;
+}
+
+void uade_free_context(struct uade_context *ctx)
+{
+	int refcount;
+
+	if (ctx == NULL)
+		return;
+
+	pthread_mutex_lock(&ctx->mutex);
+	assert(ctx->refcount > 0);
+	ctx->refcount--;
+	refcount = ctx->refcount;
+	pthread_mutex_unlock(&ctx->mutex);
+	if (refcount > 0)
+		return;
+
+	if (ctx->poolthreadrunning) {
+		pthread_mutex_lock(&ctx->mutex);
+		ctx->poolquit = 1;
+		pthread_cond_signal(&ctx->poolcond);
+		pthread_mutex_unlock(&ctx->mutex);
+		pthread_join(ctx->poolthread, NULL);
+	}
+	while (ctx->nretired > 0) {
+		ctx->nretired--;
+		reap_core(ctx->retired[ctx->nretired]);
+	}
+	free(ctx->retired);
+	while (ctx->npooled > 0) {
+		ctx->npooled--;
+		uade_arch_kill_and_wait_uadecore(&ctx->pool[ctx->npooled].ipc,
+						 &ctx->pool[ctx->npooled].pid);
+	}
+	free(ctx->pool);
+	pthread_cond_destroy(&ctx->poolcond);
+
+	if (ctx->hostpid > 0) {
+		/* The host exits after its machines have terminated */
+		uade_atomic_close(ctx->hostfd);
+		reap_core(ctx->hostpid);
+	}
+
+	uade_release_playerstore(ctx->playerstore);
+	free(ctx->songdb.contentchecksums);
+	free(ctx->songdb.songstore);
+	pthread_mutex_destroy(&ctx->mutex);
+	memset(ctx, 0, sizeof(*ctx));
+	free(ctx);
+}
+
+struct uade_state *uade_new_state(const struct uade_config *extraconfig)
+{
+	struct uade_state *state;
+	struct uade_context *ctx = uade_new_context(extraconfig);
+	if (ctx == NULL)
+		return NULL;
+	state = uade_new_state_from_context(ctx, extraconfig);
+	/* The state holds its own reference */
+	uade_free_context(ctx);
+	return state;
+}
+
+struct uade_state *uade_new_state_from_context(
+	struct uade_context *ctx, const struct uade_config *extraconfig)
+{
+	struct uade_state *state;
+	DIR *bd;
+
+	state = calloc(1, sizeof *state);
+	if (!state)
+		return NULL;
+
+	pthread_mutex_lock(&ctx->mutex);
+	ctx->refcount++;
+	pthread_mutex_unlock(&ctx->mutex);
+	state->context = ctx;
+
+	state->validconfig = ctx->validconfig;
+	state->permconfig = ctx->permconfig;
+	strlcpy(state->permconfigname, ctx->permconfigname,
+		sizeof state->permconfigname);
+
 	if (extraconfig)
 		state->extraconfig = *extraconfig;
 	else
@@ -1113,8 +1996,8 @@ struct uade_state *uade_new_state(const struct uade_config *extraconfig)
 
 	prepare_configs(state);
 
-	uade_load_initial_song_conf(state);
-	load_content_db(state);
+	uade_share_song_db(&state->songdb, &ctx->songdb);
+	strlcpy(state->songdbname, ctx->songdbname, sizeof state->songdbname);
 
 	bd = opendir(state->config.basedir.name);
 	if (bd == NULL) {
@@ -1124,13 +2007,7 @@ struct uade_state *uade_new_state(const struct uade_config *extraconfig)
 	}
 	closedir(bd);
 
-	uade_config_set_option(&state->config, UC_UADECORE_FILE,
-			       UADE_CONFIG_UADE_CORE);
-
-	snprintf(path, sizeof path, "%s/uaerc", state->config.basedir.name);
-	uade_config_set_option(&state->config, UC_UAE_CONFIG_FILE, path);
-
-	uade_merge_configs(&state->config, &state->extraconfig);
+	set_core_files(state);
 
 	/* TODO: Remove this, but make uadecore respond with a HELLO message. */
 	if (access(state->config.uadecore_file.name, X_OK)) {
@@ -1144,17 +2021,11 @@ struct uade_state *uade_new_state(const struct uade_config *extraconfig)
 		goto error;
 	}
 
-	if (uade_arch_spawn(&state->ipc, &state->pid,
-			    state->config.uadecore_file.name)) {
-		uade_warning("Can not spawn uade: %s\n",
-			     state->config.uadecore_file.name);
+	if (!connect_machine(state) && !checkout_core(state) &&
+	    spawn_core(&state->ipc, &state->pid,
+		       state->config.uadecore_file.name,
+		       state->config.uae_config_file.name))
 		goto error;
-	}
-
-	if (uade_send_string(UADE_COMMAND_CONFIG, state->config.uae_config_file.name, &state->ipc)) {
-		uade_warning("Can not send config name: %s\n", strerror(errno));
-		goto error;
-	}
 
 	return state;
 
@@ -1253,7 +2124,8 @@ static struct eagleplayer *get_eagleplayer(struct uade_file *module,
 	return detectioninfo->ep;
 }
 
-static int uade_play_internal(struct uade_file *module, int subsong,
+static int uade_play_internal(struct uade_file *module,
+			      struct uade_rmc_reader *rmcreader, int subsong,
 			      struct uade_state *state)
 {
 	struct eagleplayer *ep;
@@ -1265,9 +2137,10 @@ static int uade_play_internal(struct uade_file *module, int subsong,
 
 	memset(song, 0, sizeof song[0]);
 	song->state = UADE_STATE_INVALID;
+	song->defaultstart = (subsong < 0);
 
 	/* TODO: Fix this, passing module == NULL makes no sense */
-	if (module == NULL)
+	if (module == NULL && rmcreader == NULL)
 		return -1;
 
 	song->recordsongtime = 1;
@@ -1277,13 +2150,19 @@ static int uade_play_internal(struct uade_file *module, int subsong,
 		set_subsong_and_seek(UADE_SEEK_SUBSONG_RELATIVE, subsong, 0,
 				     state);
 
-	if (uade_is_rmc(module->data, module->size)) {
-		state->rmc = uade_rmc_decode(module->data, module->size);
-		if (state->rmc == NULL)
-			goto recoverableerror;
+	if (module != NULL && uade_is_rmc(module->data, module->size)) {
+		/* The reader takes the module data */
+		rmcreader = uade_rmc_open_buffer(module->data, module->size);
+		module->data = NULL;
 		uade_file_free(module);
 		module = NULL;
-		if (uade_rmc_get_module(&module, state->rmc))
+		if (rmcreader == NULL)
+			goto recoverableerror;
+	}
+	if (rmcreader != NULL) {
+		state->rmcreader = rmcreader;
+		state->rmc = uade_rmc_reader_get_rmc(rmcreader);
+		if (uade_rmc_reader_get_module(&module, rmcreader))
 			goto recoverableerror;
 	}
 
@@ -1434,12 +2313,23 @@ recoverableerror:
 
 int uade_play(const char *fname, int subsong, struct uade_state *state)
 {
-	return uade_play_internal(uade_file_load(fname), subsong, state);
+	struct uade_rmc_reader *rmcreader;
+	if (uade_is_rmc_file(fname)) {
+		/* Only the requested files are read from the container */
+		rmcreader = uade_rmc_open(fname);
+		if (rmcreader == NULL) {
+			uade_warning("Invalid RMC file: %s\n", fname);
+			return 0;
+		}
+		return uade_play_internal(NULL, rmcreader, subsong, state);
+	}
+	return uade_play_internal(uade_file_load(fname), NULL, subsong, state);
 }
 
 int uade_play_from_buffer(const char *fname, const void *data, size_t size, int subsong, struct uade_state *state)
 {
-	return uade_play_internal(uade_file(fname, data, size), subsong, state);
+	return uade_play_internal(uade_file(fname, data, size), NULL, subsong,
+				  state);
 }
 
 void uade_set_debug(struct uade_state *state)
@@ -1474,7 +2364,8 @@ int uade_set_song_options(const char *songfile, const char *songoptions,
 
 int uade_stop(struct uade_state *state)
 {
-	ben_free(state->rmc);
+	uade_rmc_close(state->rmcreader);
+	state->rmcreader = NULL;
 	state->rmc = NULL;
 
 	fifo_free(state->readstash);
@@ -1487,6 +2378,19 @@ int uade_stop(struct uade_state *state)
 	fifo_free(state->write_queue);
 	state->write_queue = NULL;
 
+	fifo_free(state->trace);
+	state->trace = NULL;
+
+	fifo_free(state->snapshot);
+	state->snapshot = NULL;
+	free(state->snapshotdata);
+	state->snapshotdata = NULL;
+	state->snapshotsize = 0;
+
+	fifo_free(state->stems);
+	state->stems = NULL;
+	state->stemspending = 0;
+
 	if (state->song.state == UADE_STATE_INVALID)
 		return 0;
 
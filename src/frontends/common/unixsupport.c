@@ -20,6 +20,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -36,6 +37,31 @@ int uade_filesize(size_t *size, const char *pathname)
 	return 0;
 }
 
+void *uade_map_file(size_t *size, const char *pathname)
+{
+	struct stat st;
+	void *data;
+	int fd = open(pathname, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+		close(fd);
+		return NULL;
+	}
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return NULL;
+	*size = st.st_size;
+	return data;
+}
+
+void uade_unmap_file(void *data, size_t size)
+{
+	if (data != NULL)
+		munmap(data, size);
+}
+
 static int uade_amiga_scandir(char *real, char *dirname, char *fake, int ml)
 {
 	DIR *dir;
@@ -198,13 +224,26 @@ int uade_find_amiga_file(char *realname, size_t maxlen, const char *aname,
 	return 0;
 }
 
+void uade_arch_close_ipc(struct uade_ipc *ipc)
+{
+	/*
+	 * Close a shared socket only once. Another thread may already have
+	 * been given the same descriptor number after the first close.
+	 */
+	if (ipc->out_fd >= 0 && ipc->out_fd != ipc->in_fd)
+		uade_atomic_close(ipc->out_fd);
+	if (ipc->in_fd >= 0)
+		uade_atomic_close(ipc->in_fd);
+	ipc->in_fd = -1;
+	ipc->out_fd = -1;
+}
+
 void uade_arch_kill_and_wait_uadecore(struct uade_ipc *ipc, pid_t *uadepid)
 {
 	if (*uadepid == 0)
 		return;
 
-	uade_atomic_close(ipc->in_fd);
-	uade_atomic_close(ipc->out_fd);
+	uade_arch_close_ipc(ipc);
 
 	/*
 	 * Wait until one of two happens:
@@ -216,7 +255,13 @@ void uade_arch_kill_and_wait_uadecore(struct uade_ipc *ipc, pid_t *uadepid)
 	*uadepid = 0;
 }
 
-int uade_arch_spawn(struct uade_ipc *ipc, pid_t *uadepid, const char *uadename)
+/*
+ * Executes uadecore with one end of a new socketpair. The other end is
+ * returned in *fd. A host uadecore runs machines for connections that are
+ * sent through the socket, see uade_arch_connect_machine().
+ */
+static int spawn_uadecore(int *fd, pid_t *uadepid, const char *uadename,
+			  int host)
 {
 	int fds[2];
 	char input[32], output[32];
@@ -263,7 +308,10 @@ int uade_arch_spawn(struct uade_ipc *ipc, pid_t *uadepid, const char *uadename)
 		snprintf(input, sizeof input, "%d", fds[1]);
 		snprintf(output, sizeof output, "%d", fds[1]);
 
-		execlp(uadename, uadename, "-i", input, "-o", output, NULL);
+		if (host)
+			execlp(uadename, uadename, "-m", input, NULL);
+		else
+			execlp(uadename, uadename, "-i", input, "-o", output, NULL);
 		uade_die("uade execlp (%s) failed: %s\n",
 			 uadename, strerror(errno));
 	}
@@ -276,6 +324,69 @@ int uade_arch_spawn(struct uade_ipc *ipc, pid_t *uadepid, const char *uadename)
 		return -1;
 	}
 
+	*fd = fds[0];
+	return 0;
+}
+
+int uade_arch_spawn(struct uade_ipc *ipc, pid_t *uadepid, const char *uadename)
+{
+	int fd;
+
+	if (spawn_uadecore(&fd, uadepid, uadename, 0))
+		return -1;
+	uade_set_peer(ipc, 1, fd, fd);
+	return 0;
+}
+
+int uade_arch_spawn_host(int *hostfd, pid_t *uadepid, const char *uadename)
+{
+	return spawn_uadecore(hostfd, uadepid, uadename, 1);
+}
+
+int uade_arch_connect_machine(struct uade_ipc *ipc, int hostfd)
+{
+	int fds[2];
+	char byte = 0;
+	struct iovec iov = {.iov_base = &byte, .iov_len = 1};
+	union {
+		char buf[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} control;
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = control.buf,
+		.msg_controllen = sizeof control.buf,
+	};
+	struct cmsghdr *cmsg;
+	ssize_t ret;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds)) {
+		uade_warning("Can not create socketpair: %s\n",
+			     strerror(errno));
+		return -1;
+	}
+
+	memset(&control, 0, sizeof control);
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &fds[1], sizeof fds[1]);
+
+	do {
+		ret = sendmsg(hostfd, &msg, MSG_NOSIGNAL);
+	} while (ret < 0 && errno == EINTR);
+
+	/* The host has its own copy of the descriptor */
+	uade_atomic_close(fds[1]);
+	if (ret != 1) {
+		uade_warning("Can not send a connection to the machine host: %s\n",
+			     strerror(errno));
+		uade_atomic_close(fds[0]);
+		return -1;
+	}
+
 	uade_set_peer(ipc, 1, fds[0], fds[0]);
 	return 0;
 }
@@ -6,6 +6,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <limits.h>
+#include <time.h>
 
 /*
  * We maintain alphabetical order even if that forces us to renumber bits
@@ -64,11 +65,26 @@ struct eagleplayermap {
 	struct eagleplayer *player;
 };
 
+/*
+ * Eagleplayer stores are immutable after loading. They are shared by all
+ * uade_states of the process that use the same eagleplayer.conf, see
+ * uade_acquire_playerstore().
+ */
 struct eagleplayerstore {
 	size_t nplayers;
 	struct eagleplayer *players;
 	size_t nextensions;
 	struct eagleplayermap *map;
+
+	/* Open addressing hash table of extensions. Size is a power of 2. */
+	size_t tablesize;
+	struct eagleplayermap **table;
+
+	/* Members for the process-wide store list */
+	char *filename;
+	time_t mtime;
+	int refcount;
+	struct eagleplayerstore *next;
 };
 
 struct epconfattr {
@@ -87,7 +103,8 @@ int uade_analyze_eagleplayer(struct uade_detection_info *detectioninfo,
 			     const char *fname, size_t fsize,
 			     struct uade_state *state);
 
-void uade_free_playerstore(struct eagleplayerstore *state);
+struct eagleplayerstore *uade_acquire_playerstore(const char *basedir);
+void uade_release_playerstore(struct eagleplayerstore *ps);
 
 int uade_set_config_options_from_flags(struct uade_state *state, int flags);
 
@@ -24,18 +24,22 @@ struct uade_songdb {
 	size_t nccalloc;      /* number of allocated entries for content db */
 	int ccmodified;
 	int cccorrupted;
+	int ccshared;         /* contentchecksums is owned by a uade_context */
 	time_t ccloadtime;
 	char ccfilename[PATH_MAX];
 
 	size_t nsongs;
 	struct eaglesong *songstore;
+	int songstoreshared;  /* songstore is owned by a uade_context */
 };
 
 struct uade_state;
 
 struct uade_content *uade_add_playtime(struct uade_state *state, const char *md5, uint32_t playtime);
 void uade_free_song_db(struct uade_state *state);
+void uade_share_song_db(struct uade_songdb *dst, const struct uade_songdb *src);
 void uade_lookup_song(const struct uade_file *module, struct uade_state *state);
+uint32_t uade_lookup_playtime(const struct uade_file *module, struct uade_state *state);
 int uade_read_content_db(const char *filename, struct uade_state *state);
 int uade_read_song_conf(const char *filename, struct uade_state *state);
 void uade_save_content_db(const char *filename, struct uade_state *state);
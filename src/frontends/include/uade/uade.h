@@ -41,6 +41,10 @@ extern "C"
 #define UADE_BYTES_PER_SAMPLE 2
 #define UADE_BYTES_PER_FRAME (UADE_CHANNELS * UADE_BYTES_PER_SAMPLE)
 
+/* Stem frames have a sample for each of the four Paula channels */
+#define UADE_STEM_CHANNELS 4
+#define UADE_STEM_FRAME_SIZE (UADE_STEM_CHANNELS * UADE_BYTES_PER_SAMPLE)
+
 struct uade_file {
 	char *name;  /* filename */
 	char *data;  /* file data, can be NULL */
@@ -151,6 +155,7 @@ enum uade_option {
 	UC_VERBOSE,
 	UC_AO_OPTION,
 	UC_WRITE_AUDIO_FILE,
+	UC_STEMS,
 };
 
 /* Audio effects */
@@ -318,6 +323,161 @@ int uade_read_notification(struct uade_notification *notification,
  */
 void uade_cleanup_notification(struct uade_notification *notification);
 
+/*
+ * uade_read_stems() copies at most 'frames' stem frames into 'data', and
+ * returns the number of frames copied. Stems are available when
+ * UC_STEMS option is set for the song.
+ *
+ * Each stem frame has an int16_t sample for Paula channels 0, 1, 2 and 3.
+ * The samples are resampled and filtered separately for each channel.
+ * Stem frames correspond one-to-one with the frames that uade_read()
+ * returns: call uade_read_stems() with the number of frames that
+ * uade_read() returned to get the channels of those frames. Before audio
+ * effects and clamping, left = channel 0 + channel 3 and
+ * right = channel 1 + channel 2.
+ *
+ * Stems that are not read are kept until the song is stopped.
+ */
+size_t uade_read_stems(int16_t *data, size_t frames, struct uade_state *state);
+
+/*
+ * Paula trace. uadecore can stream per-channel Paula outputs and audio
+ * register writes to the client alongside the mixed sample data.
+ * See uade_set_trace() and uade_read_trace().
+ */
+enum uade_trace_flags {
+	UADE_TRACE_OUTPUTS = 1, /* Channel outputs every 'decimation' frames */
+	UADE_TRACE_EVENTS = 2,  /* Audio register writes and sample loops */
+};
+
+enum uade_trace_record_type {
+	UADE_TRACE_RECORD_OUTPUT = 1,
+	UADE_TRACE_RECORD_EVENT = 2,
+};
+
+/* These have the same values as Paula events in write-audio files */
+enum uade_paula_event {
+	UADE_PAULA_VOL = 1,
+	UADE_PAULA_PER = 2,
+	UADE_PAULA_DAT = 3,
+	UADE_PAULA_LEN = 4,
+	UADE_PAULA_LCH = 5,
+	UADE_PAULA_LCL = 6,
+	UADE_PAULA_LOOP = 7, /* Channel restarted from the sample start */
+};
+
+struct uade_trace_record {
+	enum uade_trace_record_type type;
+	/*
+	 * Index of the frame in the song that uade_read() returns. The first
+	 * frame of the song is 0, and the index is not reset on subsong
+	 * change. Events happen before the indexed frame.
+	 */
+	uint32_t frame;
+	/* UADE_TRACE_RECORD_OUTPUT: output of each channel, volume applied */
+	int16_t outputs[4];
+	/* UADE_TRACE_RECORD_EVENT */
+	int channel;
+	enum uade_paula_event event;
+	uint16_t value;
+};
+
+/*
+ * uade_set_trace() enables Paula tracing for the songs played after the
+ * call. 'flags' is a combination of enum uade_trace_flags, 0 disables
+ * tracing. An output record is generated every 'decimation' frames,
+ * e.g. 1 gives channel outputs for every frame that uade_read() returns.
+ *
+ * Returns 0 on success, -1 on invalid parameters.
+ */
+int uade_set_trace(unsigned int flags, unsigned int decimation,
+		   struct uade_state *state);
+
+/*
+ * uade_read_trace() moves at most 'maxrecords' trace records into
+ * 'records', and returns the number of records moved. Records are
+ * generated while uade_read() synthesizes samples. They are in frame order,
+ * and records of a frame are available when uade_read() has returned the
+ * frame. New records are dropped while 16 MiB of unread records are
+ * queued, and unread records are dropped when the song is stopped.
+ * Records are not generated for seeked over frames.
+ */
+size_t uade_read_trace(struct uade_trace_record *records, size_t maxrecords,
+		       struct uade_state *state);
+
+/*
+ * Returns the number of trace records of the current song that were dropped
+ * because unread records filled the queue. A warning is printed when
+ * records are dropped for the first time.
+ */
+uint64_t uade_get_trace_dropped(const struct uade_state *state);
+
+/*
+ * uade_request_snapshot() asks uadecore to save the emulator state of the
+ * current song. uadecore takes the snapshot at the next instruction
+ * boundary where all synthesized samples have been sent, so the snapshot
+ * arrives while uade_read() synthesizes samples.
+ *
+ * uade_get_snapshot() returns the snapshot after it has arrived, and NULL
+ * before that. 'subsongbytes' is set to the subsong position from where
+ * the restored snapshot continues. The snapshot must be freed with free().
+ *
+ * Snapshots are restored through RMC checkpoints. See
+ * uade_rmc_get_checkpoint(). Returns 0 on success, -1 on error.
+ */
+int uade_request_snapshot(struct uade_state *state);
+void *uade_get_snapshot(size_t *size, int64_t *subsongbytes,
+			struct uade_state *state);
+
+/* Memory regions of struct uade_stats bank_accesses */
+enum uade_stats_region {
+	UADE_STATS_CHIP,
+	UADE_STATS_SLOW,
+	UADE_STATS_FAST,
+	UADE_STATS_ROM,
+	UADE_STATS_CUSTOM,
+	UADE_STATS_CIA,
+	UADE_STATS_OTHER,
+	UADE_STATS_REGIONS,
+};
+
+/*
+ * Profiling counters of uadecore for the current song. Counting starts when
+ * the song starts. Paula events are audio register writes and sample loops,
+ * the same events as in the Paula trace. Bank accesses are data accesses of
+ * the CPU and the emulator, instruction fetches are not counted.
+ *
+ * Times are wall clock nanoseconds in uadecore. ipc_ns includes waiting for
+ * libuade. audio_ns is estimated by timing every 64th audio update. cpu_ns
+ * is the rest, that is, CPU and custom chip emulation.
+ */
+struct uade_stats {
+	uint64_t cycles;
+	uint64_t instructions;
+	uint64_t paula_events;
+	uint64_t audio_handler_calls;
+	uint64_t audio_frames;
+	uint64_t ipc_messages_sent;
+	uint64_t ipc_bytes_sent;
+	uint64_t ipc_messages_received;
+	uint64_t ipc_bytes_received;
+	uint64_t cpu_ns;
+	uint64_t audio_ns;
+	uint64_t ipc_ns;
+	uint64_t bank_accesses[UADE_STATS_REGIONS];
+};
+
+/*
+ * uade_request_stats() asks uadecore to send its counters. They arrive with
+ * the next audio data that uade_read() synthesizes. The counters are always
+ * collected, the request only sends them.
+ *
+ * uade_get_stats() copies the counters that arrived last. Returns 0 on
+ * success, and -1 if no counters have arrived since the song started.
+ */
+int uade_request_stats(struct uade_state *state);
+int uade_get_stats(struct uade_stats *stats, const struct uade_state *state);
+
 /* Returns sampling rate of current state */
 int uade_get_sampling_rate(const struct uade_state *state);
 
@@ -373,7 +533,8 @@ int uade_is_verbose(const struct uade_state *state);
 
 /*
  * Returns pointer to RMC data structure of the current song if it is played
- * from an RMC container.
+ * from an RMC container. See uade_rmc_reader_get_rmc(): the files dictionary
+ * is empty.
  */
 struct bencode *uade_get_rmc_from_state(const struct uade_state *state);
 
@@ -386,6 +547,62 @@ struct bencode *uade_get_rmc_from_state(const struct uade_state *state);
  */
 struct uade_state *uade_new_state(const struct uade_config *uc);
 
+struct uade_context;
+
+/*
+ * uade_new_context() loads uade.conf, song.conf, contentdb and
+ * eagleplayer.conf once so that many states can be created cheaply with
+ * uade_new_state_from_context(). Files are searched with the base
+ * directory of 'uc', which can be NULL. Returns NULL on error.
+ *
+ * The loaded data is read-only and shared by states. Song playtimes that a
+ * state records are copied on write into that state and saved when the state
+ * is cleaned up. They are not visible in other states of the same context.
+ *
+ * A context may be used from many threads simultaneously.
+ */
+struct uade_context *uade_new_context(const struct uade_config *uc);
+
+/*
+ * Drops the caller's reference to the context. The context is freed after
+ * all states created from it have been cleaned up.
+ */
+void uade_free_context(struct uade_context *ctx);
+
+/* Same as uade_new_state(), but uses config files loaded into 'ctx' */
+struct uade_state *uade_new_state_from_context(struct uade_context *ctx,
+					       const struct uade_config *uc);
+
+struct uade_pool_stats {
+	unsigned long hits;      /* States that got a warm uadecore */
+	unsigned long misses;    /* States that had to spawn a uadecore */
+	unsigned long spawned;   /* uadecores spawned by the pool */
+	unsigned long failures;  /* Failed pool spawns */
+	int idle;                /* Warm uadecores waiting in the pool */
+};
+
+/*
+ * Keeps 'size' idle uadecores running in the background so that
+ * uade_new_state_from_context() does not have to wait for fork, exec and
+ * uadecore startup. Checked out uadecores are replaced by a pool thread.
+ * A uadecore is never reused after a state is cleaned up, so songs can
+ * not affect each other. Size 0 (default) disables the pool.
+ * Returns 0 on success, -1 on error.
+ */
+int uade_context_set_pool_size(struct uade_context *ctx, int size);
+
+void uade_context_get_pool_stats(struct uade_pool_stats *stats,
+				 struct uade_context *ctx);
+
+/*
+ * Starts one uadecore process that runs the cores of states created after
+ * this call from 'ctx' as machine threads. Songs are still independent,
+ * but a song no longer costs a process, so many songs can be rendered in
+ * parallel cheaply. A state whose uadecore file differs from the context's
+ * gets its own process. Returns 0 on success, -1 on error.
+ */
+int uade_context_start_machine_host(struct uade_context *ctx);
+
 /*
  * uade_load_amiga_file() loads a file by using AmigaOS path search.
  * 'name' is the file name. 'playerdir' is the directory containing
@@ -549,6 +766,42 @@ const struct bencode *uade_rmc_get_subsongs(const struct bencode *rmc);
  */
 double uade_rmc_get_song_length(const struct bencode *rmc);
 
+/*
+ * The optional "checkpoints" entry of the meta data dictionary makes
+ * seeking fast. It is a dictionary:
+ *
+ *   "frequency": sampling rate of checkpoint frames
+ *   "subsongs": dictionary of subsong numbers to lists of checkpoints
+ *   "default": optional default subsong number
+ *
+ * A checkpoint is a list [frame, snapshot], where frame is the subsong
+ * position of the snapshot. Checkpoints are in increasing frame order.
+ * Snapshots come from uade_get_snapshot(). A seek restores the last
+ * checkpoint before the seek position, and plays the rest.
+ *
+ * A restored checkpoint continues exactly like the playback that recorded
+ * it. The checkpoints of the default subsong are recorded by playing the
+ * song without a subsong number, and the others by playing the subsong with
+ * uade_play(). Checkpoints of the default subsong are not used if the song
+ * was started with a subsong number, because the score starts a subsong
+ * that is set with different code.
+ *
+ * uade_rmc_get_checkpoint() returns the snapshot of the last checkpoint of
+ * 'subsong' at or before 'frame', and sets 'cpframe' to the frame of the
+ * checkpoint. Frames are counted at the rate returned by
+ * uade_rmc_get_checkpoint_frequency(). Returns NULL if there is no such
+ * checkpoint.
+ */
+const struct bencode *uade_rmc_get_checkpoint(uint64_t *cpframe,
+					      const struct bencode *rmc,
+					      int subsong, uint64_t frame);
+
+/* Returns 0 if the RMC does not have checkpoints */
+int uade_rmc_get_checkpoint_frequency(const struct bencode *rmc);
+
+/* Returns the "default" subsong of checkpoints, or -1 if it is not set */
+int uade_rmc_get_checkpoint_default(const struct bencode *rmc);
+
 /*
  * Parses a given data with size. Returns an RMC data structure if the
  * data is valid, otherwise NULL.
@@ -558,6 +811,41 @@ struct bencode *uade_rmc_decode(const void *data, size_t size);
 /* Same as uade_rmc_decode, but reads data from file pointed to by fname. */
 struct bencode *uade_rmc_decode_file(const char *fname);
 
+/*
+ * An RMC reader gives access to an RMC file without decoding the whole
+ * container. The file is mapped into memory when possible, and only the meta
+ * data dictionary is decoded. Files are parsed from the container on demand,
+ * so files that are never requested are not read or copied.
+ */
+struct uade_rmc_reader;
+
+/* Opens an RMC file for reading. Returns NULL if the RMC is not valid. */
+struct uade_rmc_reader *uade_rmc_open(const char *fname);
+
+/*
+ * Same as uade_rmc_open(), but reads the RMC from a malloc()ed buffer. The
+ * reader takes the ownership of the buffer, also on failure.
+ */
+struct uade_rmc_reader *uade_rmc_open_buffer(void *data, size_t size);
+
+void uade_rmc_close(struct uade_rmc_reader *reader);
+
+/*
+ * Returns the RMC data structure of the reader. It contains the meta data
+ * dictionary, but the files dictionary is empty. Use
+ * uade_rmc_reader_get_file() to get files. The data structure is owned by
+ * the reader.
+ */
+struct bencode *uade_rmc_reader_get_rmc(const struct uade_rmc_reader *reader);
+
+/* Same as uade_rmc_get_file(), but for a reader */
+struct uade_file *uade_rmc_reader_get_file(const struct uade_rmc_reader *reader,
+					   const char *name);
+
+/* Same as uade_rmc_get_module(), but for a reader */
+int uade_rmc_reader_get_module(struct uade_file **module,
+			       const struct uade_rmc_reader *reader);
+
 /* Put a new file to the RMC data structure */
 int uade_rmc_record_file(struct bencode *rmc, const char *name,
 			 const void *data, size_t len);
@@ -75,6 +75,7 @@ struct uade_config {
 	UADE_CHAR_CONFIG(panning_enable);
 	UADE_INT_CONFIG(silence_timeout);
 	UADE_CHAR_CONFIG(speed_hack);
+	UADE_CHAR_CONFIG(stems);
 	UADE_INT_CONFIG(subsong_timeout);
 	UADE_INT_CONFIG(timeout);
 	UADE_CHAR_CONFIG(use_text_scope);
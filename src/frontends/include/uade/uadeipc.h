@@ -42,9 +42,45 @@ enum uade_msgtype {
 	UADE_REPLY_MODULENAME,
 	UADE_REPLY_FORMATNAME,
 	UADE_REPLY_DATA,
+	/* Messages below were added in protocol version 2 */
+	UADE_COMMAND_SET_TRACE,
+	UADE_REPLY_TRACE,
+	UADE_COMMAND_USE_STEMS,
+	UADE_REPLY_STEMS,
+	UADE_COMMAND_SNAPSHOT,
+	UADE_REPLY_SNAPSHOT,
+	UADE_COMMAND_RESTORE,
+	UADE_REPLY_RESTORE,
+	UADE_COMMAND_GET_STATS,
+	UADE_REPLY_STATS,
 	UADE_MSG_LAST
 };
 
+/*
+ * UADE_REPLY_TRACE messages contain a sequence of trace records. Integers
+ * are bigendian. Frame is the index of the output frame since audio output
+ * of the song started.
+ *
+ *   output: u8 UADE_TRACE_RECORD_OUTPUT, u32 frame, 4 x s16 channel outputs
+ *   event:  u8 UADE_TRACE_RECORD_EVENT, u32 frame,
+ *           u8 (channel << 4) | paula event, u16 event value
+ */
+#define UADE_TRACE_OUTPUT_WIRE_SIZE 13
+#define UADE_TRACE_EVENT_WIRE_SIZE 8
+
+/*
+ * An emulator snapshot is sent in UADE_REPLY_SNAPSHOT messages, and
+ * restored with UADE_COMMAND_RESTORE messages. An empty message ends the
+ * snapshot. uadecore answers a restore with UADE_REPLY_RESTORE that contains
+ * u32 1 if the snapshot was restored, and 0 if it was rejected.
+ */
+
+/*
+ * uadecore answers UADE_COMMAND_GET_STATS with UADE_REPLY_STATS when it is
+ * in the send state. The message contains u32 n followed by n bigendian u64
+ * counters in the order of struct uade_stats. Unknown counters are ignored.
+ */
+
 struct uade_msg {
 	uint32_t msgtype;
 	uint32_t size;
@@ -10,6 +10,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <stdint.h>
+#include <pthread.h>
 
 enum uade_event_type {
 	UADE_EVENT_INVALID = 0,  /* Very bad! Terminate playback! */
@@ -27,8 +28,13 @@ enum uade_event_type {
 	UADE_EVENT_PLAYER_NAME,  /* You shouldn't get this event (internal) */
 	UADE_EVENT_READY,        /* You shouldn't get this event (internal) */
 	UADE_EVENT_REQUEST_AMIGA_FILE, /* uadecore requests a file (internal) */
+	UADE_EVENT_RESTORE,      /* Snapshot restore status (internal) */
+	UADE_EVENT_SNAPSHOT,     /* Part of a snapshot (internal) */
 	UADE_EVENT_SONG_END,     /* (sub)song ends */
+	UADE_EVENT_STATS,        /* Profiling counters (internal) */
+	UADE_EVENT_STEMS,        /* Per-channel sample data (internal) */
 	UADE_EVENT_SUBSONG_INFO, /* You shouldn't get this event (internal) */
+	UADE_EVENT_TRACE,        /* Paula trace records (internal) */
 };
 
 struct uade_event_data {
@@ -81,6 +87,22 @@ struct uade_song_state {
 
 	unsigned int bytesrequested; /* bytes requested from uadecore */
 
+	/* Set if uade_play() was called without a subsong number */
+	int defaultstart;
+	/* Set if uadecore rejects an RMC checkpoint */
+	int nocheckpoints;
+	/* Subsong position before the last checkpoint was restored */
+	int64_t checkpointfromoffs;
+	/* Restart the subsong at the next seek, because a restore failed */
+	int restartsubsong;
+
+	/* See uade_request_stats() */
+	struct uade_stats stats;
+	int havestats;
+
+	/* Trace records dropped because the trace fifo was full */
+	uint64_t tracedropped;
+
 	struct uade_event endevent;
 
 	int64_t silencecount;
@@ -100,6 +122,56 @@ struct uade_song_state {
 struct fifo;
 struct bencode;
 
+/* An idle uadecore that has been spawned and sent the uaerc name */
+struct uade_pooled_core {
+	struct uade_ipc ipc;
+	pid_t pid;
+};
+
+/*
+ * Read-only data that is loaded once and shared by all states created
+ * with uade_new_state_from_context(). States copy permconfig and borrow
+ * the song db. The context is freed when the last reference is dropped.
+ */
+struct uade_context {
+	pthread_mutex_t mutex;
+	int refcount;
+
+	/*
+	 * Pool of warm uadecores. The pool thread spawns cores until there
+	 * are poolsize of them. Cores are only handed out to states whose
+	 * uadecore and uaerc files equal the ones below.
+	 */
+	char uadecorefile[PATH_MAX];
+	char uaercfile[PATH_MAX];
+	struct uade_pooled_core *pool;
+	int poolsize;
+	int npooled;
+	/* uadecores of cleaned up states that the pool thread waits for */
+	pid_t *retired;
+	int nretired;
+	int maxretired;
+	int poolthreadrunning;
+	int poolquit;
+	pthread_t poolthread;
+	pthread_cond_t poolcond;
+	struct uade_pool_stats poolstats;
+
+	/* uadecore that runs the cores as machine threads, if hostpid > 0 */
+	int hostfd;
+	pid_t hostpid;
+
+	int validconfig;
+	struct uade_config permconfig;
+	char permconfigname[PATH_MAX];
+
+	struct uade_songdb songdb;
+	char songdbname[PATH_MAX];
+
+	/* Holds a reference so that the store stays loaded */
+	struct eagleplayerstore *playerstore;
+};
+
 struct uade_state {
 	/* Per song members */
 
@@ -111,9 +183,11 @@ struct uade_state {
 
 	struct uade_effect_state effectstate;
 	struct uade_song_state song;
-	struct bencode *rmc;
+	struct uade_rmc_reader *rmcreader;
+	struct bencode *rmc;  /* Owned by rmcreader */
 
 	/* Permanent members */
+	struct uade_context *context;
 	int validconfig;
 	struct uade_config permconfig;
 	char permconfigname[PATH_MAX];
@@ -126,6 +200,8 @@ struct uade_state {
 
 	struct uade_ipc ipc;
 	pid_t pid;
+	/* Set if the core is a machine of the context's machine host */
+	int hostedmachine;
 
 	struct uade_songdb songdb;
 	char songdbname[PATH_MAX];
@@ -136,6 +212,22 @@ struct uade_state {
 	struct fifo *readstash; /* Used with uade_read() */
 	struct fifo *notifications; /* Used with uade_read_notifications() */
 	struct fifo *write_queue;
+
+	/* Paula trace settings and records. See uade_set_trace(). */
+	unsigned int traceflags;
+	unsigned int tracedecimation;
+	struct fifo *trace; /* struct uade_trace_record entries */
+
+	/* See uade_request_snapshot() */
+	struct fifo *snapshot;   /* Snapshot that is being received */
+	void *snapshotdata;      /* Complete snapshot */
+	size_t snapshotsize;
+	int64_t snapshotpos;
+
+	/* Stem frames. See uade_read_stems(). */
+	struct fifo *stems;
+	/* Bytes at the end of stems that wait for the matching sample data */
+	size_t stemspending;
 };
 
 #endif
@@ -21,9 +21,31 @@
 char *uade_dirname(char *dst, char *src, size_t maxlen);
 int uade_find_amiga_file(char *realname, size_t maxlen, const char *aname, const char *playerdir);
 
+/*
+ * Closes the descriptors of 'ipc' and sets them to -1. The descriptors
+ * are the same socket when the peer is a uadecore.
+ */
+void uade_arch_close_ipc(struct uade_ipc *ipc);
 void uade_arch_kill_and_wait_uadecore(struct uade_ipc *ipc, pid_t *uadepid);
 int uade_arch_spawn(struct uade_ipc *ipc, pid_t *uadepid, const char *uadename);
 
+/*
+ * Executes uadecore as a machine host. Connections are sent to it through
+ * *hostfd with uade_arch_connect_machine(). The host exits after *hostfd
+ * is closed and all its machines have terminated.
+ */
+int uade_arch_spawn_host(int *hostfd, pid_t *uadepid, const char *uadename);
+
+/* Starts a machine in a machine host, and connects 'ipc' to it */
+int uade_arch_connect_machine(struct uade_ipc *ipc, int hostfd);
+
 int uade_filesize(size_t *size, const char *pathname);
 
+/*
+ * Maps a regular file read-only into memory. Returns NULL if the file can
+ * not be mapped, in which case it must be read instead.
+ */
+void *uade_map_file(size_t *size, const char *pathname);
+void uade_unmap_file(void *data, size_t size);
+
 #endif
@@ -0,0 +1,305 @@
+/* uade123 batch mode renders songs into files as fast as possible.
+
+   Copyright (C) 2026 UADE authors
+
+   This source code module is dual licensed under GPL and Public Domain.
+   Hence you may use _this_ module (not another code module) in any way you
+   want in your projects.
+*/
+
+#include "batch.h"
+#include "playlist.h"
+#include "playloop.h"
+#include "uade123.h"
+
+#include <uade/uade.h>
+#include <uade/uadeconstants.h>
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define WAV_HEADER_SIZE 44
+
+struct batch_times {
+	double emulation; /* seconds spent in uade_read() */
+	double output;    /* seconds spent writing output files */
+	double total;
+	uint64_t frames;
+};
+
+static char outputdir[PATH_MAX];
+static int writewav;
+static double starttime;
+static struct batch_times sum;
+static int nfiles;
+static int samplingrate = UADE_DEFAULT_FREQUENCY;
+
+/* Output file names written in this run */
+static char **usednames;
+static size_t nusednames;
+static size_t maxusednames;
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static void put_le(uint8_t *p, uint32_t x, int bytes)
+{
+	int i;
+	for (i = 0; i < bytes; i++)
+		p[i] = x >> (8 * i);
+}
+
+static int write_wav_header(FILE *f, uint64_t databytes, int rate)
+{
+	uint8_t h[WAV_HEADER_SIZE];
+	if (databytes > (UINT32_MAX - 36))
+		databytes = UINT32_MAX - 36;
+	memcpy(h, "RIFF", 4);
+	put_le(h + 4, 36 + databytes, 4);
+	memcpy(h + 8, "WAVEfmt ", 8);
+	put_le(h + 16, 16, 4);
+	put_le(h + 20, 1, 2); /* PCM */
+	put_le(h + 22, UADE_CHANNELS, 2);
+	put_le(h + 24, rate, 4);
+	put_le(h + 28, rate * UADE_BYTES_PER_FRAME, 4);
+	put_le(h + 32, UADE_BYTES_PER_FRAME, 2);
+	put_le(h + 34, 8 * UADE_BYTES_PER_SAMPLE, 2);
+	memcpy(h + 36, "data", 4);
+	put_le(h + 40, databytes, 4);
+	return fwrite(h, sizeof h, 1, f) == 1 ? 0 : -1;
+}
+
+/* WAV data is little endian */
+static void to_le_samples(int16_t *samples, size_t n)
+{
+	const uint16_t one = 1;
+	size_t i;
+	if (*((const uint8_t *) &one) == 1)
+		return;
+	for (i = 0; i < n; i++) {
+		uint16_t x = samples[i];
+		samples[i] = (x << 8) | (x >> 8);
+	}
+}
+
+static void print_times(const char *name, const struct batch_times *t,
+			int rate)
+{
+	double seconds = ((double) t->frames) / rate;
+	fprintf(stderr, "%s: %.1f s of audio in %.3f s (emulation %.3f s, "
+		"output %.3f s), %.1fx realtime\n",
+		name, seconds, t->total, t->emulation, t->output,
+		t->total > 0 ? seconds / t->total : 0.0);
+}
+
+static int is_used_name(const char *fname)
+{
+	size_t i;
+	for (i = 0; i < nusednames; i++) {
+		if (strcmp(usednames[i], fname) == 0)
+			return 1;
+	}
+	return 0;
+}
+
+static void add_used_name(const char *fname)
+{
+	if (nusednames == maxusednames) {
+		maxusednames = maxusednames ? 2 * maxusednames : 64;
+		usednames = realloc(usednames,
+				    maxusednames * sizeof usednames[0]);
+		if (usednames == NULL)
+			uade_die("No memory for batch file names\n");
+	}
+	usednames[nusednames] = strdup(fname);
+	if (usednames[nusednames] == NULL)
+		uade_die("No memory for batch file names\n");
+	nusednames++;
+}
+
+/*
+ * Songs from different directories may have the same name. The output file
+ * of a later song gets a -N suffix so that it does not overwrite an earlier
+ * output file. Returns 0 on success, -1 if the name is too long.
+ */
+static int make_output_name(char *fname, size_t maxlen, const char *base)
+{
+	const char *ext = writewav ? "wav" : "raw";
+	char first[PATH_MAX];
+	int n;
+
+	if (snprintf(first, sizeof first, "%s/%s.%s", outputdir, base, ext) >=
+	    sizeof first)
+		return -1;
+	if (strlcpy(fname, first, maxlen) >= maxlen)
+		return -1;
+
+	for (n = 2; is_used_name(fname); n++) {
+		if (snprintf(fname, maxlen, "%s/%s-%d.%s", outputdir, base,
+			     n, ext) >= maxlen)
+			return -1;
+	}
+
+	if (n > 2)
+		fprintf(stderr, "Output name collision: %s is written to %s\n",
+			first, fname);
+
+	add_used_name(fname);
+	return 0;
+}
+
+static void handle_notifications(const char *base, struct uade_state *state)
+{
+	struct uade_notification n;
+
+	while (uade_read_notification(&n, state)) {
+		if (n.type == UADE_NOTIFICATION_MESSAGE) {
+			fprintf(stderr, "%s: Amiga message: %s\n", base, n.msg);
+		} else if (n.type == UADE_NOTIFICATION_SONG_END &&
+			   !n.song_end.happy) {
+			fprintf(stderr, "%s: bad song end: %s\n", base,
+				n.song_end.reason);
+		}
+		uade_cleanup_notification(&n);
+	}
+}
+
+void batch_init(const char *outdir)
+{
+	struct stat st;
+
+	if (stat(outdir, &st) || !S_ISDIR(st.st_mode))
+		uade_die("Batch output directory does not exist: %s\n", outdir);
+	if (strlcpy(outputdir, outdir, sizeof outputdir) >= sizeof outputdir)
+		uade_die("Too long a batch output directory name\n");
+
+	if (uade_output_file_format[0] == 0 ||
+	    strcmp(uade_output_file_format, "wav") == 0) {
+		writewav = 1;
+	} else if (strcmp(uade_output_file_format, "raw") != 0) {
+		uade_die("Batch mode supports only wav and raw formats: %s\n",
+			 uade_output_file_format);
+	}
+
+	starttime = now();
+}
+
+/* Renders the song that has been started with uade_play() into a file */
+int batch_play(struct uade_state *state)
+{
+	const struct uade_song_info *info = uade_get_song_info(state);
+	int rate = uade_get_sampling_rate(state);
+	const char *base = strrchr(info->modulefname, '/');
+	char fname[PATH_MAX];
+	struct batch_times t = {.frames = 0};
+	char *buf;
+	size_t bufsize = 1 << 16;
+	int plistdir = UADE_PLAY_NEXT;
+	ssize_t nbytes;
+	double t0, t1, t2;
+	FILE *f;
+
+	base = (base != NULL) ? base + 1 : info->modulefname;
+	if (make_output_name(fname, sizeof fname, base)) {
+		fprintf(stderr, "Too long an output file name for %s\n", base);
+		return UADE_PLAY_NEXT;
+	}
+
+	f = fopen(fname, "wb");
+	if (f == NULL) {
+		fprintf(stderr, "Can not open %s: %s\n", fname,
+			strerror(errno));
+		return UADE_PLAY_FAILURE;
+	}
+	setvbuf(f, NULL, _IOFBF, 1 << 20);
+
+	buf = malloc(bufsize);
+	if (buf == NULL)
+		uade_die("No memory for batch buffer\n");
+
+	samplingrate = rate;
+
+	t0 = now();
+	if (uade_jump_pos > 0)
+		uade_seek(UADE_SEEK_SONG_RELATIVE, uade_jump_pos, 0, state);
+
+	if (writewav && write_wav_header(f, 0, rate))
+		goto writeerror;
+
+	while (1) {
+		t1 = now();
+		nbytes = uade_read(buf, bufsize, state);
+		t2 = now();
+		t.emulation += t2 - t1;
+
+		handle_notifications(base, state);
+
+		if (nbytes < 0) {
+			fprintf(stderr, "Playback error: %s\n", base);
+			plistdir = UADE_PLAY_FAILURE;
+			break;
+		}
+		if (nbytes == 0)
+			break;
+
+		t.frames += nbytes / UADE_BYTES_PER_FRAME;
+		if (writewav)
+			to_le_samples((int16_t *) buf, nbytes / 2);
+		if (fwrite(buf, nbytes, 1, f) != 1)
+			goto writeerror;
+		if (uade_stems_file != NULL)
+			write_stems(nbytes / UADE_BYTES_PER_FRAME, state);
+		t.output += now() - t2;
+	}
+
+	t1 = now();
+	if (writewav) {
+		if (fseek(f, 0, SEEK_SET) ||
+		    write_wav_header(f, t.frames * UADE_BYTES_PER_FRAME, rate))
+			goto writeerror;
+	}
+	if (fclose(f)) {
+		f = NULL;
+		goto writeerror;
+	}
+	f = NULL;
+	t2 = now();
+	t.output += t2 - t1;
+	t.total = t2 - t0;
+
+	print_times(base, &t, rate);
+
+	sum.emulation += t.emulation;
+	sum.output += t.output;
+	sum.frames += t.frames;
+	nfiles++;
+
+	free(buf);
+	return plistdir;
+
+writeerror:
+	fprintf(stderr, "Can not write %s: %s\n", fname, strerror(errno));
+	if (f != NULL)
+		fclose(f);
+	free(buf);
+	return UADE_PLAY_FAILURE;
+}
+
+void batch_print_summary(void)
+{
+	/* The total includes starting songs and other overhead */
+	sum.total = now() - starttime;
+	fprintf(stderr, "\n%d files rendered\n", nfiles);
+	if (nfiles > 0)
+		print_times("Total", &sum, samplingrate);
+}
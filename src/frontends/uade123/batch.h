@@ -0,0 +1,10 @@
+#ifndef _UADE123_BATCH_H_
+#define _UADE123_BATCH_H_
+
+#include <uade/uade.h>
+
+void batch_init(const char *outdir);
+int batch_play(struct uade_state *state);
+void batch_print_summary(void);
+
+#endif
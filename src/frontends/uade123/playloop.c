@@ -235,6 +235,14 @@ static void handle_notification(struct uade_notification *n)
 	}
 }
 
+void write_stems(size_t frames, struct uade_state *state)
+{
+	int16_t stems[4096 / UADE_BYTES_PER_FRAME * UADE_STEM_CHANNELS];
+	size_t n = uade_read_stems(stems, frames, state);
+	if (fwrite(stems, UADE_STEM_FRAME_SIZE, n, uade_stems_file) != n)
+		uade_warning("Can not write stems: %s\n", strerror(errno));
+}
+
 static int uade_input(int *plistdir, struct uade_state *state)
 {
 	struct uade_notification n;
@@ -260,6 +268,8 @@ static int uade_input(int *plistdir, struct uade_state *state)
 		return -1;
 
 	audio_play(buf, nbytes);
+	if (uade_stems_file != NULL)
+		write_stems(nbytes / UADE_BYTES_PER_FRAME, state);
 	print_time(state);
 	return 0;
 }
@@ -4,5 +4,6 @@
 #include <uade/uade.h>
 
 int play_loop(struct uade_state *state);
+void write_stems(size_t frames, struct uade_state *state);
 
 #endif
@@ -12,6 +12,7 @@
 #include "uade123.h"
 
 #include "playloop.h"
+#include "batch.h"
 #include "audio.h"
 #include "terminal.h"
 
@@ -44,6 +45,7 @@ int uade_no_text_output;
 char uade_output_file_format[16];
 char uade_output_file_name[PATH_MAX];
 struct playlist uade_playlist;
+FILE *uade_stems_file;
 FILE *uade_terminal_file;
 
 static int debug_mode;
@@ -186,17 +188,20 @@ int main(int argc, char *argv[])
 	struct uade_state *state;
 
 	int returncode = 0;
+	char *batchdir = NULL;
 
 	enum {
 		OPT_FIRST = 0x1FFF,
 		OPT_AO_OPTION,
 		OPT_BASEDIR,
+		OPT_BATCH,
 		OPT_BUFFER_TIME,
 		OPT_REPEAT,
 		OPT_SCAN,
 		OPT_SCOPE,
 		OPT_SET,
 		OPT_STDERR,
+		OPT_STEMS,
 		OPT_VERSION,
 		OPT_WRITE_AUDIO_FILE,
 	};
@@ -204,6 +209,7 @@ int main(int argc, char *argv[])
 	struct option long_options[] = {
 		{"ao-option",        1, NULL, OPT_AO_OPTION},
 		{"basedir",          1, NULL, OPT_BASEDIR},
+		{"batch",            1, NULL, OPT_BATCH},
 		{"buffer-time",      1, NULL, OPT_BUFFER_TIME},
 		{"debug",            0, NULL, 'd'},
 		{"detect-format-by-content", 0, NULL, UC_CONTENT_DETECTION},
@@ -240,6 +246,7 @@ int main(int argc, char *argv[])
 		{"silence-timeout",  1, NULL, 'y'},
 		{"speed-hack",       0, NULL, UC_SPEED_HACK},
 		{"stderr",           0, NULL, OPT_STDERR},
+		{"stems",            1, NULL, OPT_STEMS},
 		{"stdout",           0, NULL, 'c'},
 		{"subsong",          1, NULL, 's'},
 		{"subsong-timeout",  1, NULL, 'w'},
@@ -396,6 +403,12 @@ int main(int argc, char *argv[])
 			uade_config_set_option(uc_cmdline, UC_BASE_DIR, optarg);
 			break;
 
+		case OPT_BATCH:
+			batchdir = optarg;
+			uade_no_audio_output = 1;
+			actionkeys = 0;
+			break;
+
 		case OPT_REPEAT:
 			playlist_repeat(&uade_playlist);
 			break;
@@ -420,6 +433,14 @@ int main(int argc, char *argv[])
 			uade_terminal_file = stderr;
 			break;
 
+		case OPT_STEMS:
+			uade_stems_file = fopen(optarg, "wb");
+			if (uade_stems_file == NULL)
+				uade_die("Can not open stems file %s: %s\n",
+					 optarg, strerror(errno));
+			uade_config_set_option(uc_cmdline, UC_STEMS, NULL);
+			break;
+
 		case OPT_VERSION:
 			printf("uade123 %s\n", UADE_VERSION);
 			exit(0);
@@ -476,6 +497,9 @@ int main(int argc, char *argv[])
 		}
 	}
 
+	if (batchdir != NULL && uade_info_mode)
+		uade_die("--batch can not be used with --get-info\n");
+
 	set_terminal_file();
 
 	state = uade_new_state(uc_cmdline);
@@ -534,6 +558,9 @@ int main(int argc, char *argv[])
 
 	setup_sighandlers();
 
+	if (batchdir != NULL)
+		batch_init(batchdir);
+
 	if (!audio_init(state, aooptions))
 		goto cleanup;
 
@@ -574,7 +601,10 @@ int main(int argc, char *argv[])
 		fprintf(stderr, "Song: %s (%zd bytes)\n",
 			info->modulefname, info->modulebytes);
 
-		plistdir = play_loop(state);
+		if (batchdir != NULL)
+			plistdir = batch_play(state);
+		else
+			plistdir = play_loop(state);
 
 		if (uade_stop(state)) {
 			uade_cleanup_state(state);
@@ -593,6 +623,9 @@ int main(int argc, char *argv[])
 			break;
 	}
 
+	if (batchdir != NULL)
+		batch_print_summary();
+
 	cleanup(state);
 	free(uc_cmdline);
 	return returncode;
@@ -662,8 +695,8 @@ static void print_help(void)
 " -P filename,        Set player name\n"
 " -r, --recursive,    Recursive directory scan\n"
 " --repeat,           Play playlist over and over again\n"
-" --resampler=x       Set resampling method to x, where x = default, sinc\n"
-"                     or none.\n"
+" --resampler=x       Set resampling method to x, where x = default, sinc,\n"
+"                     fir or none.\n"
 " -s x, --subsong=x,  Set subsong 'x'\n"
 " --scan              Scan given files and directories for playable songs and\n"
 "                     print their names, one per line on stdout.\n"
@@ -671,6 +704,7 @@ static void print_help(void)
 " --set=\"options\"     Set song.conf options for each given song.\n"
 " --speed-hack,       Set speed hack on. This gives more virtual CPU power.\n"
 " --stderr,           Print messages on stderr rather than stdout\n"
+" --stems=fname,      Write 4-channel Paula outputs to fname as raw s16\n"
 " -t x, --timeout=x,  Set song timeout in seconds. -1 is infinite.\n"
 "                     The default is infinite.\n"
 " -v,  --verbose,     Turn on verbose mode\n"
@@ -687,6 +721,11 @@ static void print_help(void)
 "EXPERT OPTIONS:\n"
 "\n"
 " --basedir=dirname,  Set uade base directory (contains data files)\n"
+" --batch=dirname,    Render songs into dirname as fast as possible, one file\n"
+"                     per song. -e selects wav (default) or raw. Prints\n"
+"                     realtime factor statistics for each file. Songs with\n"
+"                     the same file name get a -N suffix. -j applies to each\n"
+"                     song. Can not be used with -g.\n"
 " -d, --debug,        Enable debug mode (expert only)\n"
 " -S filename,        Set sound core name\n"
 " --scope,            Turn on Paula hardware register debug mode\n"
@@ -746,4 +785,6 @@ static void cleanup(struct uade_state *state)
 {
 	uade_cleanup_state(state);
 	audio_close();
+	if (uade_stems_file != NULL)
+		fclose(uade_stems_file);
 }
@@ -23,6 +23,7 @@ extern int uade_no_text_output;
 extern char uade_output_file_format[16];
 extern char uade_output_file_name[PATH_MAX];
 extern struct playlist uade_playlist;
+extern FILE *uade_stems_file;
 extern FILE *uade_terminal_file;
 
 
@@ -0,0 +1,808 @@
+/* uadebench - measures libuade overheads and playback performance.
+
+   Copyright (C) 2026 UADE authors
+
+   This source code module is dual licensed under GPL and Public Domain.
+   Hence you may use _this_ module (not another code module) in any way you
+   want in your projects.
+*/
+
+#include <uade/uade.h>
+#include <uade/effects.h>
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/* Options of the JSON benchmark suite, see run_suite() */
+struct bench {
+	const char *basedir;
+	const char *uadecore;
+	const char *score;
+	const char *player;
+	double seconds;  /* Audio rendered for each render configuration */
+	int repeats;     /* Repeats of song start, detection is 100 times this */
+	int nstates;
+	FILE *out;
+	int16_t *pcm;    /* Captured audio for the effects stage */
+	size_t pcmframes;
+};
+
+/* A render configuration: uade options on top of the suite options */
+struct render_config {
+	const char *name;
+	const char *resampler;
+	const char *filter;  /* NULL means no filter */
+};
+
+static const struct render_config render_configs[] = {
+	{.name = "default", .resampler = "default", .filter = "a500"},
+	{.name = "sinc", .resampler = "sinc", .filter = "a500"},
+	{.name = "none", .resampler = "none", .filter = "a500"},
+	{.name = "fir", .resampler = "fir", .filter = "a500"},
+	{.name = "a1200", .resampler = "default", .filter = "a1200"},
+	{.name = "nofilter", .resampler = "default", .filter = NULL},
+};
+
+static const struct {
+	const char *name;
+	uade_effect_t effect;
+} effect_configs[] = {
+	{"pan", UADE_EFFECT_PAN},
+	{"headphones", UADE_EFFECT_HEADPHONES},
+	{"headphones2", UADE_EFFECT_HEADPHONES2},
+	{"gain", UADE_EFFECT_GAIN},
+};
+
+/* Seek positions in seconds. The last one is a backward seek. */
+static const double seek_positions[] = {10.0, 60.0, 30.0};
+
+#define MAX_CAPTURE_SECONDS 10
+
+/*
+ * Resamplers whose spectra are compared against the sinc resampler in the
+ * quality stage. Filters are disabled because sinc emulates them
+ * differently.
+ */
+static const char *quality_resamplers[] = {"default", "none", "fir"};
+
+#define QUALITY_SECONDS 10
+#define FFT_SIZE 4096
+
+static double now(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void report(const char *name, int n, double t)
+{
+	printf("%-32s %6d states %8.3f s %10.1f states/s\n",
+	       name, n, t, t > 0 ? n / t : 0.0);
+}
+
+/* Creates and destroys n states with uade_new_state() */
+static int bench_new_state(int n, const struct uade_config *uc)
+{
+	int i;
+	double t = now();
+	for (i = 0; i < n; i++) {
+		struct uade_state *state = uade_new_state(uc);
+		if (state == NULL) {
+			fprintf(stderr, "uade_new_state() failed\n");
+			return -1;
+		}
+		uade_cleanup_state(state);
+	}
+	report("uade_new_state", n, now() - t);
+	return 0;
+}
+
+/*
+ * Same as bench_new_state() but config files are loaded once. If poolsize
+ * is positive, the pool is filled before measuring.
+ */
+static int bench_new_state_from_context(int n, const struct uade_config *uc,
+					int poolsize)
+{
+	int i;
+	double t;
+	char name[64];
+	struct uade_pool_stats stats;
+	struct uade_context *ctx = uade_new_context(uc);
+	if (ctx == NULL) {
+		fprintf(stderr, "uade_new_context() failed\n");
+		return -1;
+	}
+	if (poolsize > 0) {
+		if (uade_context_set_pool_size(ctx, poolsize)) {
+			fprintf(stderr, "Can not set pool size\n");
+			uade_free_context(ctx);
+			return -1;
+		}
+		do {
+			usleep(10000);
+			uade_context_get_pool_stats(&stats, ctx);
+		} while (stats.idle < poolsize && stats.failures == 0);
+	}
+
+	t = now();
+	for (i = 0; i < n; i++) {
+		struct uade_state *state = uade_new_state_from_context(ctx, uc);
+		if (state == NULL) {
+			fprintf(stderr, "uade_new_state_from_context() failed\n");
+			uade_free_context(ctx);
+			return -1;
+		}
+		uade_cleanup_state(state);
+	}
+	t = now() - t;
+
+	if (poolsize > 0) {
+		uade_context_get_pool_stats(&stats, ctx);
+		snprintf(name, sizeof name, "pool size %d", poolsize);
+		report(name, n, t);
+		printf("pool hits %lu misses %lu spawned %lu failures %lu\n",
+		       stats.hits, stats.misses, stats.spawned, stats.failures);
+	} else {
+		report("uade_new_state_from_context", n, t);
+	}
+	uade_free_context(ctx);
+	return 0;
+}
+
+static void json_string(FILE *out, const char *s)
+{
+	fputc('"', out);
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\')
+			fprintf(out, "\\%c", *s);
+		else if ((unsigned char) *s < 0x20)
+			fprintf(out, "\\u%04x", (unsigned char) *s);
+		else
+			fputc(*s, out);
+	}
+	fputc('"', out);
+}
+
+static struct uade_config *new_bench_config(const struct bench *b)
+{
+	struct uade_config *uc = uade_new_config();
+	if (uc == NULL)
+		return NULL;
+	if (b->basedir != NULL)
+		uade_config_set_option(uc, UC_BASE_DIR, b->basedir);
+	if (b->uadecore != NULL)
+		uade_config_set_option(uc, UC_UADECORE_FILE, b->uadecore);
+	if (b->score != NULL)
+		uade_config_set_option(uc, UC_SCORE_FILE, b->score);
+	if (b->player != NULL)
+		uade_config_set_option(uc, UC_PLAYER_FILE, b->player);
+	/* Effects are measured separately */
+	uade_config_set_option(uc, UC_NO_POSTPROCESSING, NULL);
+	return uc;
+}
+
+static struct uade_state *new_bench_state(const struct bench *b,
+					  const struct render_config *rc)
+{
+	struct uade_state *state;
+	struct uade_config *uc = new_bench_config(b);
+	if (uc == NULL)
+		return NULL;
+	if (rc != NULL) {
+		uade_config_set_option(uc, UC_RESAMPLER, rc->resampler);
+		if (rc->filter != NULL)
+			uade_config_set_option(uc, UC_FILTER_TYPE, rc->filter);
+		else
+			uade_config_set_option(uc, UC_NO_FILTER, NULL);
+	}
+	state = uade_new_state(uc);
+	free(uc);
+	if (state == NULL)
+		fprintf(stderr, "uade_new_state() failed\n");
+	return state;
+}
+
+/* Starts playing and reads audio until the first data arrives */
+static int start_song(const char *song, struct uade_state *state)
+{
+	char buf[4096];
+	ssize_t nbytes;
+	if (uade_play(song, -1, state) != 1) {
+		fprintf(stderr, "Can not play %s\n", song);
+		return -1;
+	}
+	do {
+		nbytes = uade_read(buf, sizeof buf, state);
+	} while (nbytes == 0 && uade_is_seeking(state));
+	if (nbytes <= 0) {
+		fprintf(stderr, "No audio from %s\n", song);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Gets uadecore counters for the song that is playing. The counters arrive
+ * with audio data, so this reads up to maxreads more buffers.
+ */
+static int read_stats(struct uade_stats *stats, struct uade_state *state,
+		      int maxreads)
+{
+	char buf[4096];
+	int i;
+	if (uade_request_stats(state))
+		return -1;
+	for (i = 0; i < maxreads; i++) {
+		if (uade_read(buf, sizeof buf, state) <= 0)
+			break;
+		if (uade_get_stats(stats, state) == 0)
+			return 0;
+	}
+	return -1;
+}
+
+static void json_rate(FILE *out, int count, double t)
+{
+	fprintf(out, "\"count\": %d, \"seconds\": %.6f, \"per_second\": %.3f",
+		count, t, t > 0 ? count / t : 0.0);
+}
+
+static int suite_new_state(const struct bench *b)
+{
+	int i;
+	double t = now();
+	for (i = 0; i < b->nstates; i++) {
+		struct uade_state *state = new_bench_state(b, NULL);
+		if (state == NULL)
+			return -1;
+		uade_cleanup_state(state);
+	}
+	t = now() - t;
+	fprintf(b->out, "  \"new_state\": {");
+	json_rate(b->out, b->nstates, t);
+	fprintf(b->out, "},\n");
+	return 0;
+}
+
+/* Format detection, song start latency and seeking for one song */
+static int suite_song(const struct bench *b, const char *song,
+		      struct uade_state *state)
+{
+	int i;
+	int n = 100 * b->repeats;
+	double t;
+	double latency;
+	double maxlatency = 0;
+	double total = 0;
+	char buf[4096];
+
+	t = now();
+	for (i = 0; i < n; i++) {
+		if (!uade_is_our_file(song, state)) {
+			fprintf(stderr, "Not a known format: %s\n", song);
+			return -1;
+		}
+	}
+	t = now() - t;
+	fprintf(b->out, "      \"detection\": {");
+	json_rate(b->out, n, t);
+	fprintf(b->out, "},\n");
+
+	/* uade_play() until the first uade_read() data */
+	for (i = 0; i < b->repeats; i++) {
+		t = now();
+		if (start_song(song, state))
+			return -1;
+		latency = now() - t;
+		total += latency;
+		if (latency > maxlatency)
+			maxlatency = latency;
+		if (i < b->repeats - 1 && uade_stop(state))
+			return -1;
+	}
+	fprintf(b->out, "      \"start\": {");
+	json_rate(b->out, b->repeats, total);
+	fprintf(b->out, ", \"mean_latency\": %.6f, \"max_latency\": %.6f},\n",
+		total / b->repeats, maxlatency);
+
+	/* The song is still playing from the start stage */
+	fprintf(b->out, "      \"seek\": [");
+	for (i = 0; i < (int) (sizeof seek_positions / sizeof seek_positions[0]); i++) {
+		ssize_t nbytes;
+		t = now();
+		if (uade_seek(UADE_SEEK_SONG_RELATIVE, seek_positions[i], 0,
+			      state)) {
+			fprintf(stderr, "Can not seek %s\n", song);
+			return -1;
+		}
+		do {
+			nbytes = uade_read(buf, sizeof buf, state);
+		} while (nbytes > 0 && uade_is_seeking(state));
+		t = now() - t;
+		fprintf(b->out, "%s\n        {\"position\": %.3f, \"seconds\": %.6f}",
+			i > 0 ? "," : "", seek_positions[i], t);
+		if (nbytes <= 0)
+			break;
+	}
+	fprintf(b->out, "\n      ],\n");
+	return uade_stop(state);
+}
+
+/*
+ * Renders b->seconds of audio. Measuring starts from the first audio data so
+ * that the song start does not affect the realtime factor.
+ */
+static int suite_render(struct bench *b, const char *song,
+			const struct render_config *rc, int last)
+{
+	char buf[4096];
+	ssize_t nbytes;
+	size_t frames = 0;
+	size_t maxframes;
+	int rate;
+	double t;
+	double audioseconds;
+	double emulated;
+	struct uade_stats stats;
+	int havestats;
+	struct uade_state *state = new_bench_state(b, rc);
+	if (state == NULL)
+		return -1;
+	if (start_song(song, state)) {
+		uade_cleanup_state(state);
+		return -1;
+	}
+	rate = uade_get_sampling_rate(state);
+	maxframes = (size_t) (b->seconds * rate);
+
+	/* The first song with default config provides audio for effects */
+	if (b->pcm == NULL && strcmp(rc->name, "default") == 0) {
+		size_t n = MAX_CAPTURE_SECONDS * rate;
+		b->pcm = calloc(n, UADE_BYTES_PER_FRAME);
+		b->pcmframes = b->pcm != NULL ? n : 0;
+	}
+
+	t = now();
+	while (frames < maxframes) {
+		nbytes = uade_read(buf, sizeof buf, state);
+		if (nbytes < 0) {
+			fprintf(stderr, "Playback error: %s\n", song);
+			uade_cleanup_state(state);
+			return -1;
+		}
+		if (nbytes == 0)
+			break;
+		if (b->pcm != NULL && strcmp(rc->name, "default") == 0 &&
+		    (frames + nbytes / UADE_BYTES_PER_FRAME) <= b->pcmframes)
+			memcpy((char *) b->pcm + frames * UADE_BYTES_PER_FRAME,
+			       buf, nbytes);
+		frames += nbytes / UADE_BYTES_PER_FRAME;
+	}
+	t = now() - t;
+	havestats = read_stats(&stats, state, 100) == 0 &&
+		stats.audio_frames > 0;
+	uade_cleanup_state(state);
+
+	audioseconds = (double) frames / rate;
+	fprintf(b->out, "        {\"name\": ");
+	json_string(b->out, rc->name);
+	fprintf(b->out, ", \"resampler\": ");
+	json_string(b->out, rc->resampler);
+	fprintf(b->out, ", \"filter\": ");
+	json_string(b->out, rc->filter != NULL ? rc->filter : "none");
+	fprintf(b->out, ", \"audio_seconds\": %.3f, \"seconds\": %.6f, \"realtime_factor\": %.3f",
+		audioseconds, t, t > 0 ? audioseconds / t : 0.0);
+	/*
+	 * Paula register writes and audio state machine events per second of
+	 * audio tell how dense the song is. Paula emulation time per second of
+	 * audio is what the resampler and the mixing cost on that song.
+	 */
+	if (havestats) {
+		emulated = (double) stats.audio_frames / rate;
+		fprintf(b->out, ", \"paula_events_per_second\": %.1f, \"audio_handler_calls_per_second\": %.1f, \"paula_ns_per_second\": %.0f",
+			stats.paula_events / emulated,
+			stats.audio_handler_calls / emulated,
+			stats.audio_ns / emulated);
+	}
+	fprintf(b->out, "}%s\n", last ? "" : ",");
+	return 0;
+}
+
+/* Renders frames of audio into a new buffer. Returns NULL on error. */
+static int16_t *render_pcm(const struct bench *b, const char *song,
+			   const struct render_config *rc, size_t frames,
+			   int *rate)
+{
+	char buf[4096];
+	ssize_t nbytes;
+	size_t pos = 0;
+	size_t size = frames * UADE_BYTES_PER_FRAME;
+	char *pcm = calloc(1, size);
+	struct uade_state *state = new_bench_state(b, rc);
+	if (pcm == NULL || state == NULL)
+		goto error;
+	if (uade_play(song, -1, state) != 1)
+		goto error;
+	*rate = uade_get_sampling_rate(state);
+	while (pos < size) {
+		nbytes = uade_read(buf, sizeof buf, state);
+		if (nbytes < 0)
+			goto error;
+		if (nbytes == 0 && !uade_is_seeking(state))
+			break;
+		if ((size_t) nbytes > size - pos)
+			nbytes = size - pos;
+		memcpy(pcm + pos, buf, nbytes);
+		pos += nbytes;
+	}
+	uade_cleanup_state(state);
+	return (int16_t *) pcm;
+
+error:
+	fprintf(stderr, "Can not render %s\n", song);
+	free(pcm);
+	if (state != NULL)
+		uade_cleanup_state(state);
+	return NULL;
+}
+
+/* In-place radix-2 FFT of FFT_SIZE points */
+static void fft(double *re, double *im)
+{
+	int i, j, k, len;
+	double t;
+
+	for (i = 1, j = 0; i < FFT_SIZE; i++) {
+		int bit = FFT_SIZE >> 1;
+		for (; j & bit; bit >>= 1)
+			j ^= bit;
+		j ^= bit;
+		if (i < j) {
+			t = re[i]; re[i] = re[j]; re[j] = t;
+			t = im[i]; im[i] = im[j]; im[j] = t;
+		}
+	}
+
+	for (len = 2; len <= FFT_SIZE; len <<= 1) {
+		for (k = 0; k < len / 2; k++) {
+			double wr = cos(-2 * M_PI * k / len);
+			double wi = sin(-2 * M_PI * k / len);
+			for (i = k; i < FFT_SIZE; i += len) {
+				double vr, vi;
+				j = i + len / 2;
+				vr = re[j] * wr - im[j] * wi;
+				vi = re[j] * wi + im[j] * wr;
+				re[j] = re[i] - vr;
+				im[j] = im[i] - vi;
+				re[i] += vr;
+				im[i] += vi;
+			}
+		}
+	}
+}
+
+/*
+ * Computes the power spectrum of the mono mix with Welch's method: Hann
+ * windowed FFTs with 50% overlap are averaged. psd has FFT_SIZE / 2 bins.
+ */
+static void power_spectrum(double *psd, const int16_t *pcm, size_t frames)
+{
+	double re[FFT_SIZE];
+	double im[FFT_SIZE];
+	size_t start;
+	size_t n = 0;
+	int i;
+
+	memset(psd, 0, FFT_SIZE / 2 * sizeof psd[0]);
+	for (start = 0; start + FFT_SIZE <= frames; start += FFT_SIZE / 2) {
+		for (i = 0; i < FFT_SIZE; i++) {
+			double w = 0.5 - 0.5 * cos(2 * M_PI * i / FFT_SIZE);
+			const int16_t *frame = &pcm[2 * (start + i)];
+			re[i] = w * (frame[0] + frame[1]) / 2;
+			im[i] = 0;
+		}
+		fft(re, im);
+		for (i = 0; i < FFT_SIZE / 2; i++)
+			psd[i] += re[i] * re[i] + im[i] * im[i];
+		n++;
+	}
+	for (i = 0; n > 0 && i < FFT_SIZE / 2; i++)
+		psd[i] /= n;
+}
+
+/*
+ * Returns the RMS difference in dB of two power spectra over [lo, hi) Hz.
+ * Powers are floored at the level of 1 LSB white noise, which is
+ * FFT_SIZE / 32 with a Hann window, so that silent bins do not dominate.
+ */
+static double spectral_distance(const double *psd, const double *ref,
+				int rate, double lo, double hi)
+{
+	const double floor = FFT_SIZE / 32.0;
+	double sum = 0;
+	int n = 0;
+	int i;
+	for (i = 0; i < FFT_SIZE / 2; i++) {
+		double f = (double) i * rate / FFT_SIZE;
+		double d;
+		if (f < lo || f >= hi)
+			continue;
+		d = 10 * log10((psd[i] + floor) / (ref[i] + floor));
+		sum += d * d;
+		n++;
+	}
+	return n > 0 ? sqrt(sum / n) : 0.0;
+}
+
+/*
+ * Compares the spectrum of each resampler in quality_resamplers to the sinc
+ * resampler, which is the most accurate one. The full band distance ends at
+ * 45% of the sampling rate. The high band starts from 10 kHz, where the
+ * aliasing and treble loss of cheap resamplers show.
+ */
+static int suite_quality(const struct bench *b, const char *song)
+{
+	size_t i;
+	int rate;
+	int refrate;
+	double top;
+	size_t frames = QUALITY_SECONDS * 48000;
+	struct render_config rc = {.name = "sinc", .resampler = "sinc"};
+	double *ref = calloc(FFT_SIZE, sizeof ref[0]);
+	double *psd = &ref[FFT_SIZE / 2];
+	int16_t *pcm;
+
+	if (ref == NULL)
+		return -1;
+	pcm = render_pcm(b, song, &rc, frames, &refrate);
+	if (pcm == NULL) {
+		free(ref);
+		return -1;
+	}
+	frames = QUALITY_SECONDS * refrate;
+	power_spectrum(ref, pcm, frames);
+	free(pcm);
+	top = 0.45 * refrate;
+
+	fprintf(b->out, "      \"quality\": [");
+	for (i = 0; i < sizeof quality_resamplers / sizeof quality_resamplers[0]; i++) {
+		rc.name = quality_resamplers[i];
+		rc.resampler = quality_resamplers[i];
+		pcm = render_pcm(b, song, &rc, frames, &rate);
+		if (pcm == NULL || rate != refrate) {
+			free(pcm);
+			free(ref);
+			return -1;
+		}
+		power_spectrum(psd, pcm, frames);
+		free(pcm);
+		fprintf(b->out, "%s\n        {\"resampler\": ", i > 0 ? "," : "");
+		json_string(b->out, rc.resampler);
+		fprintf(b->out, ", \"spectral_distance_db\": %.3f, \"high_band_distance_db\": %.3f}",
+			spectral_distance(psd, ref, rate, 20, top),
+			spectral_distance(psd, ref, rate, 10000, top));
+	}
+	fprintf(b->out, "\n      ],\n");
+	free(ref);
+	return 0;
+}
+
+/* Runs each effect alone over the captured audio */
+static int suite_effects(const struct bench *b)
+{
+	size_t i;
+	size_t size = b->pcmframes * UADE_BYTES_PER_FRAME;
+	int16_t *samples;
+	int rate = 44100;
+	double t;
+	struct uade_state *state;
+
+	fprintf(b->out, "  \"effects\": [");
+	if (b->pcm == NULL) {
+		fprintf(b->out, "],\n");
+		return 0;
+	}
+	samples = malloc(size);
+	state = new_bench_state(b, NULL);
+	if (samples == NULL || state == NULL) {
+		free(samples);
+		if (state != NULL)
+			uade_cleanup_state(state);
+		return -1;
+	}
+
+	for (i = 0; i < sizeof effect_configs / sizeof effect_configs[0]; i++) {
+		memcpy(samples, b->pcm, size);
+		uade_effect_set_defaults(state);
+		uade_effect_set_sample_rate(state, rate);
+		uade_effect_gain_set_amount(state, 0.5);
+		uade_effect_enable(state, effect_configs[i].effect);
+		t = now();
+		uade_effect_run(state, samples, b->pcmframes);
+		t = now() - t;
+		fprintf(b->out, "%s\n    {\"name\": ", i > 0 ? "," : "");
+		json_string(b->out, effect_configs[i].name);
+		fprintf(b->out, ", \"audio_seconds\": %.3f, \"seconds\": %.6f, \"realtime_factor\": %.1f}",
+			(double) b->pcmframes / rate, t,
+			t > 0 ? b->pcmframes / (rate * t) : 0.0);
+	}
+	fprintf(b->out, "\n  ],\n");
+
+	free(samples);
+	uade_cleanup_state(state);
+	return 0;
+}
+
+/*
+ * Runs all benchmarks and writes the results as JSON. Times are wall clock
+ * seconds. A realtime factor is seconds of audio per wall clock second.
+ */
+static int run_suite(struct bench *b, char *songs[], int nsongs)
+{
+	int i;
+	size_t j;
+	struct uade_state *state;
+	size_t nconfigs = sizeof render_configs / sizeof render_configs[0];
+
+	fprintf(b->out, "{\n  \"version\": ");
+	json_string(b->out, UADE_VERSION);
+	fprintf(b->out, ",\n  \"render_seconds\": %.3f,\n", b->seconds);
+
+	if (suite_new_state(b))
+		return -1;
+
+	state = new_bench_state(b, NULL);
+	if (state == NULL)
+		return -1;
+
+	fprintf(b->out, "  \"songs\": [\n");
+	for (i = 0; i < nsongs; i++) {
+		fprintf(b->out, "    {\n      \"song\": ");
+		json_string(b->out, songs[i]);
+		fprintf(b->out, ",\n");
+		if (suite_song(b, songs[i], state) ||
+		    suite_quality(b, songs[i])) {
+			uade_cleanup_state(state);
+			return -1;
+		}
+		fprintf(b->out, "      \"render\": [\n");
+		for (j = 0; j < nconfigs; j++) {
+			if (suite_render(b, songs[i], &render_configs[j],
+					 j == nconfigs - 1)) {
+				uade_cleanup_state(state);
+				return -1;
+			}
+		}
+		fprintf(b->out, "      ]\n    }%s\n", i < nsongs - 1 ? "," : "");
+	}
+	fprintf(b->out, "  ],\n");
+	uade_cleanup_state(state);
+
+	if (suite_effects(b))
+		return -1;
+
+	fprintf(b->out, "  \"complete\": true\n}\n");
+	return 0;
+}
+
+static void usage(const char *name)
+{
+	printf("Usage: %s [-n states] [-p poolsize] [--basedir=dir] [-u uadecore]\n",
+	       name);
+	printf("       %s --json [-o file] [-r repeats] [-t seconds] [-P player] [-S score] [--basedir=dir] [-u uadecore] song ...\n",
+	       name);
+}
+
+int main(int argc, char *argv[])
+{
+	int n = 100;
+	int poolsize = 0;
+	int json = 0;
+	int ret;
+	const char *outputname = NULL;
+	struct bench b = {.seconds = 30.0, .repeats = 5};
+	struct uade_config *uc = uade_new_config();
+	const struct option long_options[] = {
+		{"basedir", 1, NULL, 'b'},
+		{"help", 0, NULL, 'h'},
+		{"json", 0, NULL, 'j'},
+		{NULL, 0, NULL, 0}
+	};
+
+	if (uc == NULL)
+		return 1;
+
+	while ((ret = getopt_long(argc, argv, "hjn:o:p:P:r:S:t:u:", long_options, 0)) != -1) {
+		switch (ret) {
+		case 'b':
+			uade_config_set_option(uc, UC_BASE_DIR, optarg);
+			b.basedir = optarg;
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		case 'j':
+			json = 1;
+			break;
+		case 'n':
+			n = atoi(optarg);
+			if (n <= 0) {
+				fprintf(stderr, "Invalid number of states: %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'o':
+			outputname = optarg;
+			break;
+		case 'p':
+			poolsize = atoi(optarg);
+			break;
+		case 'P':
+			b.player = optarg;
+			break;
+		case 'r':
+			b.repeats = atoi(optarg);
+			if (b.repeats <= 0) {
+				fprintf(stderr, "Invalid number of repeats: %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'S':
+			b.score = optarg;
+			break;
+		case 't':
+			b.seconds = atof(optarg);
+			if (b.seconds <= 0) {
+				fprintf(stderr, "Invalid render time: %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'u':
+			uade_config_set_option(uc, UC_UADECORE_FILE, optarg);
+			b.uadecore = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (json) {
+		free(uc);
+		if (optind == argc) {
+			fprintf(stderr, "No songs given\n");
+			return 1;
+		}
+		b.nstates = n;
+		b.out = stdout;
+		if (outputname != NULL) {
+			b.out = fopen(outputname, "w");
+			if (b.out == NULL) {
+				fprintf(stderr, "Can not open %s\n", outputname);
+				return 1;
+			}
+		}
+		ret = run_suite(&b, &argv[optind], argc - optind);
+		free(b.pcm);
+		if (b.out != stdout && fclose(b.out)) {
+			fprintf(stderr, "Can not write %s\n", outputname);
+			ret = -1;
+		}
+		return ret ? 1 : 0;
+	}
+
+	if (bench_new_state(n, uc) || bench_new_state_from_context(n, uc, 0) ||
+	    (poolsize > 0 && bench_new_state_from_context(n, uc, poolsize))) {
+		free(uc);
+		return 1;
+	}
+	free(uc);
+	return 0;
+}
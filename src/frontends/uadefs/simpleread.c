@@ -1,38 +1,139 @@
+/*
+ * simpleread reads files through. It is used for stress testing uadefs:
+ *
+ *   simpleread [-j N] file ...
+ *
+ * reads the files with N parallel readers and prints the throughput.
+ * Pass the same file several times to test concurrent reads of one song.
+ */
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <pthread.h>
 
-int main(int argc, char *argv[])
+static char **files;
+static int nfiles;
+static int nextfile;
+static int fail;
+static long long totalbytes;
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static long long read_file(const char *fname)
 {
-	int i;
 	char buf[4096];
+	long long bytes = 0;
 	int fd;
 	int ret;
-	int fail = 0;
 
-	for (i = 1; i < argc; i++) {
-		fd = open(argv[i], O_RDONLY);
-		if (fd < 0) {
+	fd = open(fname, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	while (1) {
+		ret = read(fd, buf, sizeof buf);
+		if (ret == 0)
+			break;
+		if (ret < 0) {
+			if (errno == EAGAIN || errno == EINTR)
+				continue;
+			bytes = -1;
+			break;
+		}
+		bytes += ret;
+	}
+	close(fd);
+	return bytes;
+}
+
+static void *reader(void *arg)
+{
+	long long bytes;
+	int i;
+
+	(void) arg;
+
+	while (1) {
+		pthread_mutex_lock(&mutex);
+		i = nextfile++;
+		pthread_mutex_unlock(&mutex);
+
+		if (i >= nfiles)
+			break;
+
+		bytes = read_file(files[i]);
+
+		pthread_mutex_lock(&mutex);
+		if (bytes < 0) {
+			fprintf(stderr, "simpleread: Can not read %s\n", files[i]);
 			fail = 1;
-			continue;
+		} else {
+			totalbytes += bytes;
 		}
-		while (1) {
-			ret = read(fd, buf, sizeof buf);
-			if (ret == 0)
-				break;
-			if (ret < 0) {
-				if (errno == EAGAIN || errno == EINTR)
-					continue;
-				fail = 1;
-				break;
+		pthread_mutex_unlock(&mutex);
+	}
+
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	int i;
+	int nthreads = 1;
+	int ret;
+	pthread_t *threads;
+	struct timeval t0, t1;
+	double secs;
+
+	while ((ret = getopt(argc, argv, "j:")) != -1) {
+		switch (ret) {
+		case 'j':
+			nthreads = atoi(optarg);
+			if (nthreads <= 0) {
+				fprintf(stderr, "simpleread: Invalid number of readers: %s\n", optarg);
+				return 1;
 			}
+			break;
+		default:
+			fprintf(stderr, "usage: simpleread [-j N] file ...\n");
+			return 1;
 		}
-		close(fd);
 	}
 
+	files = &argv[optind];
+	nfiles = argc - optind;
+
+	threads = calloc(nthreads, sizeof threads[0]);
+	if (threads == NULL) {
+		fprintf(stderr, "simpleread: No memory\n");
+		return 1;
+	}
+
+	gettimeofday(&t0, NULL);
+
+	for (i = 0; i < nthreads; i++) {
+		if (pthread_create(&threads[i], NULL, reader, NULL)) {
+			fprintf(stderr, "simpleread: Can not create a thread\n");
+			return 1;
+		}
+	}
+
+	for (i = 0; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+
+	gettimeofday(&t1, NULL);
+
+	secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_usec - t0.tv_usec) / 1000000.0;
+	if (secs > 0 && nthreads > 1) {
+		printf("%d files, %d readers: %lld bytes in %.3f s (%.2f MiB/s)\n",
+		       nfiles, nthreads, totalbytes, secs,
+		       totalbytes / secs / (1024 * 1024));
+	}
+
+	free(threads);
 	return fail;
 }
@@ -48,6 +48,8 @@
 #include <time.h>
 
 #include <uade/uade.h>
+#include <uade/songdb.h>
+#include <uade/ossupport.h>
 
 
 #define WAV_HEADER_LEN 44
@@ -62,6 +64,26 @@
 #define STASH_SIZE (CACHE_BLOCK_SIZE * STASH_CACHE_BLOCKS)
 #define STASH_TIME 30
 
+/* A decoder keeps this many blocks ahead of the furthest read */
+#define DECODE_AHEAD_BLOCKS 16
+
+/*
+ * A read that is further than this from the decoders of the song starts
+ * a new decoder that seeks to the read position
+ */
+#define SEEK_SECONDS 10
+#define MAX_DECODERS 3
+
+/*
+ * Stopped uade states are kept for reuse so that a decoder need not start
+ * a uadecore. UADECORE_POOL_SIZE uadecores are also kept warm for new
+ * states.
+ */
+#define STATE_POOL_SIZE 8
+#define UADECORE_POOL_SIZE 2
+
+#define FILETABLE_SIZE 256
+
 #define DEBUG(fmt, args...) if (debugmode) { fprintf(stderr, fmt, ## args); }
 
 #define LOG(fmt, args...) if (debugfd != -1) { \
@@ -85,15 +107,49 @@ struct cacheblock {
 	void *data;
 };
 
+struct sndctx;
+
+/*
+ * A decoder is a thread that plays the song with libuade from start_bi
+ * onwards and stores the blocks in the cache. A song has several decoders
+ * when it is read from far apart positions. Decoders produce identical
+ * data for the same block, so blocks are merged into one cache.
+ * All fields are protected by the lock of the song.
+ */
+struct decoder {
+	struct sndctx *ctx;
+	pthread_t thread;
+	int active;           /* the thread has been created and not joined */
+	int quit;             /* the decoder does not produce more blocks */
+	int done;             /* the thread has released its uade state */
+	size_t start_bi;      /* the block where the decoder started */
+	size_t bi;            /* the next block to decode */
+	size_t want_bi;       /* the furthest block requested from the decoder */
+};
+
 struct sndctx {
 	int normalfile;       /* if non-zero, the file is not decoded */
-	int pipefd;           /* pipefd from which to read sound data */
-	pid_t pid;            /* pid of the decoding process */
 	char fname[PATH_MAX]; /* filename of the song being played */
+	ssize_t filesize;     /* WAV file size, see get_file_size() */
 
 	size_t nblocks;
-	size_t end_bi;
+	size_t eof_bi;        /* the first block past the end of the song */
 	struct cacheblock *blocks;
+
+	/*
+	 * lock protects the cache and the decoders. Readers wait on ready
+	 * for new blocks. Decoders wait on wake until readers want more
+	 * blocks.
+	 */
+	pthread_mutex_t lock;
+	pthread_cond_t ready;
+	pthread_cond_t wake;
+	struct decoder decoders[MAX_DECODERS];
+	int status;           /* 1 while warming up, 0 when ready, < 0 on error */
+
+	/* Open-file table entry, protected by filetablemutex */
+	int refcount;
+	struct sndctx *next;
 };
 
 struct stash {
@@ -107,10 +163,29 @@ struct stash {
 static char *srcdir = NULL;
 static int debugfd = -1;
 static int debugmode;
-static struct uade_state uadestate;
+static struct uade_context *uadecontext;
+static struct uade_state *uadestate;
 static time_t mtime = 0;
-static pthread_mutex_t readmutex = PTHREAD_MUTEX_INITIALIZER;
 
+/*
+ * uademutex serializes the use of uadestate, which is used for file type
+ * detection and the content database. Each decoder has a uade state of its
+ * own. Each open song has its own lock in struct sndctx.
+ */
+static pthread_mutex_t uademutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Open songs are shared between file handles through the open-file table,
+ * so that concurrent opens of a song use one decoder and one cache.
+ */
+static pthread_mutex_t filetablemutex = PTHREAD_MUTEX_INITIALIZER;
+static struct sndctx *filetable[FILETABLE_SIZE];
+
+static pthread_mutex_t poolmutex = PTHREAD_MUTEX_INITIALIZER;
+static struct uade_state *statepool[STATE_POOL_SIZE];
+static int npooled;
+
+static pthread_mutex_t stashmutex = PTHREAD_MUTEX_INITIALIZER;
 int nextstash;
 struct stash stashes[NSTASHES];
 
@@ -119,7 +194,12 @@ static ssize_t get_file_size(const char *path);
 
 static size_t snd_per_second(void)
 {
-	return 4 * uadestate.permconfig.frequency;
+	return UADE_BYTES_PER_FRAME * uade_get_sampling_rate(uadestate);
+}
+
+static size_t seek_blocks(void)
+{
+	return (snd_per_second() * SEEK_SECONDS) >> CACHE_BLOCK_SHIFT;
 }
 
 /*
@@ -166,6 +246,17 @@ ssize_t read_in_full(int fd, void *buf, size_t count)
 	return total;
 }
 
+static int is_uade_file(const char *path)
+{
+	int ret;
+
+	pthread_mutex_lock(&uademutex);
+	ret = uade_is_our_file(path, uadestate);
+	pthread_mutex_unlock(&uademutex);
+
+	return ret;
+}
+
 static char *uadefs_get_path(int *isuade, const char *path)
 {
 	char *realpath;
@@ -188,7 +279,7 @@ static char *uadefs_get_path(int *isuade, const char *path)
 
 	*sep = 0;
 
-	if (uade_is_our_file(realpath, 1, &uadestate)) {
+	if (is_uade_file(realpath)) {
 		if (isuade)
 			*isuade = 1;
 	} else {
@@ -199,53 +290,365 @@ out:
 	return realpath;
 }
 
-static int spawn_uade(struct sndctx *ctx)
+static void write_le_32(char *data, int32_t v)
+{
+	data[0] = v         & 0xff;
+	data[1] = (v >> 8)  & 0xff;
+	data[2] = (v >> 16) & 0xff;
+	data[3] = (v >> 24) & 0xff;
+}
+
+static void write_le_16(char *data, int16_t v)
+{
+	data[0] = v         & 0xff;
+	data[1] = (v >> 8)  & 0xff;
+}
+
+static void write_wav_header(char *data, ssize_t filesize)
 {
-	int fds[2];
+	int rate = uade_get_sampling_rate(uadestate);
+
+	memcpy(data, "RIFF", 4);
+	write_le_32(data + 4, (int32_t) (filesize - 8));
+	memcpy(data + 8, "WAVEfmt ", 8);
+	write_le_32(data + 16, 16);
+	write_le_16(data + 20, 1); /* PCM */
+	write_le_16(data + 22, UADE_CHANNELS);
+	write_le_32(data + 24, rate);
+	write_le_32(data + 28, rate * UADE_BYTES_PER_FRAME);
+	write_le_16(data + 32, UADE_BYTES_PER_FRAME);
+	write_le_16(data + 34, 8 * UADE_BYTES_PER_SAMPLE);
+	memcpy(data + 36, "data", 4);
+	write_le_32(data + 40, (int32_t) (filesize - WAV_HEADER_LEN));
+}
 
-	DEBUG("Spawn UADE %s\n", ctx->fname);
+/* WAV data is little endian */
+static void to_le_samples(char *data, size_t bytes)
+{
+	const uint16_t one = 1;
+	size_t i;
+	char t;
 
-	if (pipe(fds)) {
-		LOG("Can not create a pipe\n");
-		return -errno;
+	if (*((const uint8_t *) &one) == 1)
+		return;
+
+	for (i = 0; i + 1 < bytes; i += 2) {
+		t = data[i];
+		data[i] = data[i + 1];
+		data[i + 1] = t;
+	}
+}
+
+/* Returns the sample frame where the cache block begins */
+static ssize_t block_to_frame(size_t bi)
+{
+	return ((bi << CACHE_BLOCK_SHIFT) - WAV_HEADER_LEN) / UADE_BYTES_PER_FRAME;
+}
+
+/*
+ * Synthesizes one cache block. Returns the number of bytes, which is less
+ * than CACHE_BLOCK_SIZE at the end of the song, or -1 on error.
+ */
+static ssize_t decode_block(char *data, size_t bi, struct sndctx *ctx,
+			    struct uade_state *state)
+{
+	size_t fill = 0;
+	ssize_t res;
+
+	if (bi == 0) {
+		write_wav_header(data, ctx->filesize);
+		fill = WAV_HEADER_LEN;
+	}
+
+	while (fill < CACHE_BLOCK_SIZE) {
+		res = uade_read(data + fill, CACHE_BLOCK_SIZE - fill, state);
+		if (res < 0) {
+			LOG("Decoding error at %zd: %s\n", bi << CACHE_BLOCK_SHIFT, ctx->fname);
+			return -1;
+		}
+		if (res == 0)
+			break;
+
+		to_le_samples(data + fill, res);
+		fill += res;
 	}
 
-	ctx->pid = fork();
-	if (ctx->pid == 0) {
-		char *argv[] = {"uade123", "-c", "-k0", "--stderr", "-v",
-				ctx->fname, NULL};
-		int fd;
+	return fill;
+}
 
-		close(0);
-		close(2);
-		close(fds[0]);
+/*
+ * Returns 1 if another decoder has already decoded the next block of dec,
+ * and continues from there. The furthest request is passed to it.
+ * Must be called with ctx->lock held.
+ */
+static int hand_over(struct decoder *dec)
+{
+	struct sndctx *ctx = dec->ctx;
+	struct decoder *other;
+	int i;
 
-		fd = open("/dev/null", O_RDWR);
-		if (fd < 0)
-			LOGDIE("Can not open /dev/null\n");
+	for (i = 0; i < MAX_DECODERS; i++) {
+		other = &ctx->decoders[i];
+		if (other == dec || !other->active || other->quit)
+			continue;
 
-		dup2(fd, 0);
-		dup2(fds[1], 1);
-		dup2(fd, 2);
+		if (other->start_bi <= dec->bi && dec->bi < other->bi) {
+			other->want_bi = MAX(other->want_bi, dec->want_bi);
+			pthread_cond_broadcast(&ctx->wake);
+			return 1;
+		}
+	}
+
+	return 0;
+}
 
-		DEBUG("Execute %s\n", UADENAME);
+/* Returns a stopped uade state from the pool, or a new one */
+static struct uade_state *get_uade_state(void)
+{
+	struct uade_state *state = NULL;
 
-		execv(UADENAME, argv);
+	pthread_mutex_lock(&poolmutex);
+	if (npooled > 0)
+		state = statepool[--npooled];
+	pthread_mutex_unlock(&poolmutex);
 
-		LOGDIE("Could not execute %s\n", UADENAME);
-	} else if (ctx->pid == -1) {
-		LOG("Can not fork\n");
-		close(fds[0]);
-		close(fds[1]);
-		return -errno;
+	if (state == NULL)
+		state = uade_new_state_from_context(uadecontext, NULL);
+
+	return state;
+}
+
+/*
+ * Stops the song if 'playing' is non-zero, and returns the state to the
+ * pool. The state is freed if the pool is full or the state is broken.
+ */
+static void put_uade_state(struct uade_state *state, int playing)
+{
+	if (state == NULL)
+		return;
+
+	if (playing && uade_stop(state)) {
+		uade_cleanup_state(state);
+		return;
+	}
+
+	pthread_mutex_lock(&poolmutex);
+	if (npooled < STATE_POOL_SIZE) {
+		statepool[npooled++] = state;
+		state = NULL;
+	}
+	pthread_mutex_unlock(&poolmutex);
+
+	uade_cleanup_state(state);
+}
+
+/*
+ * The decoder thread plays the song with libuade and copies sound data
+ * into cache blocks. libuade is called without holding ctx->lock so that
+ * readers of cached blocks are not blocked by a slow decoder.
+ */
+static void *decoder_thread(void *arg)
+{
+	struct decoder *dec = arg;
+	struct sndctx *ctx = dec->ctx;
+	struct uade_state *state;
+	struct cacheblock *cb;
+	size_t bi;
+	char *data;
+	ssize_t res;
+	int ret = -1;
+
+	state = get_uade_state();
+	if (state != NULL)
+		ret = uade_play(ctx->fname, -1, state);
+
+	if (ret != 1) {
+		LOG("Can not play %s\n", ctx->fname);
+		/* A fatal error (-1) breaks the state */
+		if (ret == 0)
+			put_uade_state(state, 0);
+		else
+			uade_cleanup_state(state);
+		state = NULL;
+	} else if (dec->start_bi > 0) {
+		DEBUG("Seek to %zd: %s\n", dec->start_bi << CACHE_BLOCK_SHIFT, ctx->fname);
+		uade_seek_samples(UADE_SEEK_SONG_RELATIVE,
+				  block_to_frame(dec->start_bi), 0, state);
+	}
+
+	pthread_mutex_lock(&ctx->lock);
+
+	if (state == NULL)
+		ctx->eof_bi = MIN(ctx->eof_bi, dec->bi);
+
+	while (state != NULL && !dec->quit) {
+		bi = dec->bi;
+		if (bi >= ctx->eof_bi)
+			break;
+
+		if (bi > dec->want_bi + DECODE_AHEAD_BLOCKS) {
+			pthread_cond_wait(&ctx->wake, &ctx->lock);
+			continue;
+		}
+
+		if (ctx->blocks[bi].data != NULL && hand_over(dec)) {
+			DEBUG("Merged decoder at %zd: %s\n", bi << CACHE_BLOCK_SHIFT, ctx->fname);
+			break;
+		}
+
+		pthread_mutex_unlock(&ctx->lock);
+
+		data = malloc(CACHE_BLOCK_SIZE);
+		if (data == NULL) {
+			LOG("Out of memory: %s\n", ctx->fname);
+			res = -1;
+		} else {
+			res = decode_block(data, bi, ctx, state);
+		}
+
+		pthread_mutex_lock(&ctx->lock);
+
+		if (res <= 0) {
+			free(data);
+			ctx->eof_bi = MIN(ctx->eof_bi, bi);
+			break;
+		}
+
+		/* Another decoder may have produced the same block */
+		cb = &ctx->blocks[bi];
+		if (cb->data == NULL) {
+			cb->data = data;
+			cb->bytes = res;
+		} else {
+			free(data);
+		}
+
+		dec->bi = bi + 1;
+
+		if (res < CACHE_BLOCK_SIZE) {
+			ctx->eof_bi = MIN(ctx->eof_bi, dec->bi);
+			break;
+		}
+
+		pthread_cond_broadcast(&ctx->ready);
+	}
+
+	dec->quit = 1;
+	pthread_cond_broadcast(&ctx->ready);
+	pthread_mutex_unlock(&ctx->lock);
+
+	put_uade_state(state, 1);
+
+	pthread_mutex_lock(&ctx->lock);
+	dec->done = 1;
+	pthread_cond_broadcast(&ctx->ready);
+	pthread_mutex_unlock(&ctx->lock);
+
+	return NULL;
+}
+
+/*
+ * Returns the decoder that is going to decode block bi soon, or has just
+ * decoded it. Returns NULL if there is no such decoder.
+ * Must be called with ctx->lock held.
+ */
+static struct decoder *find_decoder(struct sndctx *ctx, size_t bi)
+{
+	struct decoder *dec;
+	struct decoder *best = NULL;
+	int i;
+
+	for (i = 0; i < MAX_DECODERS; i++) {
+		dec = &ctx->decoders[i];
+		if (!dec->active || dec->quit)
+			continue;
+
+		if (dec->start_bi > bi || bi >= dec->bi + seek_blocks())
+			continue;
+
+		if (best == NULL || dec->start_bi > best->start_bi)
+			best = dec;
 	}
 
-	ctx->pipefd = fds[0];
-	close(fds[1]);
+	return best;
+}
+
+/*
+ * Starts a decoder for block bi. If all decoders are busy, the one that
+ * has been idle the longest is asked to quit, and the caller must wait on
+ * ctx->ready and try again. Returns 0 on success, and a negative errno
+ * value on error. Must be called with ctx->lock held.
+ */
+static int start_decoder(struct sndctx *ctx, size_t bi)
+{
+	struct decoder *dec = NULL;
+	struct decoder *victim = NULL;
+	int ret;
+	int i;
+
+	for (i = 0; i < MAX_DECODERS; i++) {
+		dec = &ctx->decoders[i];
+
+		if (dec->active && dec->done) {
+			pthread_join(dec->thread, NULL);
+			dec->active = 0;
+		}
+
+		if (!dec->active)
+			break;
+
+		if (!dec->quit && (victim == NULL || dec->want_bi < victim->want_bi))
+			victim = dec;
+	}
+
+	if (i == MAX_DECODERS) {
+		if (victim != NULL) {
+			DEBUG("Stop decoder at %zd: %s\n", victim->bi << CACHE_BLOCK_SHIFT, ctx->fname);
+			victim->quit = 1;
+			pthread_cond_broadcast(&ctx->wake);
+		}
+		return 0;
+	}
+
+	/* Seeking is not worth it near the beginning */
+	if (bi < seek_blocks())
+		bi = 0;
+
+	memset(dec, 0, sizeof dec[0]);
+	dec->ctx = ctx;
+	dec->start_bi = bi;
+	dec->bi = bi;
+	dec->want_bi = bi;
 
+	ret = pthread_create(&dec->thread, NULL, decoder_thread, dec);
+	if (ret) {
+		LOG("Can not create a decoder thread: %s\n", ctx->fname);
+		return -ret;
+	}
+
+	dec->active = 1;
 	return 0;
 }
 
+/* Must be called without ctx->lock */
+static void stop_decoders(struct sndctx *ctx)
+{
+	int i;
+
+	pthread_mutex_lock(&ctx->lock);
+	for (i = 0; i < MAX_DECODERS; i++)
+		ctx->decoders[i].quit = 1;
+	pthread_cond_broadcast(&ctx->wake);
+	pthread_mutex_unlock(&ctx->lock);
+
+	for (i = 0; i < MAX_DECODERS; i++) {
+		if (ctx->decoders[i].active) {
+			pthread_join(ctx->decoders[i].thread, NULL);
+			ctx->decoders[i].active = 0;
+		}
+	}
+}
+
 static ssize_t cache_block_read(struct sndctx *ctx, char *buf, size_t offset,
 				size_t size)
 {
@@ -283,81 +686,44 @@ static ssize_t cache_block_read(struct sndctx *ctx, char *buf, size_t offset,
 
 static void cache_init(struct sndctx *ctx)
 {
-	ctx->end_bi = 0;
 	ctx->nblocks = (snd_per_second() * CACHE_SECONDS + CACHE_BLOCK_SIZE - 1) >> CACHE_BLOCK_SHIFT;
+	ctx->eof_bi = ctx->nblocks;
 	ctx->blocks = calloc(1, ctx->nblocks * sizeof(ctx->blocks[0]));
 	if (ctx->blocks == NULL)
 		LOGDIE("No memory for cache\n");
 }
 
+/* Must be called with ctx->lock held */
 static size_t cache_read(struct sndctx *ctx, char *buf, size_t offset,
 			 size_t size)
 {
 	size_t offset_bi;
-	struct cacheblock *cb;
+	struct decoder *dec;
 	ssize_t res;
 
 	offset_bi = offset >> CACHE_BLOCK_SHIFT;
 
-	if (offset_bi >= STASH_CACHE_BLOCKS && ctx->pid == -1) {
-		char buf[CACHE_BLOCK_SIZE];
-		int i;
-
-		if (spawn_uade(ctx))
+	while (1) {
+		if (offset_bi >= ctx->eof_bi)
 			return 0;
 
-		for (i = 0; i < STASH_CACHE_BLOCKS; i++) {
-			res = read_in_full(ctx->pipefd, buf, sizeof buf);
-			if (res < sizeof buf)
-				return 0;
-		}
-	}
-
-	/* The requested block is already in cache, copy it directly */
-	res = cache_block_read(ctx, buf, offset, size);
-	if (res >= 0)
-		return (size_t) res;
-
-	if (offset_bi >= ctx->nblocks) {
-		LOG("Too much sound data: %s\n", ctx->fname);
-		return 0;
-	}
-
-	/*
-	 * Read cache blocks in sequence until the requested cache block
-	 * has been read. ctx->end_bi is increased every time a new block
-	 * is read. ctx->end_bi points to the first block that is not cached.
-	 */
-	while (ctx->end_bi <= offset_bi) {
-		cb = &ctx->blocks[ctx->end_bi];
-
-		cb->data = malloc(CACHE_BLOCK_SIZE);
-		if (cb->data == NULL) {
-			LOG("Out of memory: %s\n", ctx->fname);
-			break;
-		}
-
-		res = read_in_full(ctx->pipefd, cb->data, CACHE_BLOCK_SIZE);
-		if (res <= 0) {
-			free(cb->data);
-			cb->data = NULL;
-			DEBUG("Read code %d at %zd: %s\n", (int) res, ctx->end_bi << CACHE_BLOCK_SHIFT, ctx->fname);
-			break;
+		dec = find_decoder(ctx, offset_bi);
+		if (dec != NULL && offset_bi > dec->want_bi) {
+			dec->want_bi = offset_bi;
+			pthread_cond_broadcast(&ctx->wake);
 		}
 
-		cb->bytes = res;
+		/* The requested block is already in cache, copy it directly */
+		res = cache_block_read(ctx, buf, offset, size);
+		if (res >= 0)
+			return (size_t) res;
 
-		ctx->end_bi++;
+		/* Start a new decoder, with a seek if the block is far away */
+		if (dec == NULL && start_decoder(ctx, offset_bi) < 0)
+			return 0;
 
-		if (res < CACHE_BLOCK_SIZE)
-			break;
+		pthread_cond_wait(&ctx->ready, &ctx->lock);
 	}
-
-	res = cache_block_read(ctx, buf, offset, size);
-	if (res >= 0)
-		return (size_t) res;
-
-	return 0;
 }
 
 int cache_prefill(struct sndctx *ctx, char *data)
@@ -367,8 +733,6 @@ int cache_prefill(struct sndctx *ctx, char *data)
 	if (data == NULL)
 		LOGDIE("Prefill segfault: %s\n", ctx->fname);
 
-	ctx->end_bi = STASH_CACHE_BLOCKS;
-
 	for (i = 0; i < STASH_CACHE_BLOCKS; i++) {
 		ctx->blocks[i].data = malloc(CACHE_BLOCK_SIZE);
 		if (ctx->blocks[i].data == NULL) {
@@ -387,6 +751,7 @@ int cache_prefill(struct sndctx *ctx, char *data)
 				break;
 			free(ctx->blocks[i].data);
 			ctx->blocks[i].data = NULL;
+			ctx->blocks[i].bytes = 0;
 		}
 		return -1;
 	}
@@ -394,32 +759,6 @@ int cache_prefill(struct sndctx *ctx, char *data)
 	return 0;
 }
 
-static void write_le_32(char *data, int32_t v)
-{
-	data[0] = v         & 0xff;
-	data[1] = (v >> 8)  & 0xff;
-	data[2] = (v >> 16) & 0xff;
-	data[3] = (v >> 24) & 0xff;
-}
-
-static void cache_invasive_write(struct sndctx *ctx, size_t offset,
-				 char *data, size_t len)
-{
-	size_t offset_bi = offset >> CACHE_BLOCK_SHIFT;
-	size_t lsbpos = offset & CACHE_LSB_MASK;
-	struct cacheblock *cb;
-
-	if (offset_bi >= ctx->end_bi) {
-		LOG("Invasive cache write: %zu\n", offset);
-		return;
-	}
-
-	cb = &ctx->blocks[offset_bi];
-
-	if ((lsbpos + len) <= cb->bytes)
-		memcpy(((char *) cb->data) + lsbpos, data, len);
-}
-
 static struct sndctx *create_ctx(const char *path)
 {
 	struct sndctx *ctx;
@@ -430,8 +769,9 @@ static struct sndctx *create_ctx(const char *path)
 
 	strlcpy(ctx->fname, path, sizeof ctx->fname);
 
-	ctx->pipefd = -1;
-	ctx->pid = -1;
+	pthread_mutex_init(&ctx->lock, NULL);
+	pthread_cond_init(&ctx->ready, NULL);
+	pthread_cond_init(&ctx->wake, NULL);
 
 	return ctx;
 }
@@ -449,30 +789,18 @@ static void destroy_cache(struct sndctx *ctx)
 
 		free(ctx->blocks);
 		ctx->blocks = NULL;
-		ctx->end_bi = 0;
+		ctx->eof_bi = 0;
 		ctx->nblocks = 0;
 	}
 }
 
-static void kill_child(struct sndctx *ctx)
-{
-	if (ctx->pid != -1) {
-		kill(ctx->pid, SIGINT);
-		while (waitpid(ctx->pid, NULL, 0) <= 0);
-		ctx->pid = -1;
-	}
-}
-
 static void set_no_snd_file(struct sndctx *ctx)
 {
 	ctx->normalfile = 1;
 
-	destroy_cache(ctx);
+	stop_decoders(ctx);
 
-	kill_child(ctx);
-
-	close(ctx->pipefd);
-	ctx->pipefd = -1;
+	destroy_cache(ctx);
 }
 
 static void destroy_ctx(struct sndctx *ctx)
@@ -482,6 +810,10 @@ static void destroy_ctx(struct sndctx *ctx)
 	if (ctx->normalfile == 0)
 		set_no_snd_file(ctx);
 
+	pthread_cond_destroy(&ctx->wake);
+	pthread_cond_destroy(&ctx->ready);
+	pthread_mutex_destroy(&ctx->lock);
+
 	free(ctx);
 }
 
@@ -490,6 +822,75 @@ static inline struct sndctx *get_uadefs_file(struct fuse_file_info *fi)
 	return (struct sndctx *) (uintptr_t) fi->fh;
 }
 
+static unsigned int filetable_hash(const char *fname)
+{
+	unsigned int h = 5381;
+
+	while (*fname)
+		h = h * 33 + (unsigned char) *fname++;
+
+	return h % FILETABLE_SIZE;
+}
+
+/*
+ * Returns a referenced song context for the path from the open-file table.
+ * A new context is created if the song is not open. *created is set to 1
+ * if the caller must warm up the new context.
+ */
+static struct sndctx *get_ctx(int *created, const char *path)
+{
+	unsigned int h = filetable_hash(path);
+	struct sndctx *ctx;
+
+	*created = 0;
+
+	pthread_mutex_lock(&filetablemutex);
+
+	for (ctx = filetable[h]; ctx != NULL; ctx = ctx->next) {
+		if (strcmp(ctx->fname, path) == 0)
+			break;
+	}
+
+	if (ctx == NULL) {
+		ctx = create_ctx(path);
+		if (ctx != NULL) {
+			ctx->status = 1;
+			ctx->next = filetable[h];
+			filetable[h] = ctx;
+			*created = 1;
+		}
+	}
+
+	if (ctx != NULL)
+		ctx->refcount++;
+
+	pthread_mutex_unlock(&filetablemutex);
+
+	return ctx;
+}
+
+/* Drops a reference, and destroys the context when it is no longer used */
+static void put_ctx(struct sndctx *ctx)
+{
+	struct sndctx **p;
+	int unused;
+
+	pthread_mutex_lock(&filetablemutex);
+
+	unused = (--ctx->refcount == 0);
+	if (unused) {
+		p = &filetable[filetable_hash(ctx->fname)];
+		while (*p != ctx)
+			p = &(*p)->next;
+		*p = ctx->next;
+	}
+
+	pthread_mutex_unlock(&filetablemutex);
+
+	if (unused)
+		destroy_ctx(ctx);
+}
+
 static int check_stash(const char *fname, struct stash *stash, time_t t)
 {
 	if (strcmp(fname, stash->fname) != 0)
@@ -502,61 +903,53 @@ static int check_stash(const char *fname, struct stash *stash, time_t t)
 	return 1;
 }
 
+/* Must be called with ctx->lock held */
 int warm_up_cache(struct sndctx *ctx)
 {
 	char crapbuf[STASH_SIZE];
-	ssize_t s;
 	int i;
+	int ret;
 	struct stash *stash;
 	size_t offs;
 	time_t created;
 
+	/* The WAV header is generated with this size */
+	ctx->filesize = get_file_size(ctx->fname);
+	if (ctx->filesize <= 0)
+		return -EIO;
+
 	created = time(NULL);
 	if (created == ((time_t) -1)) {
 		LOG("Clock failed\n");
 		created = 0;
 	}
 
+	pthread_mutex_lock(&stashmutex);
 	for (i = 0; i < NSTASHES; i++) {
 		if (check_stash(ctx->fname, &stashes[i], created)) {
 			DEBUG("Found stash for %s\n", ctx->fname);
-			if (cache_prefill(ctx, stashes[i].data))
+			ret = cache_prefill(ctx, stashes[i].data);
+			pthread_mutex_unlock(&stashmutex);
+			if (ret)
 				return -EIO;
 			break;
 		}
 	}
+	if (i == NSTASHES)
+		pthread_mutex_unlock(&stashmutex);
 
-	/* Start uade iff no stash found */
-	if (i == NSTASHES) {
-		int ret = spawn_uade(ctx);
-		if (ret)
-			return ret;
-	}
-
+	/* A decoder is started iff no stash was found */
 	for (offs = 0; offs < sizeof crapbuf; offs += CACHE_BLOCK_SIZE) {
 		if (cache_read(ctx, &crapbuf[offs], offs, CACHE_BLOCK_SIZE) < CACHE_BLOCK_SIZE) {
 			DEBUG("File is not playable: %s\n", ctx->fname);
-			set_no_snd_file(ctx);
 			return -EIO;
 		}
 	}
 
-	s = get_file_size(ctx->fname);
-	if (s > 0 &&
-	    memcmp(&crapbuf[0], "RIFF", 4) == 0 &&
-	    memcmp(&crapbuf[8], "WAVE", 4) == 0    ) {
-		/* Fix WAV header */
-		char data[4];
-
-		write_le_32(data, (int32_t) (s - 8));
-		cache_invasive_write(ctx, 4, data, 4);
-
-		write_le_32(data, (int32_t) (s - 44));
-		cache_invasive_write(ctx, 40, data, 4);
-	}
-
 	if (i == NSTASHES) {
 		/* We found no stash -> create one from crapbuf */
+		pthread_mutex_lock(&stashmutex);
+
 		stash = &stashes[nextstash++];
 		if (nextstash >= NSTASHES)
 			nextstash = 0;
@@ -568,6 +961,8 @@ int warm_up_cache(struct sndctx *ctx)
 		strlcpy(stash->fname, ctx->fname, sizeof stash->fname);
 		memcpy(stash->data, crapbuf, sizeof stash->data);
 
+		pthread_mutex_unlock(&stashmutex);
+
 		DEBUG("Allocated stash for %s\n", ctx->fname);
 	}
 
@@ -577,40 +972,58 @@ int warm_up_cache(struct sndctx *ctx)
 static struct sndctx *open_file(int *success, const char *path, int isuade)
 {
 	int ret;
+	int created;
 	struct sndctx *ctx;
 	struct stat st;
 
-	ctx = create_ctx(path);
-	if (ctx == NULL) {
-		ret = -ENOMEM;
-		goto err;
-	}
-
 	if (stat(path, &st)) {
-		ret = -errno;
-		goto err;
+		*success = -errno;
+		return NULL;
 	}
 
 	if (!S_ISREG(st.st_mode) || !isuade) {
-		set_no_snd_file(ctx);
-		goto out;
+		/* Normal files are not shared through the open-file table */
+		ctx = create_ctx(path);
+		if (ctx == NULL) {
+			*success = -ENOMEM;
+			return NULL;
+		}
+		ctx->normalfile = 1;
+		*success = 0;
+		return ctx;
 	}
 
-	cache_init(ctx);
+	ctx = get_ctx(&created, path);
+	if (ctx == NULL) {
+		*success = -ENOMEM;
+		return NULL;
+	}
 
-	ret = warm_up_cache(ctx);
-	if (ret < 0)
-		goto err;
- out:
-	*success = 0;
-	return ctx;
+	pthread_mutex_lock(&ctx->lock);
 
- err:
-	if (ctx)
-		destroy_ctx(ctx);
+	if (created) {
+		cache_init(ctx);
 
-	*success = ret;
-	return NULL;
+		ctx->status = warm_up_cache(ctx);
+		pthread_cond_broadcast(&ctx->ready);
+	} else {
+		/* Another thread is warming up the song */
+		while (ctx->status > 0)
+			pthread_cond_wait(&ctx->ready, &ctx->lock);
+	}
+
+	ret = ctx->status;
+
+	pthread_mutex_unlock(&ctx->lock);
+
+	if (ret < 0) {
+		put_ctx(ctx);
+		*success = ret;
+		return NULL;
+	}
+
+	*success = 0;
+	return ctx;
 }
 
 static void load_content_db(void)
@@ -629,7 +1042,7 @@ static void load_content_db(void)
 	if (name[0]) {
 		if (stat(name, &st) == 0) {
 			if (mtime < st.st_mtime) {
-				ret = uade_read_content_db(name, &uadestate);
+				ret = uade_read_content_db(name, uadestate);
 				if (stat(name, &st) == 0)
 					mtime = st.st_mtime;
 				if (ret)
@@ -639,13 +1052,14 @@ static void load_content_db(void)
 			FILE *f = fopen(name, "w");
 			if (f)
 				fclose(f);
-			uade_read_content_db(name, &uadestate);
+			uade_read_content_db(name, uadestate);
 		}
 	}
 
-	snprintf(name, sizeof name, "%s/contentdb.conf", uadestate.config.basedir.name);
+	snprintf(name, sizeof name, "%s/contentdb",
+		 uade_get_const_effective_config(uadestate)->basedir.name);
 	if (stat(name, &st) == 0 && mtime < st.st_mtime) {
-		uade_read_content_db(name, &uadestate);
+		uade_read_content_db(name, uadestate);
 		if (stat(name, &st) == 0)
 			mtime = st.st_mtime;
 	}
@@ -657,21 +1071,28 @@ static void load_content_db(void)
  */
 static ssize_t get_file_size(const char *path)
 {
+	struct uade_file *module;
 	int64_t msecs;
 
-	if (!uade_is_our_file(path, 1, &uadestate))
+	pthread_mutex_lock(&uademutex);
+
+	if (!uade_is_our_file(path, uadestate)) {
+		pthread_mutex_unlock(&uademutex);
 		return 0;
+	}
 
-	/*
-	 * HACK HACK. Use playlength stored in the content database
-	 * or lie about the time.
-	 */
+	/* Use playlength stored in the content database or lie about the time */
 	load_content_db();
-	if (!uade_alloc_song(&uadestate, path))
+	module = uade_file_load(path);
+	if (module == NULL) {
+		pthread_mutex_unlock(&uademutex);
 		return -1;
+	}
+
+	msecs = uade_lookup_playtime(module, uadestate);
+	uade_file_free(module);
 
-	msecs = uadestate.song->playtime;
-	uade_unalloc_song(&uadestate);
+	pthread_mutex_unlock(&uademutex);
 
 	if (msecs > 3600000)
 		return -1;
@@ -753,7 +1174,7 @@ static void gen_uade_name(char *name, size_t maxname, mode_t mode,
 
 	snprintf(fullname, sizeof fullname, "%s/%s", dirname, filename);
 
-	if (!uade_is_our_file(fullname, 1, &uadestate))
+	if (!is_uade_file(fullname))
 		return;
 
 	snprintf(name, maxname, "%s.wav", filename);
@@ -1020,7 +1441,7 @@ static int uadefs_read(const char *fpath, char *buf, size_t size, off_t off,
 		return totalread;
 	}
 
-	pthread_mutex_lock(&readmutex);
+	pthread_mutex_lock(&ctx->lock);
 
 	while (size > 0) {
 		bsize = MIN(CACHE_BLOCK_SIZE - (off & CACHE_LSB_MASK), size);
@@ -1035,7 +1456,7 @@ static int uadefs_read(const char *fpath, char *buf, size_t size, off_t off,
 	}
 
 	DEBUG("read() returns %zd\n", totalread);
-	pthread_mutex_unlock(&readmutex);
+	pthread_mutex_unlock(&ctx->lock);
 
 	return totalread;
 }
@@ -1076,7 +1497,12 @@ static int uadefs_flush(const char *fpath, struct fuse_file_info *fi)
 
 static int uadefs_release(const char *fpath, struct fuse_file_info *fi)
 {
-	destroy_ctx(get_uadefs_file(fi));
+	struct sndctx *ctx = get_uadefs_file(fi);
+
+	if (ctx->normalfile)
+		destroy_ctx(ctx);
+	else
+		put_ctx(ctx);
 
 	DEBUG("release %s\n", fpath);
 
@@ -1156,6 +1582,47 @@ static int uadefs_removexattr(const char *fpath, const char *name)
 }
 #endif /* HAVE_SETXATTR */
 
+/*
+ * uade is initialized in the init() operation because fuse_main() forks
+ * to the background, and threads do not survive fork().
+ */
+static void *uadefs_init(struct fuse_conn_info *conn)
+{
+	(void) conn;
+
+	/* Config files and databases are loaded once for all states */
+	uadecontext = uade_new_context(NULL);
+	if (uadecontext == NULL)
+		DIE("Can not initialize uade\n");
+
+	uadestate = uade_new_state_from_context(uadecontext, NULL);
+	if (uadestate == NULL)
+		DIE("Can not initialize uade\n");
+
+	if (uade_context_set_pool_size(uadecontext, UADECORE_POOL_SIZE))
+		LOG("Can not start uadecore pool\n");
+
+	load_content_db();
+
+	return NULL;
+}
+
+static void uadefs_destroy(void *data)
+{
+	(void) data;
+
+	pthread_mutex_lock(&poolmutex);
+	while (npooled > 0)
+		uade_cleanup_state(statepool[--npooled]);
+	pthread_mutex_unlock(&poolmutex);
+
+	uade_cleanup_state(uadestate);
+	uadestate = NULL;
+
+	uade_free_context(uadecontext);
+	uadecontext = NULL;
+}
+
 static struct fuse_operations uadefs_oper = {
 	.getattr	= uadefs_getattr,
 	.access		= uadefs_access,
@@ -1179,6 +1646,8 @@ static struct fuse_operations uadefs_oper = {
 	.flush          = uadefs_flush,
 	.release	= uadefs_release,
 	.fsync		= uadefs_fsync,
+	.init		= uadefs_init,
+	.destroy	= uadefs_destroy,
 #ifdef HAVE_SETXATTR
 	.setxattr	= uadefs_setxattr,
 	.getxattr	= uadefs_getxattr,
@@ -1291,15 +1760,6 @@ static int uadefs_opt_proc(void *data, const char *arg, int key,
 	return 0;
 }
 
-static void init_uade(void)
-{
-    char uadeconfname[4096];
-
-    uade_load_initial_config(&uadestate, uadeconfname, sizeof uadeconfname, NULL);
-
-    load_content_db();
-}
-
 
 int main(int argc, char *argv[])
 {
@@ -1319,8 +1779,6 @@ int main(int argc, char *argv[])
 		debugfd = open(logfname, flags, fmode);
 	}
 
-	init_uade();
-
 	umask(0);
 	return uadefs_fuse_main(&args);
 }
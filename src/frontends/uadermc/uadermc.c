@@ -0,0 +1,931 @@
+/* uadermc - converts songs into RMC containers in parallel.
+
+   Copyright (C) 2026 UADE authors
+
+   This source code module is dual licensed under GPL and Public Domain.
+   Hence you may use _this_ module (not another code module) in any way you
+   want in your projects.
+
+   Each subsong is played on a separate uade_state to measure its length.
+   Worker threads take subsongs from a shared queue, so subsongs of a file
+   and many files are played concurrently. Files that the Amiga player
+   loads are recorded into the container. Results are printed and written
+   to the journal in the order of the input files.
+
+   With --checkpoints, existing RMC files are played instead, and emulator
+   snapshots are embedded into them at regular intervals. Seeking restores
+   the nearest snapshot instead of playing from the start of the subsong.
+*/
+
+#include <uade/uade.h>
+
+#include <bencodetools/bencode.h>
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct recorded_file {
+	struct recorded_file *next;
+	char *name;
+	void *data;
+	size_t size;
+};
+
+struct song {
+	char *path;
+	char *moduledir;  /* Directory prefix of path, including '/' */
+	int failed;
+	int done;         /* All subsongs have been played */
+	int probed;       /* Subsong range is known */
+	int min;
+	int max;
+	int pending;      /* Subsongs queued or being played */
+	long long *playtimes; /* Milliseconds, indexed by subsong - min */
+	size_t ncheckpoints;
+	struct recorded_file *files;
+};
+
+struct task {
+	struct task *next;
+	struct song *song;
+	int subsong;      /* -1 plays the default subsong and probes range */
+};
+
+/* Results of playing one subsong */
+struct task_result {
+	const char *moduledir;
+	int subsong;
+	int min;
+	int max;
+	long long playtime;
+	struct recorded_file *files;
+};
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static struct task *queuehead;
+static struct task *queuetail;
+static int running;
+
+static struct song *songs;
+static size_t nsongs;
+static size_t maxsongs;
+static size_t nextprint;
+static size_t nconverted;
+static size_t nfailed;
+
+/* Seconds between checkpoints, or 0 if RMC files are created */
+static int checkpointinterval;
+
+static FILE *journal;
+static char **journalpaths;
+static size_t njournalpaths;
+
+static struct uade_context *ctx;
+static struct uade_config *uc;
+
+static void *xmalloc(size_t size)
+{
+	void *p = malloc(size);
+	if (p == NULL) {
+		fprintf(stderr, "uadermc: Out of memory\n");
+		exit(1);
+	}
+	return p;
+}
+
+static char *xstrdup(const char *s)
+{
+	char *p = xmalloc(strlen(s) + 1);
+	strcpy(p, s);
+	return p;
+}
+
+static int cmp_strings(const void *a, const void *b)
+{
+	return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+static void read_journal(const char *fname)
+{
+	char line[PATH_MAX + 16];
+	size_t maxpaths = 0;
+	size_t len;
+	FILE *f = fopen(fname, "r");
+
+	if (f != NULL) {
+		while (fgets(line, sizeof line, f) != NULL) {
+			len = strlen(line);
+			/* A partial last line is ignored */
+			if (len < 4 || line[len - 1] != '\n')
+				continue;
+			line[len - 1] = 0;
+			if (strncmp(line, "ok ", 3) != 0 &&
+			    strncmp(line, "fail ", 5) != 0)
+				continue;
+			if (njournalpaths == maxpaths) {
+				maxpaths = maxpaths ? 2 * maxpaths : 256;
+				journalpaths = realloc(journalpaths, maxpaths * sizeof journalpaths[0]);
+				if (journalpaths == NULL) {
+					fprintf(stderr, "uadermc: Out of memory\n");
+					exit(1);
+				}
+			}
+			journalpaths[njournalpaths++] = xstrdup(strchr(line, ' ') + 1);
+		}
+		fclose(f);
+		qsort(journalpaths, njournalpaths, sizeof journalpaths[0],
+		      cmp_strings);
+	}
+
+	journal = fopen(fname, "a");
+	if (journal == NULL) {
+		fprintf(stderr, "uadermc: Can not open journal %s: %s\n",
+			fname, strerror(errno));
+		exit(1);
+	}
+}
+
+static int in_journal(const char *path)
+{
+	return njournalpaths > 0 &&
+		bsearch(&path, journalpaths, njournalpaths,
+			sizeof journalpaths[0], cmp_strings) != NULL;
+}
+
+static int is_rmc_name(const char *name)
+{
+	size_t len = strlen(name);
+	return len >= 4 && strcasecmp(name + len - 4, ".rmc") == 0;
+}
+
+static void add_song(const char *path)
+{
+	struct song *song;
+	const char *slash;
+
+	if (in_journal(path))
+		return;
+	if (checkpointinterval > 0) {
+		if (!uade_is_rmc_file(path))
+			return;
+	} else if (is_rmc_name(path) || uade_is_rmc_file(path)) {
+		return;
+	}
+
+	if (nsongs == maxsongs) {
+		maxsongs = maxsongs ? 2 * maxsongs : 256;
+		songs = realloc(songs, maxsongs * sizeof songs[0]);
+		if (songs == NULL) {
+			fprintf(stderr, "uadermc: Out of memory\n");
+			exit(1);
+		}
+	}
+	song = &songs[nsongs++];
+	memset(song, 0, sizeof *song);
+	song->path = xstrdup(path);
+	slash = strrchr(path, '/');
+	song->moduledir = xstrdup(path);
+	song->moduledir[slash != NULL ? (slash - path + 1) : 0] = 0;
+}
+
+static int skip_dot_entries(const struct dirent *d)
+{
+	return d->d_name[0] != '.';
+}
+
+static void add_path(const char *path, int recursive)
+{
+	struct stat st;
+	struct dirent **entries;
+	char child[PATH_MAX];
+	int n;
+	int i;
+
+	if (stat(path, &st)) {
+		fprintf(stderr, "uadermc: Can not stat %s: %s\n", path,
+			strerror(errno));
+		return;
+	}
+	if (S_ISREG(st.st_mode)) {
+		add_song(path);
+		return;
+	}
+	if (!S_ISDIR(st.st_mode))
+		return;
+	if (!recursive) {
+		fprintf(stderr, "uadermc: Skipping directory %s (use -r)\n",
+			path);
+		return;
+	}
+
+	/* Sorted order makes the output deterministic */
+	n = scandir(path, &entries, skip_dot_entries, alphasort);
+	if (n < 0) {
+		fprintf(stderr, "uadermc: Can not read directory %s\n", path);
+		return;
+	}
+	for (i = 0; i < n; i++) {
+		if (snprintf(child, sizeof child, "%s/%s", path,
+			     entries[i]->d_name) < (int) sizeof child)
+			add_path(child, recursive);
+		free(entries[i]);
+	}
+	free(entries);
+}
+
+/* Called with mutex locked */
+static void push_task(struct song *song, int subsong, int front)
+{
+	struct task *t = xmalloc(sizeof *t);
+	t->song = song;
+	t->subsong = subsong;
+	t->next = NULL;
+	song->pending++;
+	if (queuehead == NULL) {
+		queuehead = queuetail = t;
+	} else if (front) {
+		t->next = queuehead;
+		queuehead = t;
+	} else {
+		queuetail->next = t;
+		queuetail = t;
+	}
+	pthread_cond_signal(&cond);
+}
+
+static void free_files(struct recorded_file *f)
+{
+	struct recorded_file *next;
+	for (; f != NULL; f = next) {
+		next = f->next;
+		free(f->name);
+		free(f->data);
+		free(f);
+	}
+}
+
+static int has_file(const struct recorded_file *list, const char *name)
+{
+	for (; list != NULL; list = list->next) {
+		if (strcmp(list->name, name) == 0)
+			return 1;
+	}
+	return 0;
+}
+
+static struct uade_file *record_loader(const char *name, const char *playerdir,
+				       void *context, struct uade_state *state)
+{
+	struct task_result *result = context;
+	struct uade_file *f = uade_load_amiga_file(name, playerdir, state);
+	struct recorded_file *r;
+	size_t dirlen = strlen(result->moduledir);
+	const char *rmcname = name;
+
+	/* Player support files such as ENV:EaglePlayer/ are not recorded */
+	if (f == NULL || f->data == NULL || strchr(name, ':') != NULL)
+		return f;
+
+	/* Names are stored relative to the module */
+	if (dirlen > 0 && strncmp(name, result->moduledir, dirlen) == 0)
+		rmcname = name + dirlen;
+	if (rmcname[0] == 0 || rmcname[0] == '/' || rmcname[0] == '.' ||
+	    strstr(rmcname, "/.") != NULL) {
+		fprintf(stderr, "uadermc: Can not record %s\n", name);
+		return f;
+	}
+	if (has_file(result->files, rmcname))
+		return f;
+
+	r = xmalloc(sizeof *r);
+	r->name = xstrdup(rmcname);
+	r->data = xmalloc(f->size > 0 ? f->size : 1);
+	memcpy(r->data, f->data, f->size);
+	r->size = f->size;
+	r->next = result->files;
+	result->files = r;
+	return f;
+}
+
+/*
+ * Plays one subsong to the end and measures its length. Returns 0 on
+ * success, 1 if the song can not be played, and -1 if the state must be
+ * created again.
+ */
+static int play_subsong(struct task_result *result, const struct song *song,
+			int subsong, struct uade_state *state)
+{
+	char buf[65536];
+	const struct uade_song_info *info;
+	ssize_t nbytes;
+	int ret;
+	int64_t bytespersecond = UADE_BYTES_PER_FRAME *
+		(int64_t) uade_get_sampling_rate(state);
+
+	uade_set_amiga_loader(record_loader, result, state);
+
+	ret = uade_play(song->path, subsong, state);
+	if (ret <= 0)
+		return ret < 0 ? -1 : 1;
+
+	info = uade_get_song_info(state);
+	result->subsong = info->subsongs.cur;
+	result->min = info->subsongs.min;
+	result->max = info->subsongs.max;
+
+	while ((nbytes = uade_read(buf, sizeof buf, state)) > 0)
+		;
+
+	result->playtime = (info->subsongbytes * 1000) / bytespersecond;
+
+	if (uade_stop(state))
+		return -1;
+
+	return nbytes < 0 ? 1 : 0;
+}
+
+/* Replaces fname atomically, so that a crash does not leave a broken file */
+static int write_file(const char *fname, const void *data, size_t size)
+{
+	char tmpname[PATH_MAX];
+	FILE *out;
+
+	snprintf(tmpname, sizeof tmpname, "%s.tmp", fname);
+	out = fopen(tmpname, "wb");
+	if (out == NULL) {
+		fprintf(stderr, "uadermc: Can not create %s: %s\n", tmpname,
+			strerror(errno));
+		return -1;
+	}
+	if (fwrite(data, size, 1, out) != 1 || fclose(out)) {
+		fprintf(stderr, "uadermc: Can not write %s\n", tmpname);
+		unlink(tmpname);
+		return -1;
+	}
+	if (rename(tmpname, fname)) {
+		fprintf(stderr, "uadermc: Can not rename %s: %s\n", tmpname,
+			strerror(errno));
+		unlink(tmpname);
+		return -1;
+	}
+	return 0;
+}
+
+static int write_rmc(struct song *song)
+{
+	char fname[PATH_MAX];
+	const char *modulename = song->path + strlen(song->moduledir);
+	struct bencode *rmc = ben_list();
+	struct bencode *meta = ben_dict();
+	struct bencode *files = ben_dict();
+	struct bencode *subsongs = ben_dict();
+	struct recorded_file *f;
+	void *data = NULL;
+	size_t size;
+	int i;
+	int ret = -1;
+
+	if (rmc == NULL || meta == NULL || files == NULL || subsongs == NULL ||
+	    ben_list_append(rmc, ben_blob(RMC_MAGIC, RMC_MAGIC_LEN)) ||
+	    ben_list_append(rmc, meta) || ben_list_append(rmc, files)) {
+		fprintf(stderr, "uadermc: No memory for rmc\n");
+		exit(1);
+	}
+
+	for (i = song->min; i <= song->max; i++) {
+		if (song->playtimes[i - song->min] <= 0)
+			continue;
+		if (ben_dict_set(subsongs, ben_int(i),
+				 ben_int(song->playtimes[i - song->min]))) {
+			fprintf(stderr, "uadermc: No memory for subsongs\n");
+			exit(1);
+		}
+	}
+	if (ben_dict_len(subsongs) == 0) {
+		fprintf(stderr, "uadermc: No playable subsongs: %s\n",
+			song->path);
+		ben_free(subsongs);
+		goto out;
+	}
+	if (ben_dict_set_by_str(meta, "platform", ben_str("amiga")) ||
+	    ben_dict_set_by_str(meta, "song", ben_str(modulename)) ||
+	    ben_dict_set_by_str(meta, "subsongs", subsongs)) {
+		fprintf(stderr, "uadermc: No memory for meta\n");
+		exit(1);
+	}
+
+	data = uade_read_file(&size, song->path);
+	if (data == NULL) {
+		fprintf(stderr, "uadermc: Can not read %s\n", song->path);
+		goto out;
+	}
+	if (uade_rmc_record_file(rmc, modulename, data, size))
+		goto out;
+	free(data);
+	data = NULL;
+
+	for (f = song->files; f != NULL; f = f->next) {
+		/* The module itself may have been loaded by the player */
+		if (strcmp(f->name, modulename) == 0)
+			continue;
+		if (uade_rmc_record_file(rmc, f->name, f->data, f->size))
+			goto out;
+	}
+
+	data = ben_encode(&size, rmc);
+	if (data == NULL) {
+		fprintf(stderr, "uadermc: Can not encode rmc: %s\n",
+			song->path);
+		goto out;
+	}
+
+	snprintf(fname, sizeof fname, "%s.rmc", song->path);
+	ret = write_file(fname, data, size);
+
+out:
+	free(data);
+	ben_free(rmc);
+	return ret;
+}
+
+/*
+ * Plays a subsong of an RMC file and returns a list of checkpoints, or NULL
+ * on error. *ret is set like play_subsong() return value. *isdefault is set
+ * if the subsong is the default subsong.
+ */
+static struct bencode *record_checkpoints(int *ret, int *isdefault,
+					  const char *path, int subsong,
+					  struct uade_state *state)
+{
+	char buf[65536];
+	const struct uade_song_info *info;
+	struct bencode *list;
+	struct bencode *checkpoint;
+	void *snapshot;
+	size_t size;
+	int64_t snapshotbytes;
+	int64_t interval = UADE_BYTES_PER_FRAME * checkpointinterval *
+		(int64_t) uade_get_sampling_rate(state);
+	int64_t next = interval;
+	int requested = 0;
+	ssize_t nbytes;
+
+	/*
+	 * A restored checkpoint continues exactly like the playback that
+	 * recorded it. The score runs different code for a subsong that is
+	 * set than for the default subsong, so the default subsong is
+	 * recorded by playing the song without a subsong number.
+	 */
+	*ret = uade_play(path, -1, state);
+	if (*ret > 0) {
+		*isdefault = (uade_get_song_info(state)->subsongs.cur == subsong);
+		if (!*isdefault) {
+			if (uade_stop(state)) {
+				*ret = -1;
+				return NULL;
+			}
+			*ret = uade_play(path, subsong, state);
+		}
+	}
+	if (*ret <= 0) {
+		*ret = *ret < 0 ? -1 : 1;
+		return NULL;
+	}
+
+	list = ben_list();
+	if (list == NULL) {
+		fprintf(stderr, "uadermc: No memory for checkpoints\n");
+		exit(1);
+	}
+
+	info = uade_get_song_info(state);
+	while ((nbytes = uade_read(buf, sizeof buf, state)) > 0) {
+		snapshot = uade_get_snapshot(&size, &snapshotbytes, state);
+		if (snapshot != NULL) {
+			requested = 0;
+			checkpoint = ben_list();
+			if (checkpoint == NULL ||
+			    ben_list_append(checkpoint, ben_int(snapshotbytes / UADE_BYTES_PER_FRAME)) ||
+			    ben_list_append(checkpoint, ben_blob(snapshot, size)) ||
+			    ben_list_append(list, checkpoint)) {
+				fprintf(stderr, "uadermc: No memory for checkpoints\n");
+				exit(1);
+			}
+			free(snapshot);
+		}
+		if (!requested && info->subsongbytes >= next) {
+			if (uade_request_snapshot(state))
+				break;
+			requested = 1;
+			next += interval;
+		}
+	}
+
+	*ret = uade_stop(state) ? -1 : (nbytes < 0 ? 1 : 0);
+	if (*ret) {
+		ben_free(list);
+		return NULL;
+	}
+	return list;
+}
+
+/* Returns 0 on success, 1 if the song fails, -1 if state must be renewed */
+static int add_checkpoints(struct song *song, struct uade_state *state)
+{
+	struct bencode *rmc = uade_rmc_decode_file(song->path);
+	struct bencode *meta;
+	const struct bencode *subsongs;
+	struct bencode *cpsubsongs;
+	struct bencode *checkpoints;
+	struct bencode *list;
+	struct bencode *key;
+	struct bencode *value;
+	void *data;
+	size_t size;
+	size_t pos;
+	int isdefault;
+	int ret = 1;
+
+	if (rmc == NULL)
+		return 1;
+	meta = uade_rmc_get_meta(rmc);
+	subsongs = uade_rmc_get_subsongs(rmc);
+	checkpoints = ben_dict();
+	cpsubsongs = ben_dict();
+	if (checkpoints == NULL || cpsubsongs == NULL ||
+	    ben_dict_set_by_str(checkpoints, "frequency",
+				ben_int(uade_get_sampling_rate(state))) ||
+	    ben_dict_set_by_str(checkpoints, "subsongs", cpsubsongs)) {
+		fprintf(stderr, "uadermc: No memory for checkpoints\n");
+		exit(1);
+	}
+	if (meta == NULL || subsongs == NULL) {
+		fprintf(stderr, "uadermc: No subsongs in %s\n", song->path);
+		goto out;
+	}
+
+	ben_dict_for_each(key, value, pos, subsongs) {
+		(void) value;
+		if (!ben_is_int(key))
+			goto out;
+		list = record_checkpoints(&ret, &isdefault, song->path,
+					  ben_int_val(key), state);
+		if (list == NULL)
+			goto out;
+		song->ncheckpoints += ben_list_len(list);
+		if (ben_dict_set(cpsubsongs, ben_int(ben_int_val(key)), list) ||
+		    (isdefault &&
+		     ben_dict_set_by_str(checkpoints, "default",
+					 ben_int(ben_int_val(key))))) {
+			fprintf(stderr, "uadermc: No memory for checkpoints\n");
+			exit(1);
+		}
+	}
+
+	/* Replaces old checkpoints */
+	if (ben_dict_set_by_str(meta, "checkpoints", checkpoints)) {
+		fprintf(stderr, "uadermc: No memory for checkpoints\n");
+		exit(1);
+	}
+	checkpoints = NULL;
+
+	ret = 1;
+	data = ben_encode(&size, rmc);
+	if (data == NULL) {
+		fprintf(stderr, "uadermc: Can not encode rmc: %s\n",
+			song->path);
+		goto out;
+	}
+	if (write_file(song->path, data, size) == 0)
+		ret = 0;
+	free(data);
+out:
+	ben_free(checkpoints);
+	ben_free(rmc);
+	return ret;
+}
+
+static void print_song(const struct song *song)
+{
+	int i;
+
+	if (song->failed) {
+		nfailed++;
+	} else if (checkpointinterval > 0) {
+		nconverted++;
+		printf("checkpoints %s %zu\n", song->path, song->ncheckpoints);
+		fflush(stdout);
+	} else {
+		nconverted++;
+		printf("meta %s subsongs", song->path);
+		for (i = song->min; i <= song->max; i++) {
+			if (song->playtimes[i - song->min] > 0)
+				printf(" %d:%lld", i,
+				       song->playtimes[i - song->min]);
+		}
+		printf("\n");
+		fflush(stdout);
+	}
+
+	if (journal != NULL) {
+		fprintf(journal, "%s %s\n", song->failed ? "fail" : "ok",
+			song->path);
+		fflush(journal);
+		fsync(fileno(journal));
+	}
+}
+
+/* Called with mutex locked. Merges the result of a task into the song. */
+static void merge_result(struct song *song, int subsong,
+			 struct task_result *result, int ret)
+{
+	struct recorded_file *f;
+	struct recorded_file *next;
+	int i;
+
+	if (ret != 0) {
+		song->failed = 1;
+		free_files(result->files);
+		return;
+	}
+
+	if (!song->probed) {
+		song->probed = 1;
+		song->min = result->min;
+		song->max = result->max;
+		if (song->min < 0 || song->max < song->min ||
+		    song->max - song->min > 255) {
+			song->failed = 1;
+			free_files(result->files);
+			return;
+		}
+		song->playtimes = calloc(song->max - song->min + 1,
+					 sizeof song->playtimes[0]);
+		if (song->playtimes == NULL) {
+			fprintf(stderr, "uadermc: Out of memory\n");
+			exit(1);
+		}
+		/* Queue other subsongs first so that songs finish in order */
+		for (i = song->max; i >= song->min; i--) {
+			if (i != result->subsong)
+				push_task(song, i, 1);
+		}
+	}
+
+	if (subsong < 0)
+		subsong = result->subsong;
+	if (subsong >= song->min && subsong <= song->max)
+		song->playtimes[subsong - song->min] = result->playtime;
+
+	for (f = result->files; f != NULL; f = next) {
+		next = f->next;
+		if (has_file(song->files, f->name)) {
+			f->next = NULL;
+			free_files(f);
+			continue;
+		}
+		f->next = song->files;
+		song->files = f;
+	}
+}
+
+/* Called with mutex locked */
+static void print_finished_songs(void)
+{
+	struct song *song;
+	while (nextprint < nsongs && songs[nextprint].done) {
+		song = &songs[nextprint++];
+		print_song(song);
+		free(song->playtimes);
+		song->playtimes = NULL;
+	}
+}
+
+static void *worker(void *arg)
+{
+	struct uade_state *state = NULL;
+	struct task_result result;
+	struct task *task;
+	struct song *song;
+	int failed;
+	int ret;
+
+	(void) arg;
+
+	pthread_mutex_lock(&mutex);
+	while (1) {
+		while (queuehead == NULL && running > 0)
+			pthread_cond_wait(&cond, &mutex);
+		if (queuehead == NULL)
+			break;
+
+		task = queuehead;
+		queuehead = task->next;
+		if (queuehead == NULL)
+			queuetail = NULL;
+		running++;
+		song = task->song;
+		/* Other workers may set failed while this one plays */
+		failed = song->failed;
+		pthread_mutex_unlock(&mutex);
+
+		memset(&result, 0, sizeof result);
+		result.moduledir = song->moduledir;
+		ret = 1;
+		if (!failed) {
+			if (state == NULL)
+				state = uade_new_state_from_context(ctx, uc);
+			if (state == NULL) {
+				fprintf(stderr, "uadermc: Can not create state\n");
+				exit(1);
+			}
+			if (checkpointinterval > 0)
+				ret = add_checkpoints(song, state);
+			else
+				ret = play_subsong(&result, song,
+						   task->subsong, state);
+			if (ret < 0) {
+				uade_cleanup_state(state);
+				state = NULL;
+			}
+		}
+
+		pthread_mutex_lock(&mutex);
+		if (checkpointinterval > 0)
+			song->failed |= (ret != 0);
+		else
+			merge_result(song, task->subsong, &result, ret);
+		free(task);
+		song->pending--;
+		if (song->pending == 0) {
+			pthread_mutex_unlock(&mutex);
+			/* No other thread touches the song now */
+			if (!song->failed && checkpointinterval == 0 &&
+			    write_rmc(song))
+				song->failed = 1;
+			free_files(song->files);
+			song->files = NULL;
+			pthread_mutex_lock(&mutex);
+			song->done = 1;
+			print_finished_songs();
+		}
+		running--;
+		if (queuehead == NULL && running == 0)
+			pthread_cond_broadcast(&cond);
+	}
+	pthread_mutex_unlock(&mutex);
+
+	if (state != NULL)
+		uade_cleanup_state(state);
+	return NULL;
+}
+
+static void usage(const char *name)
+{
+	printf("Usage: %s [-j threads] [-m] [-r] [--checkpoints[=s]] [--journal=file] [--basedir=dir] [-P player] [-S score] [-u uadecore] file/dir ...\n"
+	       "\n"
+	       "Converts songs into RMC containers. song.foo becomes song.foo.rmc.\n"
+	       " --checkpoints[=s]  Add seek checkpoints every s seconds (default 30) to\n"
+	       "                 existing RMC files instead of converting songs.\n"
+	       " -j n            Use n worker threads. The default is the number of CPUs.\n"
+	       " -m, --machines  Play songs on machine threads of one uadecore process\n"
+	       "                 instead of one uadecore process per song.\n"
+	       " -r              Recurse into directories.\n"
+	       " --journal=file  Record finished songs into file, and skip songs that are\n"
+	       "                 already recorded in it. This makes the conversion resumable.\n"
+	       " -P player       Play songs with the given eagleplayer.\n"
+	       " -S score        Use the given score file.\n"
+	       " -u uadecore     Use the given uadecore executable.\n",
+	       name);
+}
+
+int main(int argc, char *argv[])
+{
+	long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	int recursive = 0;
+	int machines = 0;
+	pthread_t *threads;
+	size_t i;
+	int ret;
+	const struct option long_options[] = {
+		{"basedir", 1, NULL, 'b'},
+		{"checkpoints", 2, NULL, 'c'},
+		{"help", 0, NULL, 'h'},
+		{"journal", 1, NULL, 'J'},
+		{"machines", 0, NULL, 'm'},
+		{NULL, 0, NULL, 0}
+	};
+
+	uc = uade_new_config();
+	if (uc == NULL)
+		return 1;
+
+	while ((ret = getopt_long(argc, argv, "hj:mP:rS:u:", long_options, 0)) != -1) {
+		switch (ret) {
+		case 'b':
+			uade_config_set_option(uc, UC_BASE_DIR, optarg);
+			break;
+		case 'c':
+			checkpointinterval = optarg ? atoi(optarg) : 30;
+			if (checkpointinterval <= 0) {
+				fprintf(stderr, "Invalid checkpoint interval: %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		case 'j':
+			nthreads = atol(optarg);
+			if (nthreads <= 0) {
+				fprintf(stderr, "Invalid number of threads: %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'J':
+			read_journal(optarg);
+			break;
+		case 'm':
+			machines = 1;
+			break;
+		case 'P':
+			uade_config_set_option(uc, UC_PLAYER_FILE, optarg);
+			break;
+		case 'r':
+			recursive = 1;
+			break;
+		case 'S':
+			uade_config_set_option(uc, UC_SCORE_FILE, optarg);
+			break;
+		case 'u':
+			uade_config_set_option(uc, UC_UADECORE_FILE, optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (optind == argc) {
+		usage(argv[0]);
+		return 1;
+	}
+	if (nthreads <= 0)
+		nthreads = 1;
+
+	/* Play one subsong at a time as fast as possible */
+	uade_config_set_option(uc, UC_ONE_SUBSONG, NULL);
+	uade_config_set_option(uc, UC_NO_POSTPROCESSING, NULL);
+	/* Snapshots are taken with the resampler that plays them */
+	if (checkpointinterval == 0)
+		uade_config_set_option(uc, UC_RESAMPLER, "none");
+
+	ctx = uade_new_context(uc);
+	if (ctx == NULL) {
+		fprintf(stderr, "uadermc: Can not initialize uade\n");
+		return 1;
+	}
+	if (machines) {
+		if (uade_context_start_machine_host(ctx)) {
+			fprintf(stderr, "uadermc: Can not start a machine host\n");
+			return 1;
+		}
+	} else {
+		uade_context_set_pool_size(ctx, nthreads);
+	}
+
+	for (ret = optind; ret < argc; ret++)
+		add_path(argv[ret], recursive);
+
+	for (i = 0; i < nsongs; i++)
+		push_task(&songs[i], -1, 0);
+
+	threads = xmalloc(nthreads * sizeof threads[0]);
+	for (i = 0; i < (size_t) nthreads; i++) {
+		if (pthread_create(&threads[i], NULL, worker, NULL)) {
+			fprintf(stderr, "uadermc: Can not create thread\n");
+			return 1;
+		}
+	}
+	for (i = 0; i < (size_t) nthreads; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+
+	assert(nextprint == nsongs);
+	fprintf(stderr, "uadermc: %zu songs %s, %zu failed\n", nconverted,
+		checkpointinterval > 0 ? "checkpointed" : "converted", nfailed);
+
+	if (journal != NULL)
+		fclose(journal);
+	uade_free_context(ctx);
+	free(uc);
+	return nfailed > 0;
+}
@@ -0,0 +1,830 @@
+/* uade-scope - renders oscilloscope view frames from write-audio traces.
+
+   Copyright (C) 2026 UADE authors
+
+   This source code module is dual licensed under GPL and Public Domain.
+   Hence you may use _this_ module (not another code module) in any way you
+   want in your projects.
+
+   Reads a trace written by uade123 --write-audio and writes raw RGB24
+   frames to stdout. Use with ffmpeg, e.g.
+
+   uade-scope --wave song.wav song.reg | \
+       ffmpeg -f rawvideo -pix_fmt rgb24 -s 1280x720 -framerate 60 -i - \
+       -i song.wav -pix_fmt yuv420p song.mp4
+
+   Images are the same as python/uade/write_audio.py produces.
+*/
+
+#include "write_audio.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#define NUM_CHANNELS 4
+
+#define SOUNDTICKS_PAL 3546895
+#define AMIGA_FRAME_TICKS (SOUNDTICKS_PAL / 50)
+
+#define SAMPLES_PER_FRAME 640
+#define PIXELS_PER_SAMPLE 2
+#define AMIGA_PIXEL_TICKS (AMIGA_FRAME_TICKS / SAMPLES_PER_FRAME)
+
+/* Each frame integrates two Amiga frames of Paula output */
+#define WINDOW_TICKS (2 * AMIGA_FRAME_TICKS)
+#define WINDOW_SPANS ((WINDOW_TICKS + AMIGA_PIXEL_TICKS - 1) / AMIGA_PIXEL_TICKS)
+
+#define WIDTH (SAMPLES_PER_FRAME * PIXELS_PER_SAMPLE)
+#define HEIGHT 720
+#define MARGIN 8
+#define VERTICAL_DIM (HEIGHT / NUM_CHANNELS - MARGIN)
+#define FRAME_BYTES (WIDTH * HEIGHT * 3)
+
+#define V1_FRAME_SIZE 12
+
+/* Output of a channel changes to values[i] at times[i] */
+struct channel_trace {
+	int64_t *times;
+	int16_t *values;
+	size_t n;
+	size_t allocated;
+};
+
+struct trace {
+	struct channel_trace channels[NUM_CHANNELS];
+	int64_t time;
+	int16_t *samples;  /* Interleaved left and right output samples */
+	size_t nsamples;
+	size_t allocatedsamples;
+	int left;
+};
+
+struct frame {
+	double signals[NUM_CHANNELS][SAMPLES_PER_FRAME];
+	double absmax;
+	double normaliser;
+	uint8_t *image;
+};
+
+struct job {
+	pthread_t thread;
+	const struct trace *trace;
+	struct frame *frames;
+	int64_t firstframe;
+	int nframes;
+	int draw;
+};
+
+static int64_t video_frame_ticks;
+
+static void *xrealloc(void *ptr, size_t size)
+{
+	void *p = realloc(ptr, size);
+	if (p == NULL) {
+		fprintf(stderr, "uade-scope: Out of memory\n");
+		exit(1);
+	}
+	return p;
+}
+
+static void add_output(struct trace *trace, int ch, int16_t value)
+{
+	struct channel_trace *ct = &trace->channels[ch];
+	if (ct->n > 0 && ct->values[ct->n - 1] == value)
+		return;
+	if (ct->n > 0 && ct->times[ct->n - 1] == trace->time) {
+		ct->values[ct->n - 1] = value;
+		return;
+	}
+	if (ct->n == ct->allocated) {
+		ct->allocated = 2 * ct->allocated + 4096;
+		ct->times = xrealloc(ct->times,
+				     ct->allocated * sizeof(ct->times[0]));
+		ct->values = xrealloc(ct->values,
+				      ct->allocated * sizeof(ct->values[0]));
+	}
+	ct->times[ct->n] = trace->time;
+	ct->values[ct->n] = value;
+	ct->n++;
+}
+
+static void add_event(struct trace *trace, int ch, int type, uint16_t value)
+{
+	if (type != PET_OUTPUT)
+		return;
+	if (ch == 0) {
+		trace->left = value;
+		return;
+	}
+	if (trace->nsamples + 2 > trace->allocatedsamples) {
+		trace->allocatedsamples = 2 * trace->allocatedsamples + 65536;
+		trace->samples = xrealloc(
+			trace->samples,
+			trace->allocatedsamples * sizeof(trace->samples[0]));
+	}
+	trace->samples[trace->nsamples++] = trace->left;
+	trace->samples[trace->nsamples++] = value;
+}
+
+static void init_trace(struct trace *trace)
+{
+	int ch;
+	memset(trace, 0, sizeof(*trace));
+	/* All channels output zero in the beginning */
+	for (ch = 0; ch < NUM_CHANNELS; ch++)
+		add_output(trace, ch, 0);
+}
+
+static int decode_v1(struct trace *trace, const uint8_t *data, size_t size)
+{
+	size_t pos;
+	int ch;
+
+	for (pos = 0; pos + V1_FRAME_SIZE <= size; pos += V1_FRAME_SIZE) {
+		const uint8_t *frame = data + pos;
+		trace->time += (frame[1] << 16) | (frame[2] << 8) | frame[3];
+		if (frame[0] == 0) {
+			for (ch = 0; ch < NUM_CHANNELS; ch++) {
+				add_output(trace, ch, (int16_t) (
+						   (frame[4 + 2 * ch] << 8) |
+						   frame[5 + 2 * ch]));
+			}
+		} else if (frame[0] == 0x80) {
+			if (frame[4] >= NUM_CHANNELS)
+				return -1;
+			add_event(trace, frame[4], frame[5],
+				  (frame[6] << 8) | frame[7]);
+		} else {
+			fprintf(stderr, "uade-scope: Unsupported control "
+				"byte: %d\n", frame[0]);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int get_varint(uint64_t *x, const uint8_t *data, size_t size,
+		      size_t *pos)
+{
+	int shift = 0;
+	*x = 0;
+	while (*pos < size && shift < 64) {
+		uint8_t b = data[(*pos)++];
+		*x |= ((uint64_t) (b & 0x7f)) << shift;
+		if (b < 0x80)
+			return 0;
+		shift += 7;
+	}
+	return -1;
+}
+
+static int get_svarint(int32_t *x, const uint8_t *data, size_t size,
+		       size_t *pos)
+{
+	uint64_t u;
+	if (get_varint(&u, data, size, pos))
+		return -1;
+	*x = (int32_t) ((u >> 1) ^ -(u & 1));
+	return 0;
+}
+
+static int decode_v2_records(struct trace *trace, int32_t outputs[4],
+			     const uint8_t *data, size_t size)
+{
+	size_t pos = 0;
+	uint64_t tdelta;
+	uint64_t value;
+	int32_t diff;
+	int32_t left, right;
+	int ch;
+	int mask;
+
+	while (pos < size) {
+		switch (data[pos++]) {
+		case UADE_WRITE_AUDIO_RECORD_OUTPUT:
+			if (get_varint(&tdelta, data, size, &pos) ||
+			    pos >= size)
+				return -1;
+			trace->time += tdelta;
+			mask = data[pos++];
+			for (ch = 0; ch < NUM_CHANNELS; ch++) {
+				if ((mask & (1 << ch)) == 0)
+					continue;
+				if (get_svarint(&diff, data, size, &pos))
+					return -1;
+				outputs[ch] += diff;
+				add_output(trace, ch, outputs[ch]);
+			}
+			break;
+		case UADE_WRITE_AUDIO_RECORD_PAULA_EVENT:
+			if (get_varint(&tdelta, data, size, &pos) ||
+			    pos >= size)
+				return -1;
+			trace->time += tdelta;
+			ch = data[pos] >> 4;
+			mask = data[pos] & 0xf;
+			pos++;
+			if (get_varint(&value, data, size, &pos) ||
+			    ch >= NUM_CHANNELS)
+				return -1;
+			add_event(trace, ch, mask, value);
+			break;
+		case UADE_WRITE_AUDIO_RECORD_LEFT_RIGHT:
+			if (get_varint(&tdelta, data, size, &pos) ||
+			    get_svarint(&left, data, size, &pos) ||
+			    get_svarint(&right, data, size, &pos))
+				return -1;
+			trace->time += tdelta;
+			add_event(trace, 0, PET_OUTPUT, left);
+			add_event(trace, 1, PET_OUTPUT, right);
+			break;
+		default:
+			fprintf(stderr, "uade-scope: Unsupported record type: "
+				"%d\n", data[pos - 1]);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static uint32_t get_be_u32(const uint8_t *p)
+{
+	return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static int decode_v2(struct trace *trace, const uint8_t *data, size_t size)
+{
+	int32_t outputs[4] = {0, 0, 0, 0};
+	uint8_t *records = NULL;
+	size_t pos = 0;
+	int ret = -1;
+
+	while (pos < size) {
+		const uint8_t *header = data + pos;
+		uint32_t recordsize;
+		uint32_t datasize;
+
+		if (size - pos < UADE_WRITE_AUDIO_BLOCK_HEADER_SIZE) {
+			fprintf(stderr, "uade-scope: Truncated block header\n");
+			goto out;
+		}
+		recordsize = get_be_u32(header + 1);
+		datasize = get_be_u32(header + 5);
+		pos += UADE_WRITE_AUDIO_BLOCK_HEADER_SIZE;
+		if (size - pos < datasize) {
+			fprintf(stderr, "uade-scope: Truncated block\n");
+			goto out;
+		}
+
+		if (header[0] == UADE_WRITE_AUDIO_BLOCK_RAW) {
+			if (datasize != recordsize)
+				goto out;
+			if (decode_v2_records(trace, outputs, data + pos,
+					      datasize))
+				goto out;
+		} else if (header[0] == UADE_WRITE_AUDIO_BLOCK_ZLIB) {
+#ifdef HAVE_ZLIB
+			uLongf rsize = recordsize;
+			records = xrealloc(records, recordsize);
+			if (uncompress(records, &rsize, data + pos,
+				       datasize) != Z_OK ||
+			    rsize != recordsize) {
+				fprintf(stderr, "uade-scope: Corrupted block\n");
+				goto out;
+			}
+			if (decode_v2_records(trace, outputs, records, rsize))
+				goto out;
+#else
+			fprintf(stderr, "uade-scope: Compressed traces need "
+				"zlib\n");
+			goto out;
+#endif
+		} else {
+			fprintf(stderr, "uade-scope: Unsupported block type: "
+				"%d\n", header[0]);
+			goto out;
+		}
+		pos += datasize;
+	}
+	ret = 0;
+out:
+	free(records);
+	return ret;
+}
+
+static int decode_trace(struct trace *trace, const uint8_t *data,
+			size_t size)
+{
+	const size_t hsize = sizeof(struct uade_write_audio_header);
+
+	init_trace(trace);
+
+	if (size >= hsize &&
+	    memcmp(data, UADE_WRITE_AUDIO_MAGIC, hsize) == 0)
+		return decode_v2(trace, data + hsize, size - hsize);
+	if (size >= hsize &&
+	    memcmp(data, UADE_WRITE_AUDIO_MAGIC_V1, hsize) == 0)
+		return decode_v1(trace, data + hsize, size - hsize);
+
+	fprintf(stderr, "uade-scope: Unknown write-audio file header\n");
+	return -1;
+}
+
+/* Returns the index of the last output change at or before time t */
+static size_t find_change(const struct channel_trace *ct, int64_t t)
+{
+	size_t lo = 0;
+	size_t hi = ct->n;
+	while (hi - lo > 1) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (ct->times[mid] <= t)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* Computes the mean output of each pixel span with a box filter */
+static void integrate(double signal[WINDOW_SPANS],
+		      const struct channel_trace *ct, int64_t start)
+{
+	size_t i = find_change(ct, start);
+	int64_t t = start;
+	int span;
+
+	for (span = 0; span < WINDOW_SPANS; span++) {
+		int64_t spanstart = t;
+		int64_t end = start + (int64_t) (span + 1) * AMIGA_PIXEL_TICKS;
+		int64_t sum = 0;
+		if (end > start + WINDOW_TICKS)
+			end = start + WINDOW_TICKS;
+		while (t < end) {
+			int64_t next = (i + 1) < ct->n ?
+				ct->times[i + 1] : INT64_MAX;
+			int64_t segend = next < end ? next : end;
+			sum += ct->values[i] * (segend - t);
+			t = segend;
+			if (t == next)
+				i++;
+		}
+		signal[span] = ((double) sum) / (end - spanstart) / (64 * 128);
+	}
+}
+
+/* Finds a rising zero crossing and cuts a frame around it */
+static void trigger(double out[SAMPLES_PER_FRAME],
+		    const double signal[WINDOW_SPANS])
+{
+	const int centering = SAMPLES_PER_FRAME / 2;
+	int cutpoint = 0;
+	int negative = 0;
+	int i;
+
+	for (i = centering; i < WINDOW_SPANS - SAMPLES_PER_FRAME; i++) {
+		if (!negative) {
+			if (signal[i] < 0)
+				negative = 1;
+		} else if (signal[i] >= 0) {
+			cutpoint = i - centering;
+			break;
+		}
+	}
+	memcpy(out, signal + cutpoint, SAMPLES_PER_FRAME * sizeof(out[0]));
+}
+
+static void compute_signals(struct frame *frame, const struct trace *trace,
+			    int64_t framenr)
+{
+	double signal[WINDOW_SPANS];
+	int64_t start = framenr * video_frame_ticks;
+	int ch;
+	int i;
+
+	frame->absmax = 1e-10;
+	for (ch = 0; ch < NUM_CHANNELS; ch++) {
+		integrate(signal, &trace->channels[ch], start);
+		trigger(frame->signals[ch], signal);
+		for (i = 0; i < SAMPLES_PER_FRAME; i++) {
+			double x = frame->signals[ch][i];
+			if (x < 0)
+				x = -x;
+			if (x > frame->absmax)
+				frame->absmax = x;
+		}
+	}
+}
+
+static void put_pixel(uint8_t *image, int x, int y)
+{
+	uint8_t *p;
+	if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT)
+		return;
+	p = image + 3 * (y * WIDTH + x);
+	p[0] = 255;
+	p[1] = 255;
+	p[2] = 255;
+}
+
+static void draw_line(uint8_t *image, int x0, int y0, int x1, int y1)
+{
+	int dx = abs(x1 - x0);
+	int dy = -abs(y1 - y0);
+	int sx = x0 < x1 ? 1 : -1;
+	int sy = y0 < y1 ? 1 : -1;
+	int err = dx + dy;
+
+	while (1) {
+		int e2;
+		put_pixel(image, x0, y0);
+		if (x0 == x1 && y0 == y1)
+			break;
+		e2 = 2 * err;
+		if (e2 >= dy) {
+			err += dy;
+			x0 += sx;
+		}
+		if (e2 <= dx) {
+			err += dx;
+			y0 += sy;
+		}
+	}
+}
+
+static void draw_frame(struct frame *frame)
+{
+	const int amplitude = VERTICAL_DIM / 2 - 1;
+	int ch;
+	int x;
+
+	memset(frame->image, 0, FRAME_BYTES);
+
+	for (ch = 0; ch < NUM_CHANNELS; ch++) {
+		const double *s = frame->signals[ch];
+		int basey = ch * (VERTICAL_DIM + MARGIN) + VERTICAL_DIM / 2;
+		int y = basey + (int) (s[0] * frame->normaliser * amplitude);
+		for (x = 0; x < SAMPLES_PER_FRAME; x++) {
+			int nexty;
+			if ((x + 1) == SAMPLES_PER_FRAME) {
+				put_pixel(frame->image, PIXELS_PER_SAMPLE * x,
+					  y);
+				break;
+			}
+			nexty = basey + (int) (s[x + 1] * frame->normaliser *
+					       amplitude);
+			draw_line(frame->image, PIXELS_PER_SAMPLE * x, y,
+				  PIXELS_PER_SAMPLE * (x + 1), nexty);
+			y = nexty;
+		}
+	}
+}
+
+static void *run_job(void *arg)
+{
+	struct job *job = arg;
+	int i;
+	for (i = 0; i < job->nframes; i++) {
+		if (job->draw)
+			draw_frame(&job->frames[i]);
+		else
+			compute_signals(&job->frames[i], job->trace,
+					job->firstframe + i);
+	}
+	return NULL;
+}
+
+/* Processes frames in parallel. Frames are split into contiguous ranges. */
+static void run_jobs(struct job *jobs, int nthreads, const struct trace *trace,
+		     struct frame *frames, int64_t firstframe, int nframes,
+		     int draw)
+{
+	int i;
+	int begin = 0;
+
+	for (i = 0; i < nthreads; i++) {
+		int end = (int) ((int64_t) nframes * (i + 1) / nthreads);
+		jobs[i].trace = trace;
+		jobs[i].frames = frames + begin;
+		jobs[i].firstframe = firstframe + begin;
+		jobs[i].nframes = end - begin;
+		jobs[i].draw = draw;
+		if (pthread_create(&jobs[i].thread, NULL, run_job, &jobs[i])) {
+			fprintf(stderr, "uade-scope: Can not create thread\n");
+			exit(1);
+		}
+		begin = end;
+	}
+	for (i = 0; i < nthreads; i++)
+		pthread_join(jobs[i].thread, NULL);
+}
+
+/*
+ * The normaliser of a frame is the smallest 1 / absmax among the last
+ * 'length' values, including an initial 1.0. This equals the deque logic
+ * in write_audio.py.
+ */
+static double *normalisers;
+static int normaliserlength;
+static int64_t nnormalisers;
+
+static double next_normaliser(double absmax)
+{
+	double n = 1.0;
+	int64_t i;
+	int64_t first;
+
+	if (normaliserlength == 0)
+		return 1.0;
+
+	normalisers[nnormalisers % normaliserlength] = 1.0 / absmax;
+	nnormalisers++;
+
+	/* The initial 1.0 is dropped after 'length' values */
+	first = nnormalisers - normaliserlength;
+	if (first < 0)
+		first = 0;
+	else
+		n = normalisers[first % normaliserlength];
+	for (i = first; i < nnormalisers; i++) {
+		if (normalisers[i % normaliserlength] < n)
+			n = normalisers[i % normaliserlength];
+	}
+	return n;
+}
+
+static int write_wave(const char *fname, const struct trace *trace,
+		      int frequency)
+{
+	uint8_t h[44];
+	uint32_t datasize = trace->nsamples * 2;
+	size_t i;
+	FILE *f = fopen(fname, "wb");
+	if (f == NULL) {
+		fprintf(stderr, "uade-scope: Can not open %s: %s\n", fname,
+			strerror(errno));
+		return -1;
+	}
+
+#define PUT_LE32(p, x) do { (p)[0] = (x); (p)[1] = (x) >> 8; \
+		(p)[2] = (x) >> 16; (p)[3] = (x) >> 24; } while (0)
+#define PUT_LE16(p, x) do { (p)[0] = (x); (p)[1] = (x) >> 8; } while (0)
+	memcpy(h, "RIFF", 4);
+	PUT_LE32(h + 4, 36 + datasize);
+	memcpy(h + 8, "WAVEfmt ", 8);
+	PUT_LE32(h + 16, 16);
+	PUT_LE16(h + 20, 1);
+	PUT_LE16(h + 22, 2);
+	PUT_LE32(h + 24, frequency);
+	PUT_LE32(h + 28, frequency * 4);
+	PUT_LE16(h + 32, 4);
+	PUT_LE16(h + 34, 16);
+	memcpy(h + 36, "data", 4);
+	PUT_LE32(h + 40, datasize);
+	fwrite(h, sizeof(h), 1, f);
+
+	for (i = 0; i < trace->nsamples; i++) {
+		uint8_t s[2];
+		PUT_LE16(s, trace->samples[i]);
+		fwrite(s, sizeof(s), 1, f);
+	}
+#undef PUT_LE32
+#undef PUT_LE16
+
+	if (fclose(f)) {
+		fprintf(stderr, "uade-scope: Can not write %s\n", fname);
+		return -1;
+	}
+	return 0;
+}
+
+/* Maps the file to memory, or reads it if it can not be mapped */
+static uint8_t *load_file(size_t *size, int *mapped, const char *fname)
+{
+	struct stat st;
+	uint8_t *data = NULL;
+	size_t allocated = 0;
+	ssize_t ret;
+	int fd = 0;
+
+	*size = 0;
+	*mapped = 0;
+
+	if (strcmp(fname, "-") != 0) {
+		fd = open(fname, O_RDONLY);
+		if (fd < 0) {
+			fprintf(stderr, "uade-scope: Can not open %s: %s\n",
+				fname, strerror(errno));
+			return NULL;
+		}
+		if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+		    st.st_size > 0) {
+			data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+				    fd, 0);
+			if (data != MAP_FAILED) {
+				close(fd);
+				*size = st.st_size;
+				*mapped = 1;
+				return data;
+			}
+			data = NULL;
+		}
+	}
+
+	while (1) {
+		if (*size == allocated) {
+			allocated = 2 * allocated + (1 << 20);
+			data = xrealloc(data, allocated);
+		}
+		ret = read(fd, data + *size, allocated - *size);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret < 0) {
+			fprintf(stderr, "uade-scope: Can not read %s: %s\n",
+				fname, strerror(errno));
+			free(data);
+			data = NULL;
+			break;
+		}
+		if (ret == 0)
+			break;
+		*size += ret;
+	}
+	if (fd != 0)
+		close(fd);
+	return data;
+}
+
+static void usage(const char *name)
+{
+	printf(
+"Usage: %s [options] TRACE\n"
+"\n"
+"Writes oscilloscope view images of a write-audio trace as raw RGB24\n"
+"frames (%dx%d) to stdout. TRACE can be - for stdin.\n"
+"\n"
+" --fps=x                  Frame rate. The default is 60.\n"
+" --normalisation-length=x Number of frames used for normalising the\n"
+"                          amplitude. The default is 50.\n"
+" --sampling-rate=x        Sampling rate of the wave file.\n"
+"                          The default is 44100.\n"
+" -j x, --threads=x        Number of threads. The default is the number\n"
+"                          of online CPUs.\n"
+" --no-video               Do not write frames. Use with --wave.\n"
+" --wave=fname             Write audio to a wave file.\n",
+	       name, WIDTH, HEIGHT);
+}
+
+int main(int argc, char *argv[])
+{
+	int fps = 60;
+	int frequency = 44100;
+	int nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	const char *wavename = NULL;
+	int novideo = 0;
+	struct trace trace;
+	struct frame *frames;
+	struct job *jobs;
+	uint8_t *data;
+	size_t size;
+	int mapped;
+	int64_t nframes;
+	int64_t framenr;
+	int batchsize;
+	int ret;
+	int i;
+
+	enum {
+		OPT_FPS = 0x100,
+		OPT_NORMALISATION_LENGTH,
+		OPT_NO_VIDEO,
+		OPT_SAMPLING_RATE,
+		OPT_WAVE,
+	};
+
+	const struct option long_options[] = {
+		{"fps",                  1, NULL, OPT_FPS},
+		{"help",                 0, NULL, 'h'},
+		{"no-video",             0, NULL, OPT_NO_VIDEO},
+		{"normalisation-length", 1, NULL, OPT_NORMALISATION_LENGTH},
+		{"sampling-rate",        1, NULL, OPT_SAMPLING_RATE},
+		{"threads",              1, NULL, 'j'},
+		{"wave",                 1, NULL, OPT_WAVE},
+		{NULL,                   0, NULL, 0}
+	};
+
+	normaliserlength = 50;
+
+	while ((ret = getopt_long(argc, argv, "hj:", long_options, 0)) != -1) {
+		switch (ret) {
+		case OPT_FPS:
+			fps = atoi(optarg);
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		case 'j':
+			nthreads = atoi(optarg);
+			break;
+		case OPT_NO_VIDEO:
+			novideo = 1;
+			break;
+		case OPT_NORMALISATION_LENGTH:
+			normaliserlength = atoi(optarg);
+			break;
+		case OPT_SAMPLING_RATE:
+			frequency = atoi(optarg);
+			break;
+		case OPT_WAVE:
+			wavename = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (optind + 1 != argc) {
+		usage(argv[0]);
+		return 1;
+	}
+	if (fps <= 0 || normaliserlength < 0 || frequency <= 0) {
+		fprintf(stderr, "uade-scope: Invalid arguments\n");
+		return 1;
+	}
+	if (nthreads <= 0)
+		nthreads = 1;
+
+	video_frame_ticks = SOUNDTICKS_PAL / fps;
+
+	data = load_file(&size, &mapped, argv[optind]);
+	if (data == NULL)
+		return 1;
+	ret = decode_trace(&trace, data, size);
+	if (mapped)
+		munmap(data, size);
+	else
+		free(data);
+	if (ret)
+		return 1;
+
+	if (wavename != NULL && write_wave(wavename, &trace, frequency))
+		return 1;
+
+	nframes = 0;
+	if (!novideo && trace.time >= WINDOW_TICKS)
+		nframes = (trace.time - WINDOW_TICKS) / video_frame_ticks + 1;
+
+	if (normaliserlength > 0)
+		normalisers = xrealloc(NULL, normaliserlength *
+				       sizeof(normalisers[0]));
+
+	/* Each thread renders a few frames per batch to bound memory use */
+	batchsize = 4 * nthreads;
+	frames = xrealloc(NULL, batchsize * sizeof(frames[0]));
+	jobs = xrealloc(NULL, nthreads * sizeof(jobs[0]));
+	for (i = 0; i < batchsize; i++)
+		frames[i].image = xrealloc(NULL, FRAME_BYTES);
+
+	for (framenr = 0; framenr < nframes; framenr += batchsize) {
+		int n = batchsize;
+		int threads = nthreads;
+		if (nframes - framenr < n)
+			n = nframes - framenr;
+		if (threads > n)
+			threads = n;
+
+		run_jobs(jobs, threads, &trace, frames, framenr, n, 0);
+		for (i = 0; i < n; i++)
+			frames[i].normaliser = next_normaliser(frames[i].absmax);
+		run_jobs(jobs, threads, &trace, frames, framenr, n, 1);
+
+		for (i = 0; i < n; i++) {
+			if (fwrite(frames[i].image, FRAME_BYTES, 1,
+				   stdout) != 1) {
+				fprintf(stderr, "uade-scope: Can not write "
+					"frame: %s\n", strerror(errno));
+				return 1;
+			}
+		}
+	}
+
+	if (fflush(stdout)) {
+		fprintf(stderr, "uade-scope: Can not write frames\n");
+		return 1;
+	}
+	return 0;
+}
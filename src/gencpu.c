@@ -30,6 +30,7 @@ static FILE *stblfile;
 
 static int using_prefetch;
 static int using_exception_3;
+static int using_direct_chipmem;
 static int cpu_level;
 
 /* For the current opcode, the next lower level that will have different code.
@@ -2308,6 +2309,10 @@ static void gen_opcode (unsigned long int opcode)
 
 static void generate_includes (FILE * f)
 {
+    /* Must be seen before memory.h so that get_word() etc. are generated
+     * with the inline chip memory check. */
+    if (using_direct_chipmem)
+	fprintf (f, "#define DIRECT_CHIPMEM_ACCESS 1\n");
     fprintf (f, "#include \"sysconfig.h\"\n");
     fprintf (f, "#include \"sysdeps.h\"\n");
     fprintf (f, "#include \"options.h\"\n");
@@ -2517,6 +2522,17 @@ static void generate_func (void)
 
 int main (int argc, char **argv)
 {
+    int i;
+
+    for (i = 1; i < argc; i++) {
+	if (strcmp (argv[i], "--direct-chipmem") == 0) {
+	    using_direct_chipmem = 1;
+	} else {
+	    fprintf (stderr, "gencpu: unknown option: %s\n", argv[i]);
+	    return 1;
+	}
+    }
+
     read_table68k ();
     do_merges ();
 
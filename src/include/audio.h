@@ -12,28 +12,41 @@
 #include "sinctable.h"
 
 #define AUDIO_DEBUG 0
-/* Queue length 256 implies minimum emulated period of 8. This should be
- * sufficient for all imaginable purposes. This must be power of two. */
-#define SINC_QUEUE_LENGTH 256
+/* Queue length 512 implies minimum emulated period of 8 with the longest
+ * BLEP (SINC_MAX_LENGTH). This should be sufficient for all imaginable
+ * purposes. This must be power of two. */
+#define SINC_QUEUE_LENGTH 512
 
 typedef struct {
     int time, output;
 } sinc_queue_t;
 
-extern struct audio_channel_data {
-    unsigned long adk_mask;
-    unsigned long evtime;
+/* Channel state that run_audio() reads or writes on every time slice. It is
+ * stored as arrays indexed by channel number so that the loops over the four
+ * channels compile to vector code. The rest is in audio_channel[]. */
+extern MACHINE_LOCAL struct audio_slice_data {
+    unsigned long evtime[4];
+    int state[4];
+    int current_sample[4];
+    int vol[4];
+    int adk_mask[4];
+    /* (current_sample * vol) & adk_mask of each channel. Code that changes
+       one of the terms sets output_dirty, and run_audio() recomputes the
+       outputs before the next slice. */
+    int output[4];
+    int output_dirty;
+} audio_slice;
+
+extern MACHINE_LOCAL struct audio_channel_data {
     unsigned char dmaen, intreq2, data_written;
     uaecptr lc, pt;
 
-    int state, wper, wlen;
-    int current_sample;
+    int wper, wlen;
     int sample_accum, sample_accum_time;
     int output_state;
     sinc_queue_t sinc_queue[SINC_QUEUE_LENGTH];
     int sinc_queue_time;
     int sinc_queue_head;
-    int vol;
     uae_u16 dat, nextdat, per, len;    
 
     /* Debug variables */
@@ -47,11 +60,14 @@ extern void AUDxLCH (int nr, uae_u16 value);
 extern void AUDxLCL (int nr, uae_u16 value);
 extern void AUDxLEN (int nr, uae_u16 value);
 
+void audio_cleanup (void);
+void audio_filter_sound_buffer (void);
 void audio_reset (void);
 void audio_set_filter(int filter_type, int filter_force);
 void audio_set_rate (int rate);
 void audio_set_resampler(char *name);
 void audio_set_write_audio_fname(const char *fname);
+void audio_use_stems(void);
 void audio_use_text_scope(void);
 void update_audio (void);
 
@@ -15,12 +15,12 @@ extern void diskindex_handler(void);
 
 extern void dumpcia(void);
 
-extern unsigned int ciaaicr,ciaaimask,ciabicr,ciabimask;
-extern unsigned int ciaacra,ciaacrb,ciabcra,ciabcrb;
-extern unsigned int ciaapra, ciabpra;
-extern unsigned long ciaata,ciaatb,ciabta,ciabtb;
-extern unsigned long ciaatod,ciabtod,ciaatol,ciabtol,ciaaalarm,ciabalarm;
-extern int ciaatlatch,ciabtlatch;
+extern MACHINE_LOCAL unsigned int ciaaicr,ciaaimask,ciabicr,ciabimask;
+extern MACHINE_LOCAL unsigned int ciaacra,ciaacrb,ciabcra,ciabcrb;
+extern MACHINE_LOCAL unsigned int ciaapra, ciabpra;
+extern MACHINE_LOCAL unsigned long ciaata,ciaatb,ciabta,ciabtb;
+extern MACHINE_LOCAL unsigned long ciaatod,ciabtod,ciaatol,ciabtol,ciaaalarm,ciabalarm;
+extern MACHINE_LOCAL int ciaatlatch,ciabtlatch;
 
-extern unsigned int gui_ledstate;
-extern int gui_ledstate_forced;
+extern MACHINE_LOCAL unsigned int gui_ledstate;
+extern MACHINE_LOCAL int gui_ledstate_forced;
@@ -28,10 +28,10 @@ extern int picasso_on;
 
 /* Set to 1 to leave out the current frame in average frame time calculation.
  * Useful if the debugger was active.  */
-extern int bogusframe;
+extern MACHINE_LOCAL int bogusframe;
 
-extern uae_u16 dmacon;
-extern uae_u16 intena,intreq;
+extern MACHINE_LOCAL uae_u16 dmacon;
+extern MACHINE_LOCAL uae_u16 intena,intreq;
 
 extern int current_hpos (void);
 
@@ -52,11 +52,11 @@ static inline int dmaen (unsigned int dmamask)
 #define SPCFLAG_EXEC 1024
 #define SPCFLAG_MODE_CHANGE 8192
 
-extern int dskdmaen;
-extern uae_u16 adkcon;
+extern MACHINE_LOCAL int dskdmaen;
+extern MACHINE_LOCAL uae_u16 adkcon;
 
-extern unsigned int joy0dir, joy1dir;
-extern int joy0button, joy1button;
+extern MACHINE_LOCAL unsigned int joy0dir, joy1dir;
+extern MACHINE_LOCAL int joy0button, joy1button;
 
 extern void INTREQ (uae_u16);
 extern uae_u16 INTREQR (void);
@@ -87,7 +87,7 @@ extern uae_u16 INTREQR (void);
 #define MAXVPOS (MAXVPOS_PAL)
 #define SOUNDTICKS (SOUNDTICKS_PAL)
 
-extern int maxhpos, maxvpos, minfirstline, vblank_endline, numscrlines, vblank_hz;
+extern MACHINE_LOCAL int maxhpos, maxvpos, minfirstline, vblank_endline, numscrlines, vblank_hz;
 extern unsigned long syncbase;
 #define NUMSCRLINES (maxvpos+1-minfirstline+1)
 
@@ -102,7 +102,7 @@ extern unsigned long syncbase;
 #define DMA_BITPLANE  0x0100
 #define DMA_BLITPRI   0x0400
 
-extern unsigned long frametime, timeframes;
+extern MACHINE_LOCAL unsigned long frametime, timeframes;
 
 /* 50 words give you 800 horizontal pixels. An A500 can't do that, so it ought
  * to be enough.  Don't forget to update the definition in genp2c.c as well.  */
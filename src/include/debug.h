@@ -9,16 +9,16 @@
 
 #define	MAX_HIST	10000
 
-extern int firsthist;
-extern int lasthist;
-extern int debugging;
-extern int debug_interrupt_happened;
+extern MACHINE_LOCAL int firsthist;
+extern MACHINE_LOCAL int lasthist;
+extern MACHINE_LOCAL int debugging;
+extern MACHINE_LOCAL int debug_interrupt_happened;
 
 #ifdef NEED_TO_DEBUG_BADLY
-extern struct regstruct history[MAX_HIST];
-extern union flagu historyf[MAX_HIST];
+extern MACHINE_LOCAL struct regstruct history[MAX_HIST];
+extern MACHINE_LOCAL union flagu historyf[MAX_HIST];
 #else
-extern uaecptr history[MAX_HIST];
+extern MACHINE_LOCAL uaecptr history[MAX_HIST];
 #endif
 
 extern void debug(void);
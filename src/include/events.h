@@ -10,9 +10,9 @@
   */
 
 extern void reset_frame_rate_hack (void);
-extern int rpt_available;
+extern MACHINE_LOCAL int rpt_available;
 
-extern unsigned long int cycles, nextevent, is_lastline;
+extern MACHINE_LOCAL unsigned long int cycles, nextevent, is_lastline;
 extern unsigned long int sample_evtime;
 typedef void (*evfunc)(void);
 
@@ -29,7 +29,7 @@ enum {
     ev_max
 };
 
-extern struct ev eventtab[ev_max];
+extern MACHINE_LOCAL struct ev eventtab[ev_max];
 
 static void events_schedule (void)
 {
@@ -7,7 +7,7 @@
   * Copyright 1997 Bernd Schmidt
   */
 
-extern int sound_available;
+extern MACHINE_LOCAL int sound_available;
 
 /* Determine if we can produce any sound at all.  This can be only a guess;
  * if unsure, say yes.  Any call to init_sound may change the value.  */
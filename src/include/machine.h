@@ -0,0 +1,47 @@
+#ifndef _MACHINE_H_
+#define _MACHINE_H_
+
+#include <pthread.h>
+#include <setjmp.h>
+
+/*
+ * An amiga_machine is one emulator instance that libuade controls through
+ * an IPC connection, exactly like a uadecore process.
+ *
+ * All mutable emulator state (CPU registers, memory banks, custom chips,
+ * CIAs, Paula, the event table and the song) is MACHINE_LOCAL, that is,
+ * private to the thread that runs the machine. The uadecore executable runs
+ * one machine on the main thread. amiga_machine_start() runs another one on
+ * a new thread, so that one process can host many independent machines.
+ */
+struct amiga_machine {
+	pthread_t thread;
+	int in_fd;
+	int out_fd;
+	int status;      /* Exit status, valid after amiga_machine_join() */
+	jmp_buf exitbuf; /* uadecore_exit() returns here */
+};
+
+/*
+ * Starts a machine that reads commands from in_fd and writes replies to
+ * out_fd. The descriptors are not closed by the machine. Returns 0 on
+ * success, and -1 on error.
+ */
+int amiga_machine_start(struct amiga_machine *machine, int in_fd, int out_fd);
+
+/*
+ * Waits until the machine terminates. A machine terminates when the other
+ * end closes the connection, or on a fatal error. Returns the exit status,
+ * which is 0 on normal termination.
+ */
+int amiga_machine_join(struct amiga_machine *machine);
+
+/*
+ * Runs a machine for each connection descriptor that is received with
+ * SCM_RIGHTS from the UNIX socket 'sock'. This is the "uadecore -m" mode
+ * that lets libuade run many songs in one process. Returns 0 after the
+ * socket is closed and all machines have terminated.
+ */
+int amiga_machine_host(int sock);
+
+#endif
@@ -15,6 +15,8 @@
 #define SAVE_MEMORY_BANKS
 #endif
 
+#include <stdint.h>
+
 #ifndef REGPARAM
 #define REGPARAM
 #endif
@@ -24,19 +26,21 @@ typedef void (*mem_put_func)(uaecptr, uae_u32) REGPARAM;
 typedef uae_u8 *(*xlate_func)(uaecptr) REGPARAM;
 typedef int (*check_func)(uaecptr, uae_u32) REGPARAM;
 
-extern char *address_space, *good_address_map;
-extern uae_u8 *chipmemory;
+extern MACHINE_LOCAL char *address_space, *good_address_map;
+extern MACHINE_LOCAL uae_u8 *chipmemory;
 
-extern uae_u32 allocated_chipmem;
-extern uae_u32 allocated_fastmem;
-extern uae_u32 allocated_bogomem;
-extern uae_u32 allocated_gfxmem;
-extern uae_u32 allocated_z3fastmem;
-extern uae_u32 allocated_a3000mem;
+extern MACHINE_LOCAL uae_u32 allocated_chipmem;
+extern MACHINE_LOCAL uae_u32 allocated_fastmem;
+extern MACHINE_LOCAL uae_u32 allocated_bogomem;
+extern MACHINE_LOCAL uae_u32 allocated_gfxmem;
+extern MACHINE_LOCAL uae_u32 allocated_z3fastmem;
+extern MACHINE_LOCAL uae_u32 allocated_a3000mem;
 
 #undef DIRECT_MEMFUNCS_SUCCESSFUL
 #include "machdep/maccess.h"
 
+#include <uade/compilersupport.h>
+
 #ifndef CAN_MAP_MEMORY
 #undef USE_COMPILER
 #endif
@@ -52,7 +56,7 @@ extern uae_u32 allocated_a3000mem;
 #define a3000mem_start 0x07000000
 #define kickmem_start 0x00F80000
 
-extern int ersatzkickfile;
+extern MACHINE_LOCAL int ersatzkickfile;
 
 typedef struct {
     /* These ones should be self-explanatory... */
@@ -68,15 +72,17 @@ typedef struct {
      * that the pointer points to an area of at least the specified size.
      * This is used for example to translate bitplane pointers in custom.c */
     check_func check;
+    /* Number of get_*() and put_*() calls to the bank, see uadestats.h */
+    uint64_t accesses;
 } addrbank;
 
 extern uae_u8 filesysory[65536];
 
-extern addrbank chipmem_bank;
-extern addrbank kickmem_bank;
-extern addrbank custom_bank;
-extern addrbank clock_bank;
-extern addrbank cia_bank;
+extern MACHINE_LOCAL addrbank chipmem_bank;
+extern MACHINE_LOCAL addrbank kickmem_bank;
+extern MACHINE_LOCAL addrbank custom_bank;
+extern MACHINE_LOCAL addrbank clock_bank;
+extern MACHINE_LOCAL addrbank cia_bank;
 extern addrbank rtarea_bank;
 extern addrbank expamem_bank;
 extern addrbank fastmem_bank;
@@ -100,17 +106,23 @@ extern uae_u8 *default_xlate(uaecptr addr) REGPARAM;
 #define bankindex(addr) (((uaecptr)(addr)) >> 16)
 
 #ifdef SAVE_MEMORY_BANKS
-extern addrbank *mem_banks[65536];
+extern MACHINE_LOCAL addrbank *mem_banks[65536];
 #define get_mem_bank(addr) (*mem_banks[bankindex(addr)])
 #define put_mem_bank(addr, b) (mem_banks[bankindex(addr)] = (b))
 #else
-extern addrbank mem_banks[65536];
+extern MACHINE_LOCAL addrbank mem_banks[65536];
 #define get_mem_bank(addr) (mem_banks[bankindex(addr)])
 #define put_mem_bank(addr, b) (mem_banks[bankindex(addr)] = *(b))
 #endif
 
 extern void memory_init(void);
+extern void memory_cleanup(void);
 extern void map_banks(addrbank *bank, int first, int count);
+extern void memory_reset_accesses(void);
+/* accesses is indexed by enum uade_stats_region */
+extern void memory_get_accesses(uint64_t *accesses);
+
+#define count_access(addr) (get_mem_bank(addr).accesses++)
 
 #ifndef NO_INLINE_MEMORY_ACCESS
 
@@ -145,31 +157,107 @@ extern void byteput(uaecptr addr, uae_u32 b);
 
 #endif
 
+#ifdef DIRECT_CHIPMEM_ACCESS
+
+/* Chip memory is mapped at address zero and uade never remaps it, so
+ * accesses below allocated_chipmem can skip the bank function pointers.
+ * gencpu --direct-chipmem defines DIRECT_CHIPMEM_ACCESS for the generated
+ * CPU handlers. Other memory regions (custom, CIA, ROM) still go through
+ * mem_banks[]. */
+
+static inline uae_u32 get_long(uaecptr addr)
+{
+    if (likely(addr < allocated_chipmem)) {
+	chipmem_bank.accesses++;
+	return do_get_mem_long((uae_u32 *)(chipmemory + addr));
+    }
+    count_access(addr);
+    return longget_1(addr);
+}
+static inline uae_u32 get_word(uaecptr addr)
+{
+    if (likely(addr < allocated_chipmem)) {
+	chipmem_bank.accesses++;
+	return do_get_mem_word((uae_u16 *)(chipmemory + addr));
+    }
+    count_access(addr);
+    return wordget_1(addr);
+}
+static inline uae_u32 get_byte(uaecptr addr)
+{
+    if (likely(addr < allocated_chipmem)) {
+	chipmem_bank.accesses++;
+	return do_get_mem_byte(chipmemory + addr);
+    }
+    count_access(addr);
+    return byteget_1(addr);
+}
+static inline void put_long(uaecptr addr, uae_u32 l)
+{
+    if (likely(addr < allocated_chipmem)) {
+	chipmem_bank.accesses++;
+	do_put_mem_long((uae_u32 *)(chipmemory + addr), l);
+    } else {
+	count_access(addr);
+	longput_1(addr, l);
+    }
+}
+static inline void put_word(uaecptr addr, uae_u32 w)
+{
+    if (likely(addr < allocated_chipmem)) {
+	chipmem_bank.accesses++;
+	do_put_mem_word((uae_u16 *)(chipmemory + addr), w);
+    } else {
+	count_access(addr);
+	wordput_1(addr, w);
+    }
+}
+static inline void put_byte(uaecptr addr, uae_u32 b)
+{
+    if (likely(addr < allocated_chipmem)) {
+	chipmem_bank.accesses++;
+	do_put_mem_byte(chipmemory + addr, b);
+    } else {
+	count_access(addr);
+	byteput_1(addr, b);
+    }
+}
+
+#else
+
 static inline uae_u32 get_long(uaecptr addr)
 {
+    count_access(addr);
     return longget_1(addr);
 }
 static inline uae_u32 get_word(uaecptr addr)
 {
+    count_access(addr);
     return wordget_1(addr);
 }
 static inline uae_u32 get_byte(uaecptr addr)
 {
+    count_access(addr);
     return byteget_1(addr);
 }
 static inline void put_long(uaecptr addr, uae_u32 l)
 {
+    count_access(addr);
     longput_1(addr, l);
 }
 static inline void put_word(uaecptr addr, uae_u32 w)
 {
+    count_access(addr);
     wordput_1(addr, w);
 }
 static inline void put_byte(uaecptr addr, uae_u32 b)
 {
+    count_access(addr);
     byteput_1(addr, b);
 }
 
+#endif /* DIRECT_CHIPMEM_ACCESS */
+
 static inline uae_u8 *get_real_address(uaecptr addr)
 {
     return get_mem_bank(addr).xlateaddr(addr);
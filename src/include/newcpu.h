@@ -37,15 +37,15 @@ while (0)
 extern int areg_byteinc[];
 extern int imm8_table[];
 
-extern int movem_index1[256];
-extern int movem_index2[256];
-extern int movem_next[256];
+extern MACHINE_LOCAL int movem_index1[256];
+extern MACHINE_LOCAL int movem_index2[256];
+extern MACHINE_LOCAL int movem_next[256];
 
-extern int fpp_movem_index1[256];
-extern int fpp_movem_index2[256];
-extern int fpp_movem_next[256];
+extern MACHINE_LOCAL int fpp_movem_index1[256];
+extern MACHINE_LOCAL int fpp_movem_index2[256];
+extern MACHINE_LOCAL int fpp_movem_next[256];
 
-extern int broken_in;
+extern MACHINE_LOCAL int broken_in;
 
 typedef unsigned long cpuop_func (uae_u32) REGPARAM;
 
@@ -59,7 +59,7 @@ extern unsigned long op_illg (uae_u32) REGPARAM;
 
 typedef char flagtype;
 
-extern struct regstruct
+extern MACHINE_LOCAL struct regstruct
 {
     uae_u32 regs[16];
     uaecptr  usp,isp,msp;
@@ -252,11 +252,11 @@ extern void fsave_opp (uae_u32);
 extern void frestore_opp (uae_u32);
 
 /* Opcode of faulting instruction */
-extern uae_u16 last_op_for_exception_3;
+extern MACHINE_LOCAL uae_u16 last_op_for_exception_3;
 /* PC at fault time */
-extern uaecptr last_addr_for_exception_3;
+extern MACHINE_LOCAL uaecptr last_addr_for_exception_3;
 /* Address that generated the exception */
-extern uaecptr last_fault_for_exception_3;
+extern MACHINE_LOCAL uaecptr last_fault_for_exception_3;
 
 #define CPU_OP_NAME(a) op ## a
 
@@ -271,5 +271,5 @@ extern struct cputbl op_smalltbl_3[];
 /* 68000 slow but compatible.  */
 extern struct cputbl op_smalltbl_4[];
 
-extern cpuop_func *cpufunctbl[65536];
+extern MACHINE_LOCAL cpuop_func *cpufunctbl[65536];
 
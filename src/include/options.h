@@ -147,7 +147,7 @@ extern int check_prefs_changed_gfx (void);
 #define JSEM_ISSOMEWHEREELSE(n,v) (JSEM_DECODEVAL(n,v) == 5)
 extern const char *gameport_state (int n);
 
-extern struct uae_prefs currprefs, changed_prefs;
+extern MACHINE_LOCAL struct uae_prefs currprefs, changed_prefs;
 
 #if __GNUC__ - 1 > 1 || __GNUC_MINOR__ - 1 > 6
 extern void write_log (const char *, ...) __attribute__ ((format (printf, 1, 2)));
@@ -163,9 +163,9 @@ extern void machdep_init (void);
 #define __unix
 #endif
 
-extern char romfile[], keyfile[], prtname[], sername[];
+extern MACHINE_LOCAL char romfile[], keyfile[], prtname[], sername[];
 
-extern int cloanto_rom;
+extern MACHINE_LOCAL int cloanto_rom;
 
 #define MAX_COLOR_MODES 5
 
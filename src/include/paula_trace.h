@@ -0,0 +1,17 @@
+#ifndef _PAULA_TRACE_H_
+#define _PAULA_TRACE_H_
+
+#include "write_audio.h"
+
+#include <stdint.h>
+
+/* Flags of UADE_COMMAND_SET_TRACE (enum uade_trace_flags) */
+extern MACHINE_LOCAL unsigned int paula_trace_flags;
+
+void paula_trace_set(unsigned int flags, unsigned int decimation);
+void paula_trace_output(const int output[4]);
+void paula_trace_event(int channel, enum PaulaEventType event_type,
+		       uint16_t value);
+void paula_trace_flush(void);
+
+#endif
@@ -70,7 +70,7 @@ struct instr_def {
 extern struct instr_def defs68k[];
 extern int n_defs68k;
 
-extern struct instr {
+extern MACHINE_LOCAL struct instr {
     long int handler;
     unsigned char dreg;
     unsigned char sreg;
@@ -95,5 +95,5 @@ extern struct instr {
 extern void read_table68k (void);
 extern void do_merges (void);
 extern int get_no_mismatches (void);
-extern int nr_cpuop_funcs;
+extern MACHINE_LOCAL int nr_cpuop_funcs;
 
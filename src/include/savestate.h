@@ -0,0 +1,57 @@
+#ifndef _SAVESTATE_H_
+#define _SAVESTATE_H_
+
+#include <setjmp.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct uade_msg;
+
+/*
+ * A snapshot is a serialized emulator state. Each module serializes its
+ * own variables with a *_savestate() function that is used for saving,
+ * checking and restoring, so the three can not go out of sync.
+ */
+enum savestate_mode {
+	SAVESTATE_SAVE,
+	SAVESTATE_CHECK,   /* Only validate the input */
+	SAVESTATE_RESTORE,
+};
+
+struct savestate {
+	enum savestate_mode mode;
+	uint8_t *buf;
+	size_t pos;
+	size_t size;
+	size_t allocated;
+	uint32_t layout;   /* Hash of variable sizes and order */
+	int error;
+};
+
+void savestate_data(struct savestate *ss, void *data, size_t size);
+/* Saves or restores a memory area. Only non-zero pages are stored. */
+void savestate_memory(struct savestate *ss, uint8_t *mem, size_t size);
+
+#define savestate_var(ss, var) savestate_data((ss), &(var), sizeof(var))
+
+void audio_savestate(struct savestate *ss);
+void cia_savestate(struct savestate *ss);
+void custom_savestate(struct savestate *ss);
+void memory_savestate(struct savestate *ss);
+void newcpu_savestate(struct savestate *ss);
+void uadecore_savestate(struct savestate *ss);
+
+/* Non-zero if UADE_COMMAND_SNAPSHOT is waiting for an instruction boundary */
+extern MACHINE_LOCAL int savestate_requested;
+
+/* m68k_go() sets this while m68k_run_1() may be running */
+extern MACHINE_LOCAL jmp_buf savestate_jmpbuf;
+extern MACHINE_LOCAL int savestate_jmpbuf_valid;
+
+void savestate_reset(void);
+void savestate_request(void);
+void savestate_try_send(void);
+void savestate_receive_chunk(const struct uade_msg *um);
+void savestate_restore_pending(void);
+
+#endif
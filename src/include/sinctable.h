@@ -1,7 +1,28 @@
 #ifndef _SINCTABLE_H_
 #define _SINCTABLE_H_
 
-#define SINC_QUEUE_MAX_AGE 2048
-extern const int winsinc_integral[5][SINC_QUEUE_MAX_AGE];
+/* BLEP lengths in bus cycles. The length must be a power of two. */
+#define SINC_MIN_LENGTH 256
+#define SINC_DEFAULT_LENGTH 2048
+#define SINC_MAX_LENGTH 4096
+
+/* BLEP table types, one for each filter configuration */
+enum sinc_table {
+    SINC_A500_OFF,
+    SINC_A500_ON,
+    SINC_A1200_OFF,
+    SINC_A1200_ON,
+    SINC_VANILLA,
+    SINC_TABLES
+};
+
+/*
+ * Computes a BLEP table of length entries. Entry i is the part of a unit
+ * step that has not reached the output i bus cycles after the step, scaled
+ * so that entry 0 is 1 << 17. cutoff is the cutoff frequency of the lowpass
+ * filter in Hz. Returns 0 on success, and -1 if there is no memory.
+ */
+int sinctable_generate(int *table, enum sinc_table type, int length,
+		       double cutoff);
 
 #endif
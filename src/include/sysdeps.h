@@ -206,6 +206,14 @@ extern void *xmalloc(size_t);
 #define ENUMNAME(name) ; typedef int name
 #endif
 
+/* Emulator state is private to the thread that runs the machine, so that
+ * one process can run several machines. See machine.h. */
+#ifdef __GNUC__
+#define MACHINE_LOCAL __thread
+#else
+#define MACHINE_LOCAL _Thread_local
+#endif
+
 /*
  * Porters to weird systems, look! This is the preferred way to get
  * filesys.c (and other stuff) running on your system. Define the
@@ -2,6 +2,7 @@
 #define _UADE_MAIN_H_
 
 #include <limits.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 #include <uade/uadeipc.h>
@@ -17,8 +18,11 @@ struct uade_song {
 };
 
 void uadecore_check_sound_buffers(int bytes);
+void uadecore_cleanup(void);
 void uadecore_send_debug(const char *fmt, ...);
+void uadecore_send_stems(uint16_t *stems, int frames);
 void uadecore_get_amiga_message(void);
+int uadecore_get_automatic_song_end(void);
 void uadecore_handle_r_state(void);
 void uadecore_option(int, char**); /* handles command line parameters */
 void uadecore_reset(void);
@@ -28,14 +32,17 @@ void uadecore_set_ntsc(int usentsc);
 void uadecore_song_end(char *reason, int kill_it);
 void uadecore_swap_buffer_bytes(void *data, int bytes);
 
-extern int uadecore_audio_output;
-extern int uadecore_audio_skip;
-extern int uadecore_debug;
+/* Terminates the machine of the calling thread. See machine.h. */
+void uadecore_exit(int status) __attribute__((noreturn));
+
+extern MACHINE_LOCAL int uadecore_audio_output;
+extern MACHINE_LOCAL int uadecore_audio_skip;
+extern MACHINE_LOCAL int uadecore_debug;
 extern int uadecore_local_sound;
-extern int uadecore_read_size;
-extern int uadecore_reboot;
-extern int uadecore_time_critical;
+extern MACHINE_LOCAL int uadecore_read_size;
+extern MACHINE_LOCAL int uadecore_reboot;
+extern MACHINE_LOCAL int uadecore_time_critical;
 
-extern struct uade_ipc uadecore_ipc;
+extern MACHINE_LOCAL struct uade_ipc uadecore_ipc;
 
 #endif
@@ -0,0 +1,44 @@
+#ifndef _UADESTATS_H_
+#define _UADESTATS_H_
+
+#include <uade/uadeipc.h>
+
+#include <stdint.h>
+
+/*
+ * Counters that uadecore reports with UADE_REPLY_STATS. They are reset when
+ * a song starts. Memory bank accesses are counted in addrbank, and emulated
+ * cycles are derived from the cycle counter when the stats are sent.
+ */
+struct uadecore_stats {
+	uint64_t instructions;
+	uint64_t paula_events;
+	uint64_t audio_handler_calls;
+	uint64_t audio_frames;
+	uint64_t ipc_messages_sent;
+	uint64_t ipc_bytes_sent;
+	uint64_t ipc_messages_received;
+	uint64_t ipc_bytes_received;
+	uint64_t audio_ns;
+	uint64_t ipc_ns;
+};
+
+extern MACHINE_LOCAL struct uadecore_stats uadecore_stats;
+
+/* Non-zero if UADE_COMMAND_GET_STATS is waiting for the send state */
+extern MACHINE_LOCAL int uadecore_stats_requested;
+
+uint64_t uadecore_stats_ns(void);
+void uadecore_stats_reset(void);
+/* Call before and after the emulator cycle counter is changed by a restore */
+void uadecore_stats_sync_cycles(void);
+void uadecore_stats_resync_cycles(void);
+void uadecore_stats_send(void);
+
+/* uade_send_*() to libuade that count the message in the stats */
+int uadecore_send_message(struct uade_msg *um);
+int uadecore_send_short_message(enum uade_msgtype msgtype);
+int uadecore_send_string(enum uade_msgtype msgtype, const char *s);
+int uadecore_send_u32(enum uade_msgtype msgtype, uint32_t x);
+
+#endif
@@ -9,9 +9,9 @@
 extern int uadecore_main (int argc, char **argv);
 extern void uae_quit (void);
 
-extern int quit_program;
+extern MACHINE_LOCAL int quit_program;
 
-extern char warning_buffer[256];
+extern MACHINE_LOCAL char warning_buffer[256];
 
 /* This structure is used to define menus. The val field can hold key
  * shortcuts, or one of these special codes:
@@ -18,10 +18,28 @@ enum PaulaEventType {
 	PET_MAX_ENUM,  /* This value may change */
 };
 
-#define UADE_WRITE_AUDIO_MAGIC "uade_osc_0\x00\xec\x17\x31\x03\x09"
+/* Old format with fixed size frames. It is not written anymore. */
+#define UADE_WRITE_AUDIO_MAGIC_V1 "uade_osc_0\x00\xec\x17\x31\x03\x09"
+
+/* Block based format with variable length records. See write_audio.c. */
+#define UADE_WRITE_AUDIO_MAGIC "uade_osc_1\x00\xec\x17\x31\x03\x09"
+
+/* Block and record types of UADE_WRITE_AUDIO_MAGIC files */
+enum uade_write_audio_block_type {
+	UADE_WRITE_AUDIO_BLOCK_RAW = 0,
+	UADE_WRITE_AUDIO_BLOCK_ZLIB = 1,
+};
+
+#define UADE_WRITE_AUDIO_BLOCK_HEADER_SIZE 9
+
+enum uade_write_audio_record_type {
+	UADE_WRITE_AUDIO_RECORD_OUTPUT = 1,
+	UADE_WRITE_AUDIO_RECORD_PAULA_EVENT = 2,
+	UADE_WRITE_AUDIO_RECORD_LEFT_RIGHT = 3,
+};
 
 struct uade_write_audio_header {
-	char magic[16];  // UADE_WRITE_AUDIO_MAGIC
+	char magic[16];  // UADE_WRITE_AUDIO_MAGIC or UADE_WRITE_AUDIO_MAGIC_V1
 };
 
 struct uade_write_audio;
@@ -29,8 +47,9 @@ struct uade_write_audio;
 struct uade_write_audio *uade_write_audio_init(const char *fname);
 void uade_write_audio_write(struct uade_write_audio *w, const int output[4],
 			    const unsigned long tdelta);
-void uade_write_audio_write_left_right(
-	struct uade_write_audio *w, const int left, const int right);
+void uade_write_audio_defer_left_right(struct uade_write_audio *w);
+void uade_write_audio_complete_left_right(
+	struct uade_write_audio *w, const int16_t *samples, size_t frames);
 void uade_write_audio_set_state(struct uade_write_audio *w,
 				const int channel,
 				const enum PaulaEventType event_type,
@@ -12,7 +12,7 @@
 #include "options.h"
 #include "machdep/m68k.h"
 
-struct flag_struct regflags;
+MACHINE_LOCAL struct flag_struct regflags;
 
 int fast_memcmp(const void *foo, const void *bar, int len)
 {
@@ -0,0 +1,172 @@
+/*
+ * Runs amiga machines on threads. See machine.h.
+ */
+
+#include "sysconfig.h"
+#include "sysdeps.h"
+
+#include "options.h"
+#include "uae.h"
+#include "memory.h"
+#include "readcpu.h"
+#include "uadectl.h"
+#include "machine.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+/* The machine of this thread, or NULL on the main thread of uadecore */
+static MACHINE_LOCAL struct amiga_machine *current_machine;
+
+void uadecore_exit(int status)
+{
+	if (current_machine == NULL)
+		exit(status);
+	current_machine->status = status;
+	longjmp(current_machine->exitbuf, 1);
+}
+
+static void *machine_thread(void *arg)
+{
+	struct amiga_machine *machine = arg;
+	char in[16];
+	char out[16];
+	char *argv[] = {"uadecore", "-i", in, "-o", out, NULL};
+
+	snprintf(in, sizeof in, "%d", machine->in_fd);
+	snprintf(out, sizeof out, "%d", machine->out_fd);
+
+	current_machine = machine;
+	if (setjmp(machine->exitbuf) == 0)
+		machine->status = uadecore_main(5, argv);
+
+	uadecore_cleanup();
+	memory_cleanup();
+	free(table68k);
+	table68k = NULL;
+	return NULL;
+}
+
+int amiga_machine_start(struct amiga_machine *machine, int in_fd, int out_fd)
+{
+	int ret;
+
+	machine->in_fd = in_fd;
+	machine->out_fd = out_fd;
+	machine->status = 0;
+
+	ret = pthread_create(&machine->thread, NULL, machine_thread, machine);
+	if (ret) {
+		fprintf(stderr, "uadecore: Can not create a machine thread: %s\n",
+			strerror(ret));
+		return -1;
+	}
+	return 0;
+}
+
+int amiga_machine_join(struct amiga_machine *machine)
+{
+	pthread_join(machine->thread, NULL);
+	return machine->status;
+}
+
+/* Machines of amiga_machine_host() that have not terminated yet */
+static pthread_mutex_t host_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t host_cond = PTHREAD_COND_INITIALIZER;
+static int host_machines;
+
+static void *host_waiter(void *arg)
+{
+	struct amiga_machine *machine = arg;
+	int status = amiga_machine_join(machine);
+
+	if (status)
+		fprintf(stderr, "uadecore: Machine exited with status %d\n",
+			status);
+	close(machine->in_fd);
+	free(machine);
+
+	pthread_mutex_lock(&host_mutex);
+	host_machines--;
+	pthread_cond_signal(&host_cond);
+	pthread_mutex_unlock(&host_mutex);
+	return NULL;
+}
+
+/*
+ * Receives one byte with a descriptor from the host socket. Returns the
+ * descriptor, or -1 when the socket is closed.
+ */
+static int receive_connection(int sock)
+{
+	char byte;
+	struct iovec iov = {.iov_base = &byte, .iov_len = 1};
+	union {
+		char buf[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} control;
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = control.buf,
+		.msg_controllen = sizeof control.buf,
+	};
+	struct cmsghdr *cmsg;
+	ssize_t ret;
+	int fd;
+
+	while (1) {
+		ret = recvmsg(sock, &msg, 0);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			return -1;
+		cmsg = CMSG_FIRSTHDR(&msg);
+		if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET &&
+		    cmsg->cmsg_type == SCM_RIGHTS &&
+		    cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+			memcpy(&fd, CMSG_DATA(cmsg), sizeof fd);
+			return fd;
+		}
+		fprintf(stderr, "uadecore: Host message without a descriptor\n");
+		msg.msg_controllen = sizeof control.buf;
+	}
+}
+
+int amiga_machine_host(int sock)
+{
+	struct amiga_machine *machine;
+	pthread_t waiter;
+	int fd;
+
+	while ((fd = receive_connection(sock)) >= 0) {
+		machine = calloc(1, sizeof machine[0]);
+		if (machine == NULL) {
+			fprintf(stderr, "uadecore: No memory for a machine\n");
+			close(fd);
+			continue;
+		}
+		if (amiga_machine_start(machine, fd, fd)) {
+			close(fd);
+			free(machine);
+			continue;
+		}
+		pthread_mutex_lock(&host_mutex);
+		host_machines++;
+		pthread_mutex_unlock(&host_mutex);
+		if (pthread_create(&waiter, NULL, host_waiter, machine)) {
+			/* Nobody else can join the machine */
+			host_waiter(machine);
+			continue;
+		}
+		pthread_detach(waiter);
+	}
+
+	pthread_mutex_lock(&host_mutex);
+	while (host_machines > 0)
+		pthread_cond_wait(&host_cond, &host_mutex);
+	pthread_mutex_unlock(&host_mutex);
+	return 0;
+}
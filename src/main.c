@@ -1,3 +1,6 @@
+#include "sysconfig.h"
+#include "sysdeps.h"
+
 #include <uae.h>
 
 int main(int argc, char **argv)
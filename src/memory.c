@@ -14,24 +14,27 @@
 #include "memory.h"
 
 #include "uadectl.h"
+#include "savestate.h"
+
+#include <uade/uade.h>
 
 #ifdef USE_MAPPED_MEMORY
 #include <sys/mman.h>
 #endif
 
-int ersatzkickfile = 0;
+MACHINE_LOCAL int ersatzkickfile = 0;
 
-uae_u32 allocated_chipmem;
-uae_u32 allocated_fastmem;
-uae_u32 allocated_bogomem;
-uae_u32 allocated_gfxmem;
-uae_u32 allocated_z3fastmem;
-uae_u32 allocated_a3000mem;
+MACHINE_LOCAL uae_u32 allocated_chipmem;
+MACHINE_LOCAL uae_u32 allocated_fastmem;
+MACHINE_LOCAL uae_u32 allocated_bogomem;
+MACHINE_LOCAL uae_u32 allocated_gfxmem;
+MACHINE_LOCAL uae_u32 allocated_z3fastmem;
+MACHINE_LOCAL uae_u32 allocated_a3000mem;
 
 #ifdef SAVE_MEMORY_BANKS
-addrbank *mem_banks[65536];
+MACHINE_LOCAL addrbank *mem_banks[65536];
 #else
-addrbank mem_banks[65536];
+MACHINE_LOCAL addrbank mem_banks[65536];
 #endif
 
 #ifdef NO_INLINE_MEMORY_ACCESS
@@ -61,7 +64,7 @@ inline void byteput (uaecptr addr, uae_u32 b)
 }
 #endif
 
-static uae_u32 chipmem_mask, kickmem_mask, bogomem_mask, a3000mem_mask;
+static MACHINE_LOCAL uae_u32 chipmem_mask, kickmem_mask, bogomem_mask, a3000mem_mask;
 
 /* A dummy bank that only contains zeros */
 
@@ -130,7 +133,7 @@ static void mbres_wput (uaecptr, uae_u32) REGPARAM;
 static void mbres_bput (uaecptr, uae_u32) REGPARAM;
 static int mbres_check (uaecptr addr, uae_u32 size) REGPARAM;
 
-static int mbres_val = 0;
+static MACHINE_LOCAL int mbres_val = 0;
 
 static uae_u32 REGPARAM2 mbres_lget (uaecptr addr)
 {
@@ -185,7 +188,7 @@ static int REGPARAM2 mbres_check (uaecptr addr, uae_u32 size)
 
 /* Chip memory */
 
-uae_u8 *chipmemory;
+MACHINE_LOCAL uae_u8 *chipmemory;
 
 static uae_u32 chipmem_lget (uaecptr) REGPARAM;
 static uae_u32 chipmem_wget (uaecptr) REGPARAM;
@@ -262,7 +265,7 @@ static uae_u8 REGPARAM2 *chipmem_xlate (uaecptr addr)
 
 /* Slow memory */
 
-static uae_u8 *bogomemory;
+static MACHINE_LOCAL uae_u8 *bogomemory;
 
 static uae_u32 bogomem_lget (uaecptr) REGPARAM;
 static uae_u32 bogomem_wget (uaecptr) REGPARAM;
@@ -339,7 +342,7 @@ static uae_u8 REGPARAM2 *bogomem_xlate (uaecptr addr)
 
 /* A3000 motherboard fast memory */
 
-static uae_u8 *a3000memory;
+static MACHINE_LOCAL uae_u8 *a3000memory;
 
 static uae_u32 a3000mem_lget (uaecptr) REGPARAM;
 static uae_u32 a3000mem_wget (uaecptr) REGPARAM;
@@ -416,7 +419,7 @@ static uae_u8 REGPARAM2 *a3000mem_xlate(uaecptr addr)
 
 /* Kick memory */
 
-static uae_u8 *kickmemory;
+static MACHINE_LOCAL uae_u8 *kickmemory;
 
 static uae_u32 kickmem_lget (uaecptr) REGPARAM;
 static uae_u32 kickmem_wget (uaecptr) REGPARAM;
@@ -499,44 +502,44 @@ uae_u8 REGPARAM2 *default_xlate (uaecptr a)
 
 /* Address banks */
 
-static addrbank dummy_bank = {
+static MACHINE_LOCAL addrbank dummy_bank = {
     dummy_lget, dummy_wget, dummy_bget,
     dummy_lput, dummy_wput, dummy_bput,
     default_xlate, dummy_check
 };
 
-static addrbank mbres_bank = {
+static MACHINE_LOCAL addrbank mbres_bank = {
     mbres_lget, mbres_wget, mbres_bget,
     mbres_lput, mbres_wput, mbres_bput,
     default_xlate, mbres_check
 };
 
-addrbank chipmem_bank = {
+MACHINE_LOCAL addrbank chipmem_bank = {
     chipmem_lget, chipmem_wget, chipmem_bget,
     chipmem_lput, chipmem_wput, chipmem_bput,
     chipmem_xlate, chipmem_check
 };
 
-static addrbank bogomem_bank = {
+static MACHINE_LOCAL addrbank bogomem_bank = {
     bogomem_lget, bogomem_wget, bogomem_bget,
     bogomem_lput, bogomem_wput, bogomem_bput,
     bogomem_xlate, bogomem_check
 };
 
-static addrbank a3000mem_bank = {
+static MACHINE_LOCAL addrbank a3000mem_bank = {
     a3000mem_lget, a3000mem_wget, a3000mem_bget,
     a3000mem_lput, a3000mem_wput, a3000mem_bput,
     a3000mem_xlate, a3000mem_check
 };
 
-addrbank kickmem_bank = {
+MACHINE_LOCAL addrbank kickmem_bank = {
     kickmem_lget, kickmem_wget, kickmem_bget,
     kickmem_lput, kickmem_wput, kickmem_bput,
     kickmem_xlate, kickmem_check
 };
 
-char *address_space, *good_address_map;
-static int good_address_fd;
+MACHINE_LOCAL char *address_space, *good_address_map;
+static MACHINE_LOCAL int good_address_fd;
 
 static void init_mem_banks (void)
 {
@@ -652,6 +655,67 @@ void memory_init (void)
 
 }
 
+void memory_cleanup (void)
+{
+#ifndef USE_MAPPED_MEMORY
+    free (kickmemory);
+    free (chipmemory);
+    free (bogomemory);
+    free (a3000memory);
+    kickmemory = chipmemory = bogomemory = a3000memory = NULL;
+#endif
+}
+
+#define STATS_BANKS 9
+
+struct stats_bank {
+    addrbank *bank;
+    int region;
+};
+
+/* The banks are machine-local, so their addresses are not constants */
+static void get_stats_banks (struct stats_bank *sb)
+{
+    struct stats_bank banks[STATS_BANKS] = {
+	{&chipmem_bank, UADE_STATS_CHIP},
+	{&bogomem_bank, UADE_STATS_SLOW},
+	{&a3000mem_bank, UADE_STATS_FAST},
+	{&kickmem_bank, UADE_STATS_ROM},
+	{&custom_bank, UADE_STATS_CUSTOM},
+	{&cia_bank, UADE_STATS_CIA},
+	{&clock_bank, UADE_STATS_OTHER},
+	{&dummy_bank, UADE_STATS_OTHER},
+	{&mbres_bank, UADE_STATS_OTHER},
+    };
+    memcpy (sb, banks, sizeof banks);
+}
+
+void memory_reset_accesses (void)
+{
+    struct stats_bank sb[STATS_BANKS];
+    int i;
+    get_stats_banks (sb);
+    for (i = 0; i < STATS_BANKS; i++)
+	sb[i].bank->accesses = 0;
+}
+
+void memory_get_accesses (uint64_t *accesses)
+{
+    struct stats_bank sb[STATS_BANKS];
+    int i;
+    get_stats_banks (sb);
+    memset (accesses, 0, UADE_STATS_REGIONS * sizeof accesses[0]);
+    for (i = 0; i < STATS_BANKS; i++)
+	accesses[sb[i].region] += sb[i].bank->accesses;
+}
+
+void memory_savestate (struct savestate *ss)
+{
+    savestate_memory (ss, chipmemory, allocated_chipmem);
+    savestate_memory (ss, bogomemory, allocated_bogomem);
+    savestate_memory (ss, a3000memory, allocated_a3000mem);
+}
+
 void map_banks (addrbank *bank, int start, int size)
 {
     int bnr;
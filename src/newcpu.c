@@ -22,6 +22,8 @@
 #include "compiler.h"
 
 #include "cia.h"
+#include "savestate.h"
+#include "uadestats.h"
 
 #include "uadectl.h"
 #include <uade/uadeipc.h>
@@ -33,24 +35,24 @@ int exception_freq[0x100];
 #endif
 
 /* Opcode of faulting instruction */
-uae_u16 last_op_for_exception_3;
+MACHINE_LOCAL uae_u16 last_op_for_exception_3;
 /* PC at fault time */
-uaecptr last_addr_for_exception_3;
+MACHINE_LOCAL uaecptr last_addr_for_exception_3;
 /* Address that generated the exception */
-uaecptr last_fault_for_exception_3;
+MACHINE_LOCAL uaecptr last_fault_for_exception_3;
 
 int areg_byteinc[] = { 1,1,1,1,1,1,1,2 };
 int imm8_table[] = { 8,1,2,3,4,5,6,7 };
 
-int movem_index1[256];
-int movem_index2[256];
-int movem_next[256];
+MACHINE_LOCAL int movem_index1[256];
+MACHINE_LOCAL int movem_index2[256];
+MACHINE_LOCAL int movem_next[256];
 
-int fpp_movem_index1[256];
-int fpp_movem_index2[256];
-int fpp_movem_next[256];
+MACHINE_LOCAL int fpp_movem_index1[256];
+MACHINE_LOCAL int fpp_movem_index2[256];
+MACHINE_LOCAL int fpp_movem_next[256];
 
-cpuop_func *cpufunctbl[65536];
+MACHINE_LOCAL cpuop_func *cpufunctbl[65536];
 
 #define COUNT_INSTRS 0
 
@@ -104,7 +106,7 @@ void dump_counts (void)
 }
 #endif
 
-int broken_in;
+MACHINE_LOCAL int broken_in;
 
 static inline unsigned int cft_map (unsigned int f)
 {
@@ -160,7 +162,7 @@ static void build_cpufunctbl (void)
     }
 }
 
-unsigned long cycles_mask, cycles_val;
+MACHINE_LOCAL unsigned long cycles_mask, cycles_val;
 
 static void update_68k_cycles (void)
 {
@@ -234,11 +236,11 @@ void init_m68k (void)
     build_cpufunctbl ();
 }
 
-struct regstruct regs, lastint_regs;
-static struct regstruct regs_backup[16];
-static int backup_pointer = 0;
-static long int m68kpc_offset;
-int lastint_no;
+MACHINE_LOCAL struct regstruct regs, lastint_regs;
+static MACHINE_LOCAL struct regstruct regs_backup[16];
+static MACHINE_LOCAL int backup_pointer = 0;
+static MACHINE_LOCAL long int m68kpc_offset;
+MACHINE_LOCAL int lastint_no;
 
 #define get_ibyte_1(o) get_byte(regs.pc + (regs.pc_p - regs.pc_oldp) + (o) + 1)
 #define get_iword_1(o) get_word(regs.pc + (regs.pc_p - regs.pc_oldp) + (o))
@@ -761,7 +763,7 @@ static void Interrupt(int nr)
     regs.spcflags |= SPCFLAG_INT;
 }
 
-static int caar, cacr;
+static MACHINE_LOCAL int caar, cacr;
 
 void m68k_move2c (int regno, uae_u32 *regp)
 {
@@ -1158,9 +1160,9 @@ void mmu_op(uae_u32 opcode, uae_u16 extra)
 	op_illg (opcode);
 }
 
-static int n_insns = 0, n_spcinsns = 0;
+static MACHINE_LOCAL int n_insns = 0, n_spcinsns = 0;
 
-static uaecptr last_trace_ad = 0;
+static MACHINE_LOCAL uaecptr last_trace_ad = 0;
 
 static void do_trace (void)
 {
@@ -1200,9 +1202,20 @@ static void do_trace (void)
 
 static int do_specialties (void)
 {
+    unsigned long idle;
+
     while (regs.spcflags & SPCFLAG_STOP) {
         if (uadecore_reboot)
 	    return 1;
+	/* Only an event handler (hsync, CIA) can raise an interrupt that
+	   wakes up the CPU. If nothing is pending, jump over the idle 4 cycle
+	   steps that precede the next event. The event is still reached in
+	   the same 4 cycle step as before, so emulation stays cycle exact. */
+	if (!(regs.spcflags & (SPCFLAG_INT | SPCFLAG_DOINT))) {
+	    idle = nextevent - cycles;
+	    if (idle > 4)
+		cycles += ((idle - 1) / 4) * 4;
+	}
 	do_cycles (4);
 	if (regs.spcflags & (SPCFLAG_INT | SPCFLAG_DOINT)){
 	    int intr = intlev ();
@@ -1257,6 +1270,7 @@ void m68k_run_1 (void)
 #endif
     
     cycles = (*cpufunctbl[opcode])(opcode);
+    uadecore_stats.instructions++;
 
     if (uadecore_time_critical)
       cycles = 1;
@@ -1297,7 +1311,28 @@ void m68k_run_1 (void)
   }
 }
 
-int in_m68k_go = 0;
+void newcpu_savestate (struct savestate *ss)
+{
+    struct regstruct r;
+    uae_u32 pc = m68k_getpc ();
+
+    /* Pointers to host memory are not saved */
+    memcpy (&r, &regs, sizeof r);
+    r.pc_p = r.pc_oldp = NULL;
+
+    savestate_var (ss, r);
+    savestate_var (ss, pc);
+    savestate_var (ss, regflags);
+    savestate_var (ss, caar);
+    savestate_var (ss, cacr);
+
+    if (ss->mode == SAVESTATE_RESTORE) {
+	memcpy (&regs, &r, sizeof regs);
+	m68k_setpc (pc);
+    }
+}
+
+MACHINE_LOCAL int in_m68k_go = 0;
 
 void m68k_go (void)
 {
@@ -1311,18 +1346,26 @@ void m68k_go (void)
 
     uadecore_handle_r_state();
 
+    /* Restoring a snapshot in the receive state jumps back here */
+    (void) setjmp(savestate_jmpbuf);
+    savestate_jmpbuf_valid = 1;
+
     while (uadecore_reboot == 0 && quit_program == 0) {
       if (debugging)
 	debug ();
       if (quit_program != 0)
 	break;
       m68k_run_1 ();
+      if (savestate_requested)
+	savestate_try_send ();
     }
 
+    savestate_jmpbuf_valid = 0;
+
     if (uadecore_reboot) {
-      if (uade_send_short_message(UADE_COMMAND_TOKEN, &uadecore_ipc) < 0) {
+      if (uadecore_send_short_message(UADE_COMMAND_TOKEN) < 0) {
 	fprintf(stderr, "can not send reboot ack token\n");
-	exit(1);
+	uadecore_exit(1);
       }
     }
   }
@@ -0,0 +1,102 @@
+/*
+ * Paula trace collects channel outputs and audio register writes into
+ * UADE_REPLY_TRACE messages for libuade. The messages are sent just before
+ * the sample data that they describe. See uade_set_trace() in uade.h.
+ */
+
+#include "sysconfig.h"
+#include "sysdeps.h"
+
+#include "paula_trace.h"
+#include "uadectl.h"
+#include "uadestats.h"
+
+#include <uade/uade.h>
+#include <uade/uadeipc.h>
+#include <uade/uadeutils.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_BUFFER_SIZE (UADE_MAX_MESSAGE_SIZE - sizeof(struct uade_msg))
+
+MACHINE_LOCAL unsigned int paula_trace_flags;
+
+static MACHINE_LOCAL unsigned int decimation;
+static MACHINE_LOCAL unsigned int decimation_count;
+static MACHINE_LOCAL uint32_t frame;
+
+static MACHINE_LOCAL size_t bufused;
+static MACHINE_LOCAL uint8_t buf[TRACE_BUFFER_SIZE];
+
+void paula_trace_set(unsigned int flags, unsigned int new_decimation)
+{
+	paula_trace_flags = flags;
+	decimation = new_decimation > 0 ? new_decimation : 1;
+	decimation_count = 0;
+	frame = 0;
+	bufused = 0;
+}
+
+void paula_trace_flush(void)
+{
+	uint8_t space[UADE_MAX_MESSAGE_SIZE];
+	struct uade_msg *um = (struct uade_msg *) space;
+
+	if (bufused == 0)
+		return;
+
+	um->msgtype = UADE_REPLY_TRACE;
+	um->size = bufused;
+	memcpy(um->data, buf, bufused);
+	bufused = 0;
+	if (uadecore_send_message(um)) {
+		fprintf(stderr, "uadecore: Could not send trace data.\n");
+		uadecore_exit(1);
+	}
+}
+
+static uint8_t *reserve(size_t size, int type)
+{
+	uint8_t *p;
+	if ((bufused + size) > TRACE_BUFFER_SIZE)
+		paula_trace_flush();
+	p = buf + bufused;
+	bufused += size;
+	p[0] = type;
+	write_be_u32(p + 1, frame);
+	return p + 5;
+}
+
+/* Called for each frame of audio output */
+void paula_trace_output(const int output[4])
+{
+	uint8_t *p;
+	int i;
+
+	if ((paula_trace_flags & UADE_TRACE_OUTPUTS) && decimation_count == 0) {
+		p = reserve(UADE_TRACE_OUTPUT_WIRE_SIZE,
+			    UADE_TRACE_RECORD_OUTPUT);
+		for (i = 0; i < 4; i++)
+			write_be_u16(p + 2 * i, (uint16_t) output[i]);
+	}
+
+	decimation_count++;
+	if (decimation_count == decimation)
+		decimation_count = 0;
+	frame++;
+}
+
+void paula_trace_event(int channel, enum PaulaEventType event_type,
+		       uint16_t value)
+{
+	uint8_t *p;
+
+	if (!(paula_trace_flags & UADE_TRACE_EVENTS) || uadecore_reboot)
+		return;
+
+	p = reserve(UADE_TRACE_EVENT_WIRE_SIZE, UADE_TRACE_RECORD_EVENT);
+	p[0] = (channel << 4) | event_type;
+	write_be_u16(p + 1, value);
+}
@@ -13,7 +13,7 @@
 #include "options.h"
 #include "readcpu.h"
 
-int nr_cpuop_funcs;
+MACHINE_LOCAL int nr_cpuop_funcs;
 
 struct mnemolookup lookuptab[] = {
     { i_ILLG, "ILLEGAL" },
@@ -133,7 +133,7 @@ struct mnemolookup lookuptab[] = {
     { i_ILLG, "" },
 };
 
-struct instr *table68k;
+MACHINE_LOCAL struct instr *table68k;
 
 static inline amodes mode_from_str (const char *str)
 {
@@ -712,7 +712,7 @@ void read_table68k (void)
     }
 }
 
-static int mismatch;
+static MACHINE_LOCAL int mismatch;
 
 static void handle_merges (long int opcode)
 {
@@ -0,0 +1,415 @@
+/*
+ * Snapshots of the emulator state for UADE_COMMAND_SNAPSHOT and
+ * UADE_COMMAND_RESTORE. See uade_request_snapshot() in uade.h.
+ *
+ * A snapshot is taken at an instruction boundary in m68k_go() when the
+ * sound buffer is empty. Restoring a snapshot in the receive state jumps
+ * back to that boundary, so the emulation continues exactly as it did
+ * after the snapshot was taken.
+ *
+ * Snapshot format (integers are bigendian):
+ *
+ *   8 bytes "UADESNAP", u32 version, u32 layout, u32 flags,
+ *   u32 payload size before compression, payload
+ *
+ * Layout is a hash of the sizes of saved variables. A snapshot is only
+ * restored by a uadecore that has the same layout.
+ */
+
+#include "sysconfig.h"
+#include "sysdeps.h"
+
+#include "options.h"
+#include "memory.h"
+#include "custom.h"
+#include "readcpu.h"
+#include "newcpu.h"
+#include "sd-sound.h"
+#include "paula_trace.h"
+#include "savestate.h"
+#include "uadectl.h"
+#include "uadestats.h"
+
+#include <uade/uadeipc.h>
+#include <uade/uadeutils.h>
+#include <uade/sysincludes.h>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#define SNAPSHOT_MAGIC "UADESNAP"
+#define SNAPSHOT_HEADER_SIZE 24
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_ZLIB 1
+#define SNAPSHOT_MAX_SIZE (64 << 20)
+#define SNAPSHOT_PAGE_SIZE 4096
+#define SNAPSHOT_LAST_PAGE 0xffffffff
+
+#define CHUNK_SIZE (UADE_MAX_MESSAGE_SIZE - sizeof(struct uade_msg))
+
+MACHINE_LOCAL int savestate_requested;
+MACHINE_LOCAL jmp_buf savestate_jmpbuf;
+MACHINE_LOCAL int savestate_jmpbuf_valid;
+
+static MACHINE_LOCAL uint8_t *restorebuf;
+static MACHINE_LOCAL size_t restoresize;
+static MACHINE_LOCAL int restoreoverflow;
+static MACHINE_LOCAL int restorepending;
+
+static void mix_layout(struct savestate *ss, uint32_t x)
+{
+	int i;
+	/* FNV-1a */
+	for (i = 0; i < 4; i++) {
+		ss->layout ^= (x >> (8 * i)) & 0xff;
+		ss->layout *= 16777619;
+	}
+}
+
+static uint8_t *reserve(struct savestate *ss, size_t size)
+{
+	uint8_t *p;
+	if (ss->allocated - ss->pos < size) {
+		size_t newsize = ss->allocated ? ss->allocated : 65536;
+		while (newsize - ss->pos < size)
+			newsize *= 2;
+		ss->buf = realloc(ss->buf, newsize);
+		if (ss->buf == NULL) {
+			fprintf(stderr, "uadecore: No memory for snapshot\n");
+			uadecore_exit(1);
+		}
+		ss->allocated = newsize;
+	}
+	p = ss->buf + ss->pos;
+	ss->pos += size;
+	ss->size = ss->pos;
+	return p;
+}
+
+static int copy_bytes(struct savestate *ss, void *data, size_t size)
+{
+	if (ss->error)
+		return -1;
+	if (ss->mode == SAVESTATE_SAVE) {
+		memcpy(reserve(ss, size), data, size);
+		return 0;
+	}
+	if (ss->size - ss->pos < size) {
+		ss->error = 1;
+		return -1;
+	}
+	if (ss->mode == SAVESTATE_RESTORE)
+		memcpy(data, ss->buf + ss->pos, size);
+	ss->pos += size;
+	return 0;
+}
+
+void savestate_data(struct savestate *ss, void *data, size_t size)
+{
+	mix_layout(ss, size);
+	copy_bytes(ss, data, size);
+}
+
+static int is_zero(const uint8_t *p, size_t size)
+{
+	size_t i;
+	for (i = 0; i < size; i++) {
+		if (p[i])
+			return 0;
+	}
+	return 1;
+}
+
+void savestate_memory(struct savestate *ss, uint8_t *mem, size_t size)
+{
+	uint32_t npages = (size + SNAPSHOT_PAGE_SIZE - 1) / SNAPSHOT_PAGE_SIZE;
+	uint32_t page;
+	uint32_t lastpage = 0;
+	uint8_t index[4];
+	size_t len;
+
+	mix_layout(ss, size);
+
+	if (ss->mode == SAVESTATE_SAVE) {
+		for (page = 0; page < npages; page++) {
+			len = size - page * SNAPSHOT_PAGE_SIZE;
+			if (len > SNAPSHOT_PAGE_SIZE)
+				len = SNAPSHOT_PAGE_SIZE;
+			if (is_zero(mem + page * SNAPSHOT_PAGE_SIZE, len))
+				continue;
+			write_be_u32(index, page);
+			copy_bytes(ss, index, sizeof index);
+			copy_bytes(ss, mem + page * SNAPSHOT_PAGE_SIZE, len);
+		}
+		write_be_u32(index, SNAPSHOT_LAST_PAGE);
+		copy_bytes(ss, index, sizeof index);
+		return;
+	}
+
+	if (ss->mode == SAVESTATE_RESTORE && size > 0)
+		memset(mem, 0, size);
+
+	while (1) {
+		if (ss->size - ss->pos < sizeof index) {
+			ss->error = 1;
+			return;
+		}
+		page = read_be_u32(ss->buf + ss->pos);
+		ss->pos += sizeof index;
+		if (page == SNAPSHOT_LAST_PAGE)
+			break;
+		/* Pages must be in increasing order */
+		if (page >= npages || (lastpage > 0 && page < lastpage)) {
+			ss->error = 1;
+			return;
+		}
+		lastpage = page + 1;
+		len = size - page * SNAPSHOT_PAGE_SIZE;
+		if (len > SNAPSHOT_PAGE_SIZE)
+			len = SNAPSHOT_PAGE_SIZE;
+		if (copy_bytes(ss, mem + page * SNAPSHOT_PAGE_SIZE, len))
+			return;
+	}
+}
+
+static void run_modules(struct savestate *ss)
+{
+	uint32_t bigendian = (htonl(1) == 1);
+	ss->layout = 2166136261U;
+	mix_layout(ss, bigendian);
+	newcpu_savestate(ss);
+	custom_savestate(ss);
+	cia_savestate(ss);
+	audio_savestate(ss);
+	memory_savestate(ss);
+	uadecore_savestate(ss);
+}
+
+static void send_snapshot(const uint8_t *data, size_t size)
+{
+	uint8_t space[UADE_MAX_MESSAGE_SIZE];
+	struct uade_msg *um = (struct uade_msg *) space;
+	size_t pos;
+	size_t len;
+
+	for (pos = 0; pos < size; pos += len) {
+		len = size - pos;
+		if (len > CHUNK_SIZE)
+			len = CHUNK_SIZE;
+		um->msgtype = UADE_REPLY_SNAPSHOT;
+		um->size = len;
+		memcpy(um->data, data + pos, len);
+		if (uadecore_send_message(um)) {
+			fprintf(stderr, "uadecore: Could not send snapshot.\n");
+			uadecore_exit(1);
+		}
+	}
+	/* An empty message ends the snapshot */
+	if (uadecore_send_short_message(UADE_REPLY_SNAPSHOT)) {
+		fprintf(stderr, "uadecore: Could not send snapshot.\n");
+		uadecore_exit(1);
+	}
+}
+
+void savestate_reset(void)
+{
+	savestate_requested = 0;
+	free(restorebuf);
+	restorebuf = NULL;
+	restoresize = 0;
+	restoreoverflow = 0;
+	restorepending = 0;
+}
+
+void savestate_request(void)
+{
+	savestate_requested = 1;
+	/* Leave m68k_run_1() after the current instruction */
+	regs.spcflags |= SPCFLAG_BRK;
+}
+
+/* Called from m68k_go() at an instruction boundary */
+void savestate_try_send(void)
+{
+	struct savestate ss = {.mode = SAVESTATE_SAVE};
+	uint8_t *blob;
+	size_t blobsize;
+	uint32_t flags = 0;
+
+	if (uadecore_reboot) {
+		savestate_requested = 0;
+		return;
+	}
+
+	/*
+	 * Samples in the sound buffer have been generated but not sent.
+	 * Try again after the next instruction.
+	 */
+	if (sndbufpt != sndbuffer) {
+		regs.spcflags |= SPCFLAG_BRK;
+		return;
+	}
+	savestate_requested = 0;
+
+	/* Trace records of the sent samples must arrive before the snapshot */
+	paula_trace_flush();
+
+	run_modules(&ss);
+	assert(!ss.error);
+
+	blobsize = SNAPSHOT_HEADER_SIZE + ss.size;
+	blob = malloc(blobsize);
+	if (blob == NULL) {
+		fprintf(stderr, "uadecore: No memory for snapshot\n");
+		uadecore_exit(1);
+	}
+	memcpy(blob + SNAPSHOT_HEADER_SIZE, ss.buf, ss.size);
+
+#ifdef HAVE_ZLIB
+	{
+		uLongf zsize = compressBound(ss.size);
+		uint8_t *zblob = malloc(SNAPSHOT_HEADER_SIZE + zsize);
+		if (zblob != NULL &&
+		    compress2(zblob + SNAPSHOT_HEADER_SIZE, &zsize, ss.buf,
+			      ss.size, 6) == Z_OK &&
+		    zsize < ss.size) {
+			free(blob);
+			blob = zblob;
+			blobsize = SNAPSHOT_HEADER_SIZE + zsize;
+			flags |= SNAPSHOT_ZLIB;
+		} else {
+			free(zblob);
+		}
+	}
+#endif
+
+	memcpy(blob, SNAPSHOT_MAGIC, 8);
+	write_be_u32(blob + 8, SNAPSHOT_VERSION);
+	write_be_u32(blob + 12, ss.layout);
+	write_be_u32(blob + 16, flags);
+	write_be_u32(blob + 20, ss.size);
+
+	send_snapshot(blob, blobsize);
+
+	free(blob);
+	free(ss.buf);
+}
+
+void savestate_receive_chunk(const struct uade_msg *um)
+{
+	uint8_t *newbuf;
+
+	if (um->size == 0) {
+		restorepending = 1;
+		return;
+	}
+	if (restoreoverflow || restoresize + um->size > SNAPSHOT_MAX_SIZE) {
+		restoreoverflow = 1;
+		return;
+	}
+	newbuf = realloc(restorebuf, restoresize + um->size);
+	if (newbuf == NULL) {
+		restoreoverflow = 1;
+		return;
+	}
+	restorebuf = newbuf;
+	memcpy(restorebuf + restoresize, um->data, um->size);
+	restoresize += um->size;
+}
+
+/* Returns 0 if the snapshot was restored. The state is not changed on error. */
+static int restore(uint8_t *blob, size_t blobsize)
+{
+	struct savestate ss = {.mode = SAVESTATE_CHECK};
+	uint32_t layout;
+	uint32_t flags;
+	uint32_t rawsize;
+	uint8_t *raw = NULL;
+	int songend;
+
+	if (blobsize < SNAPSHOT_HEADER_SIZE ||
+	    memcmp(blob, SNAPSHOT_MAGIC, 8) != 0 ||
+	    read_be_u32(blob + 8) != SNAPSHOT_VERSION)
+		return -1;
+	layout = read_be_u32(blob + 12);
+	flags = read_be_u32(blob + 16);
+	rawsize = read_be_u32(blob + 20);
+	if (rawsize > SNAPSHOT_MAX_SIZE)
+		return -1;
+
+	if (flags & SNAPSHOT_ZLIB) {
+#ifdef HAVE_ZLIB
+		uLongf destsize = rawsize;
+		raw = malloc(rawsize > 0 ? rawsize : 1);
+		if (raw == NULL ||
+		    uncompress(raw, &destsize, blob + SNAPSHOT_HEADER_SIZE,
+			       blobsize - SNAPSHOT_HEADER_SIZE) != Z_OK ||
+		    destsize != rawsize) {
+			free(raw);
+			return -1;
+		}
+		ss.buf = raw;
+#else
+		uadecore_send_debug("Snapshot is compressed, but zlib is not supported");
+		return -1;
+#endif
+	} else {
+		if (blobsize - SNAPSHOT_HEADER_SIZE != rawsize)
+			return -1;
+		ss.buf = blob + SNAPSHOT_HEADER_SIZE;
+	}
+	ss.size = rawsize;
+
+	run_modules(&ss);
+	if (ss.error || ss.pos != ss.size || ss.layout != layout) {
+		free(raw);
+		return -1;
+	}
+
+	/* Song end detection is a setting of the restoring client */
+	songend = uadecore_get_automatic_song_end();
+
+	ss.mode = SAVESTATE_RESTORE;
+	ss.pos = 0;
+	run_modules(&ss);
+	assert(!ss.error);
+
+	uadecore_set_automatic_song_end(songend);
+
+	free(raw);
+	return 0;
+}
+
+/* Called at the end of the receive state */
+void savestate_restore_pending(void)
+{
+	int ret = -1;
+
+	if (!restorepending)
+		return;
+
+	uadecore_stats_sync_cycles();
+	if (!restoreoverflow)
+		ret = restore(restorebuf, restoresize);
+	uadecore_stats_resync_cycles();
+	free(restorebuf);
+	restorebuf = NULL;
+	restoresize = 0;
+	restoreoverflow = 0;
+	restorepending = 0;
+
+	if (uadecore_send_u32(UADE_REPLY_RESTORE, ret == 0)) {
+		fprintf(stderr, "uadecore: Could not send restore status.\n");
+		uadecore_exit(1);
+	}
+
+	/* The emulator continues from the instruction boundary of the snapshot */
+	if (ret == 0 && savestate_jmpbuf_valid)
+		longjmp(savestate_jmpbuf, 1);
+}
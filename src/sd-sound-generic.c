@@ -18,11 +18,13 @@
 #include "uadectl.h"
 #include <uade/uadeconstants.h>
 
-uae_u16 sndbuffer[MAX_SOUND_BUF_SIZE / 2];
-uae_u16 *sndbufpt;
-int sndbufsize;
+MACHINE_LOCAL uae_u16 sndbuffer[MAX_SOUND_BUF_SIZE / 2];
+MACHINE_LOCAL uae_u16 *sndbufpt;
+MACHINE_LOCAL uae_u16 *sndbuffilterpt;
+MACHINE_LOCAL uae_u16 stembuffer[MAX_SOUND_BUF_SIZE];
+MACHINE_LOCAL int sndbufsize;
 
-int sound_bytes_per_second;
+MACHINE_LOCAL int sound_bytes_per_second;
 
 void close_sound (void)
 {
@@ -62,15 +64,15 @@ void init_sound (void)
 
   if (dspbits != 16) {
     fprintf(stderr, "Only 16 bit sounds supported.\n");
-    exit(1);
+    uadecore_exit(1);
   }
   if (rate < 1 || rate > SOUNDTICKS_NTSC) {
     fprintf(stderr, "Too small or high a rate: %u\n", rate);
-    exit(1);
+    uadecore_exit(1);
   }
   if (channels != 2) {
     fprintf(stderr, "Only stereo supported.\n");
-    exit(1);
+    uadecore_exit(1);
   }
 
   sound_bytes_per_second = (dspbits / 8) *  channels * rate;
@@ -80,10 +82,14 @@ void init_sound (void)
   sound_available = 1;
   
   sndbufpt = sndbuffer;
+  sndbuffilterpt = sndbuffer;
 }
 
 /* this should be called between subsongs when remote slave changes subsong */
 void flush_sound (void)
 {
+  /* Discarded frames are filtered to keep the filter state continuous */
+  audio_filter_sound_buffer();
   sndbufpt = sndbuffer;
+  sndbuffilterpt = sndbuffer;
 }
@@ -13,10 +13,14 @@
 
 #define MAX_SOUND_BUF_SIZE (65536)
 
-extern uae_u16 sndbuffer[];
-extern uae_u16 *sndbufpt;
-extern int sndbufsize;
-extern int sound_bytes_per_second;
+extern MACHINE_LOCAL uae_u16 sndbuffer[];
+extern MACHINE_LOCAL uae_u16 *sndbufpt;
+/* Frames from here to sndbufpt are not filtered yet */
+extern MACHINE_LOCAL uae_u16 *sndbuffilterpt;
+/* Per-channel outputs of the frames in sndbuffer, see audio_use_stems() */
+extern MACHINE_LOCAL uae_u16 stembuffer[];
+extern MACHINE_LOCAL int sndbufsize;
+extern MACHINE_LOCAL int sound_bytes_per_second;
 
 extern void finish_sound_buffer (void);
 
@@ -29,9 +29,13 @@
 #include "cia.h"
 #include "sd-sound.h"
 #include "audio.h"
+#include "paula_trace.h"
+#include "savestate.h"
+#include "uadestats.h"
 
 #include "uadectl.h"
 #include "amigamsg.h"
+#include "machine.h"
 
 #include <uade/uade.h>
 #include <uade/ossupport.h>
@@ -84,31 +88,31 @@ static const int SCORE_CUR_SUBSONG   = 0x20C;
 static const int SCORE_OUTPUT_MSG    = 0x300;
 
 
-struct uade_ipc uadecore_ipc;
+MACHINE_LOCAL struct uade_ipc uadecore_ipc;
 
-int uadecore_audio_skip;
-int uadecore_audio_output;
-int uadecore_debug;
-int uadecore_read_size;
-int uadecore_reboot;
-int uadecore_time_critical;
+MACHINE_LOCAL int uadecore_audio_skip;
+MACHINE_LOCAL int uadecore_audio_output;
+MACHINE_LOCAL int uadecore_debug;
+MACHINE_LOCAL int uadecore_read_size;
+MACHINE_LOCAL int uadecore_reboot;
+MACHINE_LOCAL int uadecore_time_critical;
 
 
-static int disable_modulechange;
-static int old_ledstate;
-static int big_endian;
-static int dmawait;
-static int execdebug;
-static int highmem;
-static struct uade_song song;
-static int speed_hack;
-static int voltestboolean;
+static MACHINE_LOCAL int disable_modulechange;
+static MACHINE_LOCAL int old_ledstate;
+static MACHINE_LOCAL int big_endian;
+static MACHINE_LOCAL int dmawait;
+static MACHINE_LOCAL int execdebug;
+static MACHINE_LOCAL int highmem;
+static MACHINE_LOCAL struct uade_song song;
+static MACHINE_LOCAL int speed_hack;
+static MACHINE_LOCAL int voltestboolean;
 
-static char epoptions[256];
-static size_t epoptionsize;
+static MACHINE_LOCAL char epoptions[256];
+static MACHINE_LOCAL size_t epoptionsize;
 
-static struct uade_file *cachedfile;
-static char cachedfilename[PATH_MAX];
+static MACHINE_LOCAL struct uade_file *cachedfile;
+static MACHINE_LOCAL char cachedfilename[PATH_MAX];
 
 static void add_ep_option(const char *s)
 {
@@ -226,28 +230,63 @@ void uadecore_check_sound_buffers(int bytes)
     uadecore_send_debug("LED is %s", gui_ledstate ? "ON" : "OFF");
   }
 
+  /* trace records must arrive before the sample data they describe */
+  paula_trace_flush();
+
+  if (uadecore_stats_requested)
+    uadecore_stats_send();
+
   um->msgtype = UADE_REPLY_DATA;
   um->size = bytes;
   memcpy(um->data, sndbuffer, bytes);
-  if (uade_send_message(um, &uadecore_ipc)) {
+  if (uadecore_send_message(um)) {
     fprintf(stderr, "uadecore: Could not send sample data.\n");
-    exit(1);
+    uadecore_exit(1);
   }
 
+  uadecore_stats.audio_frames += bytes / 4;
+
   uadecore_read_size -= bytes;
   assert(uadecore_read_size >= 0);
 
   if (uadecore_read_size == 0) {
     /* if all requested data has been sent, move to S state */
-    if (uade_send_short_message(UADE_COMMAND_TOKEN, &uadecore_ipc)) {
+    if (uadecore_send_short_message(UADE_COMMAND_TOKEN)) {
       fprintf(stderr, "uadecore: Could not send token (after samples).\n");
-      exit(1);
+      uadecore_exit(1);
     }
     uadecore_handle_r_state();
   }
 }
 
 
+/* Sends per-channel outputs of the frames that the next UADE_REPLY_DATA
+   message contains. Each frame has 4 samples. */
+void uadecore_send_stems(uint16_t *stems, int frames)
+{
+  uint8_t space[UADE_MAX_MESSAGE_SIZE];
+  struct uade_msg *um = (struct uade_msg *) space;
+  int bytes = frames * 8;
+  int chunk;
+
+  if (big_endian == 0)
+    uadecore_swap_buffer_bytes(stems, bytes);
+
+  while (bytes > 0) {
+    chunk = bytes < 4096 ? bytes : 4096;
+    um->msgtype = UADE_REPLY_STEMS;
+    um->size = chunk;
+    memcpy(um->data, stems, chunk);
+    if (uadecore_send_message(um)) {
+      fprintf(stderr, "uadecore: Could not send stem data.\n");
+      uadecore_exit(1);
+    }
+    stems += chunk / 2;
+    bytes -= chunk;
+  }
+}
+
+
 /* Send debug messages back to uade frontend, which either prints
    the message for user or not. "-v" option can be used in uade123 to see all
    these messages. */
@@ -257,7 +296,7 @@ void uadecore_send_debug(const char *fmt, ...)
   va_list ap;
   va_start (ap, fmt);
   vsnprintf(dmsg, sizeof(dmsg), fmt, ap);
-  if (uade_send_string(UADE_REPLY_MSG, dmsg, &uadecore_ipc)) {
+  if (uadecore_send_string(UADE_REPLY_MSG, dmsg)) {
     fprintf(stderr, "uadecore %s:%d: Could not send debug message.\n", __FILE__, __LINE__);
   }
 }
@@ -282,6 +321,14 @@ static void invalidate_amiga_file_cache(void)
 	cachedfilename[0] = 0;
 }
 
+/* Frees what the machine has allocated for songs */
+void uadecore_cleanup(void)
+{
+  invalidate_amiga_file_cache();
+  savestate_reset();
+  audio_cleanup();
+}
+
 static struct uade_file *lookup_amiga_file_cache(const char *filename)
 {
 	struct uade_file *f;
@@ -349,25 +396,25 @@ void uadecore_get_amiga_message(void)
 		u32ptr[0] = htonl(mins);
 		u32ptr[1] = htonl(maxs);
 		u32ptr[2] = htonl(curs);
-		if (uade_send_message(um, &uadecore_ipc)) {
+		if (uadecore_send_message(um)) {
 			fprintf(stderr, "uadecore: Could not send subsong info message.\n");
-			exit(1);
+			uadecore_exit(1);
 		}
 		break;
 
 	case AMIGAMSG_PLAYERNAME:
 		strlcpy(tmpstr, (char *) get_real_address(0x204), sizeof tmpstr);
-		uade_send_string(UADE_REPLY_PLAYERNAME, tmpstr, &uadecore_ipc);
+		uadecore_send_string(UADE_REPLY_PLAYERNAME, tmpstr);
 		break;
 
 	case AMIGAMSG_MODULENAME:
 	strlcpy(tmpstr, (char *) get_real_address(0x204), sizeof tmpstr);
-		uade_send_string(UADE_REPLY_MODULENAME, tmpstr, &uadecore_ipc);
+		uadecore_send_string(UADE_REPLY_MODULENAME, tmpstr);
 		break;
 
 	case AMIGAMSG_FORMATNAME:
 		strlcpy(tmpstr, (char *) get_real_address(0x204), sizeof tmpstr);
-		uade_send_string(UADE_REPLY_FORMATNAME, tmpstr, &uadecore_ipc);
+		uadecore_send_string(UADE_REPLY_FORMATNAME, tmpstr);
 		break;
 
 	case AMIGAMSG_GENERALMSG:
@@ -411,7 +458,7 @@ void uadecore_get_amiga_message(void)
 		f = lookup_amiga_file_cache(nameptr);
 		if (f == NULL) {
 			uadecore_send_debug("load: request error: %s", nameptr);
-			exit(1);
+			uadecore_exit(1);
 		}
 		if (f->data == NULL) {
 			/* File not found */
@@ -437,7 +484,7 @@ void uadecore_get_amiga_message(void)
 		f = lookup_amiga_file_cache(nameptr);
 		if (f == NULL) {
 			uadecore_send_debug("read: request error: %s", nameptr);
-			exit(1);
+			uadecore_exit(1);
 		}
 
 		x = 0;
@@ -474,7 +521,7 @@ void uadecore_get_amiga_message(void)
 		f = lookup_amiga_file_cache(nameptr);
 		if (f == NULL) {
 			uadecore_send_debug("filesize: request error: %s", nameptr);
-			exit(1);
+			uadecore_exit(1);
 		}
 		len = 0;
 		x = 0;
@@ -567,6 +614,7 @@ void uadecore_handle_r_state(void)
   struct uade_msg *um = (struct uade_msg *) space;
   int ret;
   uint32_t x, y;
+  uint64_t t = uadecore_stats_ns();
 
   while (1) {
 
@@ -576,14 +624,21 @@ void uadecore_handle_r_state(void)
        * Terminate uadecore when libuade closes the control socket.
        * This is the usual (intended) place where uadecore terminates itself.
        */
-      exit(0);
+      uadecore_exit(0);
     } else if (ret < 0) {
       fprintf(stderr, "uadecore: Error on input. Exiting with error.\n");
-      exit(1);
+      uadecore_exit(1);
     }
 
-    if (um->msgtype == UADE_COMMAND_TOKEN)
+    uadecore_stats.ipc_messages_received++;
+    uadecore_stats.ipc_bytes_received += sizeof(*um) + um->size;
+
+    if (um->msgtype == UADE_COMMAND_TOKEN) {
+      uadecore_stats.ipc_ns += uadecore_stats_ns() - t;
+      /* Does not return if a snapshot is restored during emulation */
+      savestate_restore_pending();
       break;
+    }
 
     switch (um->msgtype) {
 
@@ -596,7 +651,7 @@ void uadecore_handle_r_state(void)
     case UADE_COMMAND_CHANGE_SUBSONG:
       if (uade_parse_u32_message(&x, um)) {
 	fprintf(stderr, "uadecore: Invalid size with change subsong.\n");
-	exit(1);
+	uadecore_exit(1);
       }
       change_subsong(x);
       break;
@@ -604,7 +659,7 @@ void uadecore_handle_r_state(void)
     case UADE_COMMAND_FILTER:
       if (uade_parse_two_u32s_message(&x, &y, um)) {
 	fprintf(stderr, "uadecore: Invalid size with filter command\n");
-	exit(1);
+	uadecore_exit(1);
       }
       audio_set_filter(x, y);
       break;
@@ -617,7 +672,7 @@ void uadecore_handle_r_state(void)
     case UADE_COMMAND_SET_FREQUENCY:
       if (uade_parse_u32_message(&x, um)) {
 	fprintf(stderr, "Invalid frequency message size: %u\n", um->size);
-	exit(1);
+	uadecore_exit(1);
       }
       set_sound_freq(x);
       break;
@@ -638,6 +693,22 @@ void uadecore_handle_r_state(void)
       audio_set_write_audio_fname((char *) um->data);
       break;
 
+    case UADE_COMMAND_SET_TRACE:
+      if (uade_parse_two_u32s_message(&x, &y, um)) {
+	fprintf(stderr, "uadecore: Invalid size with trace command\n");
+	uadecore_exit(1);
+      }
+      paula_trace_set(x, y);
+      break;
+
+    case UADE_COMMAND_SNAPSHOT:
+      savestate_request();
+      break;
+
+    case UADE_COMMAND_GET_STATS:
+      uadecore_stats_requested = 1;
+      break;
+
     case UADE_COMMAND_SPEED_HACK:
       uadecore_time_critical = 1;
       break;
@@ -645,19 +716,23 @@ void uadecore_handle_r_state(void)
     case UADE_COMMAND_READ:
       if (uadecore_read_size != 0) {
 	fprintf(stderr, "uadecore: Read not allowed when uadecore_read_size > 0.\n");
-	exit(1);
+	uadecore_exit(1);
       }
       if (uade_parse_u32_message(&x, um)) {
 	fprintf(stderr, "uadecore: Invalid size on read command.\n");
-	exit(1);
+	uadecore_exit(1);
       }
       uadecore_read_size = x;
       if (uadecore_read_size == 0 || uadecore_read_size > MAX_SOUND_BUF_SIZE || (uadecore_read_size & 3) != 0) {
 	fprintf(stderr, "uadecore: Invalid read size: %d\n", uadecore_read_size);
-	exit(1);
+	uadecore_exit(1);
       }
       break;
 
+    case UADE_COMMAND_RESTORE:
+      savestate_receive_chunk(um);
+      break;
+
     case UADE_COMMAND_REBOOT:
       uadecore_reboot = 1;
       break;
@@ -674,19 +749,23 @@ void uadecore_handle_r_state(void)
     case UADE_COMMAND_SET_SUBSONG:
       if (uade_parse_u32_message(&x, um)) {
 	fprintf(stderr, "uadecore: Invalid size on set subsong command.\n");
-	exit(1);
+	uadecore_exit(1);
       }
       uade_put_long(SCORE_SET_SUBSONG, 1);
       uade_put_long(SCORE_SUBSONG, x);
       break;
 
+    case UADE_COMMAND_USE_STEMS:
+      audio_use_stems();
+      break;
+
     case UADE_COMMAND_USE_TEXT_SCOPE:
       audio_use_text_scope();
       break;
 
     default:
       fprintf(stderr, "uadecore: Received invalid command %d\n", um->msgtype);
-      exit(1);
+      uadecore_exit(1);
     }
   }
 }
@@ -702,6 +781,7 @@ void uadecore_option(int argc, char **argv)
   int ret;
   int in_fd = -1;
   int out_fd = -1;
+  int host_fd;
   char *endptr;
 
   /* network byte order is the big endian order */
@@ -714,7 +794,7 @@ void uadecore_option(int argc, char **argv)
   s_argv = malloc(sizeof(argv[0]) * (argc + 1));
   if (!s_argv) {
     fprintf (stderr, "uadecore: Out of memory for command line parsing.\n");
-    exit(1);
+    uadecore_exit(1);
   }
   s_argc = 0;
   s_argv[s_argc++] = argv[0];
@@ -730,19 +810,19 @@ void uadecore_option(int argc, char **argv)
 
       if (!strcmp(argv[i], "--help") || !strcmp(argv[i], "-h") || !strcmp(argv[i], "-help")) {
 	uade_print_help(OPTION_HELP, argv[0]);
-	exit(0);
+	uadecore_exit(0);
 
       } else if (!strcmp(argv[i], "-i")) {
 	if ((i + 1) >= argc) {
 	  fprintf(stderr, "uadecore: %s parameter missing\n", argv[i]);
 	  uade_print_help(OPTION_ILLEGAL_PARAMETERS, argv[0]);
-	  exit(1);
+	  uadecore_exit(1);
 	}
 	in_fd = strtol(argv[i + 1], &endptr, 10);
 	if (in_fd < 0 || *endptr != 0) {
 		fprintf(stderr, "uadecore: Invalid -i parameter: %s\n",
 			argv[i + 1]);
-		exit(1);
+		uadecore_exit(1);
 	}
 	i += 2;
 
@@ -750,16 +830,30 @@ void uadecore_option(int argc, char **argv)
 	if ((i + 1) >= argc) {
 	  fprintf(stderr, "uadecore: %s parameter missing\n", argv[i]);
 	  uade_print_help(OPTION_ILLEGAL_PARAMETERS, argv[0]);
-	  exit(1);
+	  uadecore_exit(1);
 	}
 	out_fd = strtol(argv[i + 1], &endptr, 10);
 	if (out_fd < 0 || *endptr != 0) {
 		fprintf(stderr, "uadecore: Invalid -o parameter: %s\n",
 			argv[i + 1]);
-		exit(1);
+		uadecore_exit(1);
 	}
 	i += 2;
 
+      } else if (!strcmp(argv[i], "-m")) {
+	if ((i + 1) >= argc) {
+	  fprintf(stderr, "uadecore: %s parameter missing\n", argv[i]);
+	  uade_print_help(OPTION_ILLEGAL_PARAMETERS, argv[0]);
+	  uadecore_exit(1);
+	}
+	host_fd = strtol(argv[i + 1], &endptr, 10);
+	if (host_fd < 0 || *endptr != 0) {
+		fprintf(stderr, "uadecore: Invalid -m parameter: %s\n",
+			argv[i + 1]);
+		uadecore_exit(1);
+	}
+	uadecore_exit(amiga_machine_host(host_fd));
+
       } else if (!strcmp(argv[i], "--")) {
 	for (i = i + 1; i < argc ; i++)
 	  s_argv[s_argc++] = argv[i];
@@ -776,7 +870,7 @@ void uadecore_option(int argc, char **argv)
 
   if (in_fd < 0 || out_fd < 0) {
 	  fprintf(stderr, "uadecore: Must have -i and -o parameters\n");
-	  exit(1);
+	  uadecore_exit(1);
   }
 
   uade_set_peer(&uadecore_ipc, 0, in_fd, out_fd);
@@ -784,10 +878,10 @@ void uadecore_option(int argc, char **argv)
   ret = uade_receive_string(optionsfile, UADE_COMMAND_CONFIG, sizeof(optionsfile), &uadecore_ipc);
   if (ret == 0) {
     fprintf(stderr, "uadecore: No config file passed as a message.\n");
-    exit(1);
+    uadecore_exit(1);
   } else if (ret < 0) {
     fprintf(stderr, "uadecore: Invalid input. Expected a config file.\n");
-    exit(1);
+    uadecore_exit(1);
   }
 
   /* use the config file provided with a message, if '-config' option
@@ -795,7 +889,7 @@ void uadecore_option(int argc, char **argv)
   if (!cfg_loaded) {
     if (cfgfile_load (&currprefs, optionsfile) == 0) {
       fprintf(stderr, "uadecore: Could not load uaerc (%s).\n", optionsfile);
-      exit(1);
+      uadecore_exit(1);
     }
   }
 
@@ -828,6 +922,7 @@ static void uade_print_help(enum print_help problemcode, char *progname)
   fprintf(stderr, " -h\t\tPrint help\n");
   fprintf(stderr, " -i file\tSet input source ('filename' or 'fd://number')\n");
   fprintf(stderr, " -o file\tSet output destination ('filename' or 'fd://number'\n");
+  fprintf(stderr, " -m fd\t\tRun a machine for each descriptor received from a UNIX socket\n");
   fprintf(stderr, "\n");
   fprintf(stderr, "This tool should not be run from the command line. This is for internal use\n");
   fprintf(stderr, "of other programs.\n");
@@ -872,7 +967,7 @@ void uadecore_reset(void)
   }
   if (highmem < 0x80000) {
     fprintf(stderr, "uadecore: There must be at least 512 KiB of amiga memory (%d bytes found).\n", highmem);
-    exit(1);
+    uadecore_exit(1);
   }
   if (highmem < 0x200000) {
     fprintf(stderr, "uadecore: Warning: highmem == 0x%x (< 0x200000)!\n", highmem);
@@ -883,10 +978,10 @@ void uadecore_reset(void)
 
   ret = uade_receive_string(song.scorename, UADE_COMMAND_SCORE, sizeof(song.scorename), &uadecore_ipc);
   if (ret == 0) {
-    exit(0);
+    uadecore_exit(0);
   } else if (ret < 0) {
     fprintf(stderr, "uadecore: Invalid input. Expected score name.\n");
-    exit(1);
+    uadecore_exit(1);
   }
 
   player = NULL;
@@ -896,7 +991,7 @@ void uadecore_reset(void)
   player = uade_receive_file(&uadecore_ipc);
   if (player == NULL || player->data == NULL) {
 	  fprintf(stderr, "uadecore: Invalid input. Expected player.\n");
-	  exit(1);
+	  uadecore_exit(1);
   }
   if (player->name == NULL) {
 	  strlcpy(song.playername, "no-player-name", sizeof song.playername);
@@ -908,7 +1003,7 @@ void uadecore_reset(void)
   module = uade_receive_file(&uadecore_ipc);
   if (module == NULL) {
 	  fprintf(stderr, "uadecore: Invalid input. Expected module.\n");
-	  exit(1);
+	  uadecore_exit(1);
   }
   if (module->name != NULL)
 	  strlcpy(song.modulename, module->name, sizeof song.modulename);
@@ -1030,20 +1125,23 @@ void uadecore_reset(void)
   uadecore_audio_output = 0;
   uadecore_audio_skip = 0;
 
+  savestate_reset();
+  uadecore_stats_reset();
+
   old_ledstate = gui_ledstate;
 
   if (uade_receive_short_message(UADE_COMMAND_TOKEN, &uadecore_ipc)) {
     fprintf(stderr, "uadecore: Can not receive token in uade_reset().\n");
-    exit(1);
+    uadecore_exit(1);
   }
 
-  if (uade_send_short_message(UADE_REPLY_CAN_PLAY, &uadecore_ipc)) {
+  if (uadecore_send_short_message(UADE_REPLY_CAN_PLAY)) {
     fprintf(stderr, "uadecore: Can not send 'CAN_PLAY' reply.\n");
-    exit(1);
+    uadecore_exit(1);
   }
-  if (uade_send_short_message(UADE_COMMAND_TOKEN, &uadecore_ipc)) {
+  if (uadecore_send_short_message(UADE_COMMAND_TOKEN)) {
     fprintf(stderr, "uadecore: Can not send token from uade_reset().\n");
-    exit(1);
+    uadecore_exit(1);
   }
 
   set_sound_freq(UADE_DEFAULT_FREQUENCY);
@@ -1061,16 +1159,16 @@ void uadecore_reset(void)
 
   if (uade_receive_short_message(UADE_COMMAND_TOKEN, &uadecore_ipc)) {
     fprintf(stderr, "uadecore: Can not receive token in uade_reset().\n");
-    exit(1);
+    uadecore_exit(1);
   }
 
-  if (uade_send_short_message(UADE_REPLY_CANT_PLAY, &uadecore_ipc)) {
+  if (uadecore_send_short_message(UADE_REPLY_CANT_PLAY)) {
     fprintf(stderr, "uadecore: Can not send 'CANT_PLAY' reply.\n");
-    exit(1);
+    uadecore_exit(1);
   }
-  if (uade_send_short_message(UADE_COMMAND_TOKEN, &uadecore_ipc)) {
+  if (uadecore_send_short_message(UADE_COMMAND_TOKEN)) {
     fprintf(stderr, "uadecore: Can not send token from uade_reset().\n");
-    exit(1);
+    uadecore_exit(1);
   }
   goto nextsong;
 }
@@ -1163,6 +1261,24 @@ void uadecore_set_automatic_song_end(int song_end_possible)
 }
 
 
+int uadecore_get_automatic_song_end(void)
+{
+  return amiga_get_u32(SCORE_HAVE_SONGEND);
+}
+
+
+void uadecore_savestate(struct savestate *ss)
+{
+  savestate_var(ss, song.min_subsong);
+  savestate_var(ss, song.max_subsong);
+  savestate_var(ss, song.cur_subsong);
+  savestate_var(ss, uadecore_audio_output);
+  savestate_var(ss, uadecore_audio_skip);
+  savestate_var(ss, uadecore_time_critical);
+  savestate_var(ss, old_ledstate);
+}
+
+
 /* if kill_it is zero, uade may switch to next subsong. if kill_it is non-zero
    uade will always switch to next song (if any) */
 void uadecore_song_end(char *reason, int kill_it)
@@ -1170,14 +1286,15 @@ void uadecore_song_end(char *reason, int kill_it)
   uint8_t space[sizeof(struct uade_msg) + 8 + 256];
   struct uade_msg *um = (struct uade_msg *) space;
   int tailbytes = ((intptr_t) sndbufpt) - ((intptr_t) sndbuffer);
+  paula_trace_flush();
   um->msgtype = UADE_REPLY_SONG_END;
   write_be_u32(um->data, tailbytes);
   write_be_u32(um->data + 4, kill_it);
   strlcpy((char *) um->data + 8, reason, 256);
   um->size = 8 + strlen(reason) + 1;
-  if (uade_send_message(um, &uadecore_ipc)) {
+  if (uadecore_send_message(um)) {
     fprintf(stderr, "uadecore: Could not send song end message.\n");
-    exit(1);
+    uadecore_exit(1);
   }
   /* if audio_output is zero (and thus the client is waiting for the first
      sound data block from this song), then start audio output so that the
@@ -30,13 +30,13 @@
 #include <uade/uadeconstants.h>
 
 
-struct uae_prefs currprefs, changed_prefs;
+MACHINE_LOCAL struct uae_prefs currprefs, changed_prefs;
 
-int no_gui = 0;
-int joystickpresent = 0;
-int cloanto_rom = 0;
+MACHINE_LOCAL int no_gui = 0;
+MACHINE_LOCAL int joystickpresent = 0;
+MACHINE_LOCAL int cloanto_rom = 0;
 
-char warning_buffer[256];
+MACHINE_LOCAL char warning_buffer[256];
 
 /* If you want to pipe printer output to a file, put something like
  * "cat >>printerfile.tmp" above.
@@ -48,7 +48,7 @@ char warning_buffer[256];
  */
 
 /* People must provide their own name for this */
-char sername[256] = "";
+MACHINE_LOCAL char sername[256] = "";
 
 /* Slightly stupid place for this... */
 /* ncurses.c might use quite a few of those. */
@@ -253,7 +253,7 @@ static void fix_options (void)
 	fprintf (stderr, "Please use \"uae -h\" to get usage information.\n");
 }
 
-int quit_program = 0;
+MACHINE_LOCAL int quit_program = 0;
 
 void uae_quit (void)
 {
@@ -312,7 +312,7 @@ int uadecore_main (int argc, char **argv)
     if (! setup_sound ()) {
 	fprintf (stderr, "Sound driver unavailable: Sound output disabled\n");
 	currprefs.produce_sound = 0;
-	exit(1);
+	uadecore_exit(1);
     }
 
     init_sound();
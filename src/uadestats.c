@@ -0,0 +1,153 @@
+/*
+ * Profiling counters for UADE_COMMAND_GET_STATS. See uade_request_stats() in
+ * uade.h.
+ *
+ * Counters are cheap increments in the emulator. Time is measured with the
+ * monotonic clock around IPC and in every 64th update_audio() call, so the
+ * clock is not read in the hot paths.
+ */
+
+#include "sysconfig.h"
+#include "sysdeps.h"
+
+#include "options.h"
+#include "events.h"
+#include "memory.h"
+#include "uadectl.h"
+#include "uadestats.h"
+
+#include <uade/uade.h>
+#include <uade/uadeipc.h>
+#include <uade/uadeutils.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+MACHINE_LOCAL struct uadecore_stats uadecore_stats;
+MACHINE_LOCAL int uadecore_stats_requested;
+
+static MACHINE_LOCAL uint64_t cycles_total;
+static MACHINE_LOCAL unsigned long cycles_last;
+static MACHINE_LOCAL uint64_t start_ns;
+
+uint64_t uadecore_stats_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void uadecore_stats_reset(void)
+{
+	memset(&uadecore_stats, 0, sizeof uadecore_stats);
+	uadecore_stats_requested = 0;
+	memory_reset_accesses();
+	cycles_total = 0;
+	cycles_last = cycles;
+	start_ns = uadecore_stats_ns();
+}
+
+void uadecore_stats_sync_cycles(void)
+{
+	cycles_total += cycles - cycles_last;
+	cycles_last = cycles;
+}
+
+void uadecore_stats_resync_cycles(void)
+{
+	cycles_last = cycles;
+}
+
+static void count_sent(size_t bytes, uint64_t t)
+{
+	uadecore_stats.ipc_messages_sent++;
+	uadecore_stats.ipc_bytes_sent += bytes;
+	uadecore_stats.ipc_ns += uadecore_stats_ns() - t;
+}
+
+int uadecore_send_message(struct uade_msg *um)
+{
+	uint64_t t = uadecore_stats_ns();
+	size_t bytes = sizeof(*um) + um->size;
+	int ret = uade_send_message(um, &uadecore_ipc);
+	count_sent(bytes, t);
+	return ret;
+}
+
+int uadecore_send_short_message(enum uade_msgtype msgtype)
+{
+	uint64_t t = uadecore_stats_ns();
+	int ret = uade_send_short_message(msgtype, &uadecore_ipc);
+	count_sent(sizeof(struct uade_msg), t);
+	return ret;
+}
+
+int uadecore_send_string(enum uade_msgtype msgtype, const char *s)
+{
+	uint64_t t = uadecore_stats_ns();
+	int ret = uade_send_string(msgtype, s, &uadecore_ipc);
+	count_sent(sizeof(struct uade_msg) + strlen(s) + 1, t);
+	return ret;
+}
+
+int uadecore_send_u32(enum uade_msgtype msgtype, uint32_t x)
+{
+	uint64_t t = uadecore_stats_ns();
+	int ret = uade_send_u32(msgtype, x, &uadecore_ipc);
+	count_sent(sizeof(struct uade_msg) + 4, t);
+	return ret;
+}
+
+static uint8_t *put_u64(uint8_t *p, uint64_t x)
+{
+	write_be_u32(p, x >> 32);
+	write_be_u32(p + 4, (uint32_t) x);
+	return p + 8;
+}
+
+void uadecore_stats_send(void)
+{
+	uint8_t space[UADE_MAX_MESSAGE_SIZE];
+	struct uade_msg *um = (struct uade_msg *) space;
+	struct uade_stats s = {.cycles = 0};
+	uint64_t total_ns = uadecore_stats_ns() - start_ns;
+	uint64_t *counters = (uint64_t *) &s;
+	size_t n = sizeof s / sizeof counters[0];
+	uint8_t *p;
+	size_t i;
+
+	uadecore_stats_requested = 0;
+	uadecore_stats_sync_cycles();
+
+	s.cycles = cycles_total;
+	s.instructions = uadecore_stats.instructions;
+	s.paula_events = uadecore_stats.paula_events;
+	s.audio_handler_calls = uadecore_stats.audio_handler_calls;
+	s.audio_frames = uadecore_stats.audio_frames;
+	s.audio_ns = uadecore_stats.audio_ns;
+	s.ipc_ns = uadecore_stats.ipc_ns;
+	if (total_ns > s.audio_ns + s.ipc_ns)
+		s.cpu_ns = total_ns - s.audio_ns - s.ipc_ns;
+	memory_get_accesses(s.bank_accesses);
+
+	/* This message is counted, too */
+	uadecore_stats.ipc_messages_sent++;
+	uadecore_stats.ipc_bytes_sent += sizeof(*um) + 4 + 8 * n;
+	s.ipc_messages_sent = uadecore_stats.ipc_messages_sent;
+	s.ipc_bytes_sent = uadecore_stats.ipc_bytes_sent;
+	s.ipc_messages_received = uadecore_stats.ipc_messages_received;
+	s.ipc_bytes_received = uadecore_stats.ipc_bytes_received;
+
+	um->msgtype = UADE_REPLY_STATS;
+	um->size = 4 + 8 * n;
+	write_be_u32(um->data, n);
+	p = um->data + 4;
+	for (i = 0; i < n; i++)
+		p = put_u64(p, counters[i]);
+	if (uade_send_message(um, &uadecore_ipc)) {
+		fprintf(stderr, "uadecore: Could not send stats.\n");
+		uadecore_exit(1);
+	}
+}
@@ -4,11 +4,16 @@
 #include <uade/uadeipc.h>
 
 #include <assert.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 static char *paula_event_string[] = {
 	"None", "Vol", "Per", "Dat", "Len", "LCL", "LCH", "Loop"};
 
@@ -18,13 +23,50 @@ struct channel_event {
 	uint16_t event_values[PET_MAX_ENUM];
 };
 
+/* Records are collected into blocks of this size before writing */
+#define WRITE_AUDIO_BLOCK_SIZE (1 << 20)
+
+/* Maximum size of an encoded record */
+#define WRITE_AUDIO_MAX_RECORD 32
+
+/* Maximum size of a signed varint of a 16-bit sample */
+#define WRITE_AUDIO_MAX_SAMPLE 3
+
+/*
+ * A LEFT_RIGHT record at offset record in the block buffer. It has space
+ * for the samples at offset samples.
+ */
+struct deferred_left_right {
+	size_t record;
+	size_t samples;
+};
+
 struct uade_write_audio {
 	FILE *f;
 	int output[4];
 	int started;
+	/* Time that has not been written, because outputs did not change */
+	uint64_t pending_tdelta;
 	struct channel_event channel_events[4];
+	size_t bufused;
+	size_t bufsize;
+	uint8_t *buf;
+	/* LEFT_RIGHT records whose samples are written later, in time order */
+	struct deferred_left_right *deferred;
+	size_t ndeferred;
+	size_t maxdeferred;
+#ifdef HAVE_ZLIB
+	uint8_t *zbuf;
+	size_t zbufsize;
+#endif
+	/* Next writer in the list of open writers */
+	struct uade_write_audio *next;
 };
 
+/*
+ * Version 1 (UADE_WRITE_AUDIO_MAGIC_V1) files contain 12 byte frames after
+ * the header. Version 2 is written by this module.
+ */
 struct paula_event_frame {
 	int8_t channel;
 	int8_t event_type;
@@ -44,15 +86,167 @@ struct uade_write_audio_frame {
 	} data;
 } __attribute__((packed));
 
+/*
+ * Version 2 (UADE_WRITE_AUDIO_MAGIC) files contain blocks after the header:
+ *
+ *   u8 block type (enum uade_write_audio_block_type)
+ *   u32 size of records in the block (bigendian)
+ *   u32 size of block data that follows (bigendian)
+ *   block data: records, zlib compressed in UADE_WRITE_AUDIO_BLOCK_ZLIB blocks
+ *
+ * Integers in records are LEB128 varints. Signed values are zigzag coded.
+ * Each record begins with a record type byte (UADE_WRITE_AUDIO_RECORD_*):
+ *
+ *   OUTPUT: varint tdelta, u8 channel mask, and for each channel in the
+ *           mask a signed varint difference to the previous output of the
+ *           channel. Outputs start from zero.
+ *   PAULA_EVENT: varint tdelta, u8 (channel << 4) | event type,
+ *                varint event value.
+ *   LEFT_RIGHT: varint tdelta, signed varints of the left and right output
+ *               samples. This is equivalent to two PET_OUTPUT events.
+ *
+ * Time advances by tdelta before the record takes effect. Channel outputs
+ * that do not change are not written, their time is added to the tdelta
+ * of the next record.
+ */
+
+/*
+ * uadecore exits without closing the files. Each machine of a process has
+ * its own writer, so all open writers are kept in a list and flushed at
+ * exit.
+ */
+static pthread_mutex_t writers_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct uade_write_audio *open_writers;
+static int exit_handler_set;
+
+static void flush_at_exit(void)
+{
+	while (open_writers != NULL)
+		uade_write_audio_close(open_writers);
+}
+
+static void add_writer(struct uade_write_audio *w)
+{
+	pthread_mutex_lock(&writers_lock);
+	if (!exit_handler_set) {
+		atexit(flush_at_exit);
+		exit_handler_set = 1;
+	}
+	w->next = open_writers;
+	open_writers = w;
+	pthread_mutex_unlock(&writers_lock);
+}
+
+static void remove_writer(struct uade_write_audio *w)
+{
+	struct uade_write_audio **p;
+
+	pthread_mutex_lock(&writers_lock);
+	for (p = &open_writers; *p != NULL; p = &(*p)->next) {
+		if (*p == w) {
+			*p = w->next;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&writers_lock);
+}
+
+static uint8_t *put_varint(uint8_t *p, uint64_t x)
+{
+	while (x >= 0x80) {
+		*p++ = (x & 0x7f) | 0x80;
+		x >>= 7;
+	}
+	*p++ = x;
+	return p;
+}
+
+static uint8_t *put_svarint(uint8_t *p, int32_t x)
+{
+	return put_varint(p, ((uint32_t) x << 1) ^ (uint32_t) (x >> 31));
+}
+
+static void flush_block(struct uade_write_audio *w)
+{
+	uint8_t header[UADE_WRITE_AUDIO_BLOCK_HEADER_SIZE];
+	uint8_t *data = w->buf;
+	size_t size = w->bufused;
+
+	if (w->bufused == 0)
+		return;
+
+	header[0] = UADE_WRITE_AUDIO_BLOCK_RAW;
+#ifdef HAVE_ZLIB
+	if (compressBound(w->bufused) > w->zbufsize) {
+		uint8_t *zbuf = realloc(w->zbuf, compressBound(w->bufused));
+		if (zbuf != NULL) {
+			w->zbuf = zbuf;
+			w->zbufsize = compressBound(w->bufused);
+		}
+	}
+	uLongf zsize = w->zbufsize;
+	if (compress2(w->zbuf, &zsize, w->buf, w->bufused, 1) == Z_OK &&
+	    zsize < w->bufused) {
+		header[0] = UADE_WRITE_AUDIO_BLOCK_ZLIB;
+		data = w->zbuf;
+		size = zsize;
+	}
+#endif
+	write_be_u32(&header[1], w->bufused);
+	write_be_u32(&header[5], size);
+
+	if (uade_atomic_fwrite(header, sizeof(header), 1, w->f) != 1 ||
+	    uade_atomic_fwrite(data, size, 1, w->f) != 1)
+		fprintf(stderr, "uade: Unable to write audio block\n");
+
+	w->bufused = 0;
+}
+
+/*
+ * Returns space for a record of at most WRITE_AUDIO_MAX_RECORD bytes.
+ * The block can not be written while it has deferred records, so the
+ * buffer grows past WRITE_AUDIO_BLOCK_SIZE until they are complete.
+ */
+static uint8_t *record_begin(struct uade_write_audio *w)
+{
+	if (w->bufused + WRITE_AUDIO_MAX_RECORD > WRITE_AUDIO_BLOCK_SIZE &&
+	    w->ndeferred == 0)
+		flush_block(w);
+	if (w->bufused + WRITE_AUDIO_MAX_RECORD > w->bufsize) {
+		uint8_t *buf = realloc(w->buf, 2 * w->bufsize);
+		if (buf == NULL) {
+			fprintf(stderr, "uade: Out of memory for audio records\n");
+			abort();
+		}
+		w->buf = buf;
+		w->bufsize *= 2;
+	}
+	return w->buf + w->bufused;
+}
+
+static void record_end(struct uade_write_audio *w, const uint8_t *end)
+{
+	w->bufused = end - w->buf;
+}
+
 struct uade_write_audio *uade_write_audio_init(const char *fname)
 {
-	int i;
 	struct uade_write_audio_header h = {};
 	memcpy(&h.magic, UADE_WRITE_AUDIO_MAGIC, sizeof(h.magic));
 
 	struct uade_write_audio *w = calloc(1, sizeof(*w));
 	if (w == NULL)
 		goto out;
+	w->bufsize = WRITE_AUDIO_BLOCK_SIZE;
+	w->buf = malloc(w->bufsize);
+	if (w->buf == NULL)
+		goto out;
+#ifdef HAVE_ZLIB
+	w->zbufsize = compressBound(WRITE_AUDIO_BLOCK_SIZE);
+	w->zbuf = malloc(w->zbufsize);
+	if (w->zbuf == NULL)
+		goto out;
+#endif
 	w->f = fopen(fname, "wb");
 	if (w->f == NULL) {
 		fprintf(stderr, "error: Can not open %s to write audio\n",
@@ -66,14 +260,17 @@ struct uade_write_audio *uade_write_audio_init(const char *fname)
 		goto out;
 	}
 
-	for (i = 0; i < 4; i++)
-		w->output[i] = 0x7fffffff;
+	add_writer(w);
 
 	return w;
 out:
 	if (w != NULL) {
 		if (w->f != NULL)
 			fclose(w->f);
+		free(w->buf);
+#ifdef HAVE_ZLIB
+		free(w->zbuf);
+#endif
 		memset(w, 0, sizeof(*w));
 		free(w);
 	}
@@ -95,93 +292,154 @@ void uade_write_audio_write(struct uade_write_audio *w, const int output[4],
 			    const unsigned long tdelta)
 {
 	int ch;
-	uint32_t time_to_advance = tdelta;
-	struct uade_write_audio_frame frame;
+	uint64_t time_to_advance = tdelta;
+	uint8_t *p;
+	int mask;
 
 	assert(tdelta <= 0x00ffffff);
 
 	for (ch = 0; ch < 4; ch++) {
 		enum PaulaEventType et;
-
-		struct uade_write_audio_frame paula_frame;
 		struct channel_event *ce = &w->channel_events[ch];
-		struct paula_event_frame *pef = (
-			&paula_frame.data.paula_event_frame);
 
 		for (et = 1 ; et < PET_MAX_ENUM; et++) {
 			if (ce->active_events[et]) {
 				/*
-				 * MSB of tdelta to indicate this is a
-				 * paula event. Zero the time_to_advance later
-				 * not to advance time twice.
+				 * Time advances before the first event.
+				 * Zero the time_to_advance later not to
+				 * advance time twice.
 				 */
-				write_be_u32(
-					&paula_frame.tdelta,
-					(uint32_t) (time_to_advance |
-						    0x80000000));
+				p = record_begin(w);
+				*p++ = UADE_WRITE_AUDIO_RECORD_PAULA_EVENT;
+				p = put_varint(p, w->pending_tdelta +
+					       time_to_advance);
+				*p++ = (ch << 4) | et;
+				p = put_varint(p, ce->event_values[et]);
+				record_end(w, p);
+				w->pending_tdelta = 0;
 				time_to_advance = 0;
-
-				pef->channel = ch;
-				pef->event_type = et;
-				write_be_u16(&pef->event_value,
-					     ce->event_values[et]);
-
-				if (uade_atomic_fwrite(&paula_frame,
-						       sizeof(paula_frame),
-						       1, w->f) != 1) {
-					fprintf(stderr,
-						"error: Unable to write paula "
-						"event frame\n");
-				}
 			}
 		}
 	}
 
 	memset(w->channel_events, 0, sizeof(w->channel_events));
 
-	/* Note: time_to_advance may be zeroed in paula loop */
-	write_be_u32(&frame.tdelta, (uint32_t) time_to_advance);
-
+	mask = 0;
 	for (ch = 0; ch < 4; ch++) {
 		if (!w->started && output[ch] != 0)
 			w->started = 1;
+		if (output[ch] != w->output[ch])
+			mask |= 1 << ch;
+	}
 
-		write_be_s16(&frame.data.output[ch], output[ch]);
+	if (!w->started)
+		return;
+
+	if (mask == 0) {
+		w->pending_tdelta += time_to_advance;
+		return;
 	}
 
-	if (w->started) {
-		if (uade_atomic_fwrite(&frame, sizeof(frame), 1, w->f) != 1)
-			fprintf(stderr, "uade: Unable to write audio frame\n");
+	/* Note: time_to_advance may be zeroed in paula loop */
+	p = record_begin(w);
+	*p++ = UADE_WRITE_AUDIO_RECORD_OUTPUT;
+	p = put_varint(p, w->pending_tdelta + time_to_advance);
+	*p++ = mask;
+	for (ch = 0; ch < 4; ch++) {
+		if (mask & (1 << ch)) {
+			p = put_svarint(p, output[ch] - w->output[ch]);
+			w->output[ch] = output[ch];
+		}
 	}
+	record_end(w, p);
+	w->pending_tdelta = 0;
 }
 
-void uade_write_audio_write_left_right(
-	struct uade_write_audio *w, const int left, const int right)
+void uade_write_audio_defer_left_right(struct uade_write_audio *w)
 {
-	struct uade_write_audio_frame frame;
-	struct paula_event_frame *pef = &frame.data.paula_event_frame;
+	struct deferred_left_right *d;
+	uint8_t *p;
 
 	if (!w->started)
 		return;
 
-	write_be_u32(&frame.tdelta, 0x80000000);
-	pef->channel = 0;
-	pef->event_type = PET_OUTPUT;
-	write_be_u16(&pef->event_value, left);
-	if (uade_atomic_fwrite(&frame, sizeof(frame), 1, w->f) != 1) {
-		fprintf(stderr,	"error: Unable to write paula event frame\n");
+	if (w->ndeferred == w->maxdeferred) {
+		size_t n = w->maxdeferred ? 2 * w->maxdeferred : 1024;
+		d = realloc(w->deferred, n * sizeof(d[0]));
+		if (d == NULL) {
+			fprintf(stderr, "uade: Out of memory for audio records\n");
+			abort();
+		}
+		w->deferred = d;
+		w->maxdeferred = n;
 	}
-	pef->channel = 1;
-	write_be_u16(&pef->event_value, right);
-	if (uade_atomic_fwrite(&frame, sizeof(frame), 1, w->f) != 1) {
-		fprintf(stderr,	"error: Unable to write paula event frame\n");
+
+	p = record_begin(w);
+	d = &w->deferred[w->ndeferred++];
+	d->record = p - w->buf;
+	*p++ = UADE_WRITE_AUDIO_RECORD_LEFT_RIGHT;
+	p = put_varint(p, w->pending_tdelta);
+	d->samples = p - w->buf;
+	record_end(w, p + 2 * WRITE_AUDIO_MAX_SAMPLE);
+	w->pending_tdelta = 0;
+}
+
+/*
+ * Writes the samples of the deferred records from the last ndeferred
+ * frames of samples, and packs the records to their encoded size.
+ */
+void uade_write_audio_complete_left_right(
+	struct uade_write_audio *w, const int16_t *samples, size_t frames)
+{
+	uint8_t *dst;
+	size_t i;
+
+	if (w->ndeferred == 0)
+		return;
+
+	assert(frames >= w->ndeferred);
+	samples += 2 * (frames - w->ndeferred);
+
+	dst = w->buf + w->deferred[0].samples;
+	for (i = 0; i < w->ndeferred; i++) {
+		const struct deferred_left_right *d = &w->deferred[i];
+		size_t next = i + 1 < w->ndeferred ?
+			w->deferred[i + 1].samples : w->bufused;
+		const uint8_t *src = w->buf + d->samples +
+			2 * WRITE_AUDIO_MAX_SAMPLE;
+		size_t tail = w->buf + next - src;
+
+		dst = put_svarint(dst, samples[2 * i]);
+		dst = put_svarint(dst, samples[2 * i + 1]);
+		/* The rest of the record and the records up to the next
+		   deferred record */
+		memmove(dst, src, tail);
+		dst += tail;
 	}
+	w->bufused = dst - w->buf;
+	w->ndeferred = 0;
 }
 
 void uade_write_audio_close(struct uade_write_audio *w)
 {
 	if (w == NULL)
 		return;
+	remove_writer(w);
+	/*
+	 * The samples of deferred records were never computed, e.g. because
+	 * uadecore exits. The trace ends before the first of them.
+	 */
+	if (w->ndeferred > 0) {
+		w->bufused = w->deferred[0].record;
+		w->ndeferred = 0;
+	}
+	flush_block(w);
 	fclose(w->f);
+	free(w->buf);
+	free(w->deferred);
+#ifdef HAVE_ZLIB
+	free(w->zbuf);
+#endif
 	memset(w, 0, sizeof(*w));
+	free(w);
 }
@@ -0,0 +1,85 @@
+#!/bin/bash
+#
+# Renders every file in a directory with two uade123 executables and checks
+# that the PCM output is bit-identical. Use this to verify that emulator
+# optimizations do not change the audio.
+#
+# Extra uade123 arguments can be given after the directory, e.g.
+# --resampler=sinc or --filter=a1200.
+#
+# TOLERANCE=n accepts outputs whose 16-bit samples differ by at most n,
+# e.g. TOLERANCE=1 for changes that only affect float rounding.
+
+uade123_org=${1}
+uade123_mod=${2}
+mod_dir=${3}
+if [[ -z "${mod_dir}" ]] ; then
+    echo "Usage: $0 uade123exenotmodified uade123exemodified moddir [uade123 args...]"
+    exit 1
+fi
+shift 3
+if [[ ! -x "${uade123_org}" ]] ; then
+    echo "${uade123_org} is not executable"
+    exit 1
+fi
+if [[ ! -x "${uade123_mod}" ]] ; then
+    echo "${uade123_mod} is not executable"
+    exit 1
+fi
+if [[ ! -d "${mod_dir}" ]] ; then
+    echo "${mod_dir} is not a directory"
+    exit 1
+fi
+
+timeout=${TIMEOUT:-60}
+tolerance=${TOLERANCE:-0}
+
+# render uade123 outputfile args... prints the wall clock time in seconds
+render() {
+    local exe=${1}
+    local out=${2}
+    shift 2
+    local start=$(date +%s.%N)
+    "${exe}" -t "${timeout}" -e raw -f "${out}" "$@" >/dev/null 2>&1
+    local end=$(date +%s.%N)
+    echo "${start} ${end}" |awk '{printf "%.2f", $2 - $1}'
+}
+
+# max_difference file1 file2 prints the largest difference of 16-bit samples
+max_difference() {
+    paste -d ' ' <(od -An -v -t d2 "${1}") <(od -An -v -t d2 "${2}") |awk '
+	{ n = NF / 2
+	  for (i = 1; i <= n; i++) {
+	      d = $i - $(i + n)
+	      if (d < 0) d = -d
+	      if (d > m) m = d
+	  } }
+	END { print m + 0 }'
+}
+
+out_org=$(mktemp)
+out_mod=$(mktemp)
+nfiles=0
+nfailed=0
+
+while IFS= read -r -d '' song ; do
+    nfiles=$((nfiles + 1))
+    time_org=$(render "${uade123_org}" "${out_org}" "$@" "${song}")
+    time_mod=$(render "${uade123_mod}" "${out_mod}" "$@" "${song}")
+    if cmp -s "${out_org}" "${out_mod}" ; then
+	echo "SAME ${time_org}s ${time_mod}s ${song}"
+    elif [[ ${tolerance} -gt 0 &&
+	    $(wc -c < "${out_org}") -eq $(wc -c < "${out_mod}") &&
+	    $(max_difference "${out_org}" "${out_mod}") -le ${tolerance} ]] ; then
+	echo "NEAR ${time_org}s ${time_mod}s ${song}"
+    else
+	echo "DIFF ${time_org}s ${time_mod}s ${song}"
+	nfailed=$((nfailed + 1))
+    fi
+done < <(find "${mod_dir}" -type f -print0 | sort -z)
+
+rm -f "${out_org}" "${out_mod}"
+
+echo
+echo "${nfailed} of ${nfiles} files differ"
+[[ ${nfailed} -eq 0 ]]
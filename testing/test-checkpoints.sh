@@ -0,0 +1,64 @@
+#!/bin/bash
+#
+# Checks that a seek that restores an RMC checkpoint produces exactly the
+# linear output from the seek position on. The RMC file is created and
+# checkpointed with uadermc, which is looked up next to uade123 in the
+# build tree.
+#
+# Run from the top of the source tree after building it, e.g.
+# "make test", or give the uade123 executable as an argument.
+
+uade123=${1:-src/frontends/uade123/uade123}
+if [[ ! -x "${uade123}" ]] ; then
+    echo "${uade123} is not executable"
+    exit 1
+fi
+uadermc=$(dirname "${uade123}")/../uadermc/uadermc
+if [[ ! -x "${uadermc}" ]] ; then
+    echo "${uadermc} is not executable"
+    exit 1
+fi
+
+timeout=46
+frequency=44100
+coreargs=(--basedir=. -u src/uadecore -S amigasrc/score/score)
+
+tmpdir=$(mktemp -d)
+trap 'rm -rf "${tmpdir}"' EXIT
+
+cp songs/AHX.Cruisin "${tmpdir}/" || exit 1
+song=${tmpdir}/AHX.Cruisin.rmc
+"${uadermc}" "${coreargs[@]}" "${tmpdir}/AHX.Cruisin" >/dev/null 2>&1 &&
+    "${uadermc}" "${coreargs[@]}" --checkpoints=5 "${song}" >/dev/null 2>&1 ||
+    { echo "FAIL: uadermc" ; exit 1 ; }
+
+render() {
+    local out=${1}
+    shift
+    "${uade123}" "${coreargs[@]}" -t "${timeout}" \
+        --frequency="${frequency}" -e raw -f "${out}" "$@" "${song}" \
+        >/dev/null 2>"${tmpdir}/stderr"
+}
+
+render "${tmpdir}/linear.raw" ||
+    { echo "FAIL: linear render" ; exit 1 ; }
+
+nfailed=0
+for pos in 15 20.3 25 30.5 35 41 ; do
+    render "${tmpdir}/seek.raw" --jump="${pos}" -v
+    offset=$(awk -v p="${pos}" -v f="${frequency}" \
+        'BEGIN { printf "%d", int(p * f) * 4 }')
+    if ! grep -q "Restored the checkpoint" "${tmpdir}/stderr" ; then
+        echo "FAIL: --jump=${pos} did not restore a checkpoint"
+        nfailed=$((nfailed + 1))
+    elif tail -c +$((offset + 1)) "${tmpdir}/linear.raw" |cmp -s - "${tmpdir}/seek.raw" ; then
+        echo "OK: --jump=${pos}"
+    else
+        echo "FAIL: --jump=${pos} differs from the linear output"
+        nfailed=$((nfailed + 1))
+    fi
+done
+
+if [[ ${nfailed} -gt 0 ]] ; then
+    exit 1
+fi
@@ -0,0 +1,66 @@
+#!/bin/bash
+#
+# Checks the A500, A500 with the LED on and A1200 filter models against
+# reference renders in testing/reference. The references are the first
+# second of songs/AHX.Cruisin at 44.1 kHz, rendered with the per-sample
+# filters that preceded the block filters, so that float rounding of the
+# filters may change each 16-bit sample by at most 1.
+#
+# Run from the top of the source tree after building it, e.g.
+# "make test", or give the uade123 executable as an argument.
+
+uade123=${1:-src/frontends/uade123/uade123}
+if [[ ! -x "${uade123}" ]] ; then
+    echo "${uade123} is not executable"
+    exit 1
+fi
+
+tolerance=1
+coreargs=(--basedir=. -u src/uadecore -S amigasrc/score/score)
+
+tmpdir=$(mktemp -d)
+trap 'rm -rf "${tmpdir}"' EXIT
+
+# max_difference file1 file2 prints the largest difference of 16-bit samples
+max_difference() {
+    paste -d ' ' <(od -An -v -t d2 "${1}") <(od -An -v -t d2 "${2}") |awk '
+	{ n = NF / 2
+	  for (i = 1; i <= n; i++) {
+	      d = $i - $(i + n)
+	      if (d < 0) d = -d
+	      if (d > m) m = d
+	  } }
+	END { print m + 0 }'
+}
+
+nfailed=0
+for model in a500 a500-led a1200 ; do
+    args=(--filter="${model%-led}")
+    if [[ ${model} == *-led ]] ; then
+	args+=(--force-led=1)
+    fi
+    reference=testing/reference/AHX.Cruisin.${model}.raw.gz
+    gzip -dc "${reference}" > "${tmpdir}/reference.raw" ||
+	{ echo "FAIL: can not read ${reference}" ; exit 1 ; }
+    "${uade123}" "${coreargs[@]}" -t 1 --frequency=44100 "${args[@]}" \
+	-e raw -f "${tmpdir}/out.raw" songs/AHX.Cruisin >/dev/null 2>&1 ||
+	{ echo "FAIL: ${model} render" ; exit 1 ; }
+
+    if [[ $(wc -c < "${tmpdir}/out.raw") -ne \
+	  $(wc -c < "${tmpdir}/reference.raw") ]] ; then
+	echo "FAIL: ${model} output length differs from the reference"
+	nfailed=$((nfailed + 1))
+	continue
+    fi
+    difference=$(max_difference "${tmpdir}/out.raw" "${tmpdir}/reference.raw")
+    if [[ ${difference} -le ${tolerance} ]] ; then
+	echo "OK: ${model} (largest difference ${difference})"
+    else
+	echo "FAIL: ${model} differs from the reference by ${difference}"
+	nfailed=$((nfailed + 1))
+    fi
+done
+
+if [[ ${nfailed} -gt 0 ]] ; then
+    exit 1
+fi
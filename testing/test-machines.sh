@@ -0,0 +1,54 @@
+#!/bin/bash
+#
+# Checks that machines that run in parallel in one uadecore process do not
+# affect each other. Two songs are converted and checkpointed with
+# "uadermc -j 2 --machines", and the RMC files must equal the ones that
+# separate uadecore processes produce one song at a time. Checkpoints are
+# snapshots of the whole machine, so any state that leaks between machines
+# shows up in them.
+#
+# Run from the top of the source tree after building it, e.g.
+# "make test", or give the uade123 executable as an argument.
+
+uade123=${1:-src/frontends/uade123/uade123}
+uadermc=$(dirname "${uade123}")/../uadermc/uadermc
+if [[ ! -x "${uadermc}" ]] ; then
+    echo "${uadermc} is not executable"
+    exit 1
+fi
+
+coreargs=(--basedir=. -u src/uadecore -S amigasrc/score/score)
+
+tmpdir=$(mktemp -d)
+trap 'rm -rf "${tmpdir}"' EXIT
+
+convert() {
+    local dir=${1}
+    shift
+    mkdir "${tmpdir}/${dir}" || exit 1
+    cp songs/AHX.Cruisin "${tmpdir}/${dir}/a.ahx" || exit 1
+    cp songs/AHX.Cruisin "${tmpdir}/${dir}/b.ahx" || exit 1
+    "${uadermc}" "${coreargs[@]}" "$@" \
+        "${tmpdir}/${dir}/a.ahx" "${tmpdir}/${dir}/b.ahx" >/dev/null 2>&1 &&
+        "${uadermc}" "${coreargs[@]}" "$@" --checkpoints=5 \
+            "${tmpdir}/${dir}/a.ahx.rmc" "${tmpdir}/${dir}/b.ahx.rmc" \
+            >/dev/null 2>&1
+}
+
+convert solo -j 1 || { echo "FAIL: solo uadermc" ; exit 1 ; }
+convert machines -j 2 --machines ||
+    { echo "FAIL: uadermc --machines" ; exit 1 ; }
+
+nfailed=0
+for song in a.ahx.rmc b.ahx.rmc ; do
+    if cmp -s "${tmpdir}/solo/${song}" "${tmpdir}/machines/${song}" ; then
+        echo "OK: ${song}"
+    else
+        echo "FAIL: ${song} differs from the solo render"
+        nfailed=$((nfailed + 1))
+    fi
+done
+
+if [[ ${nfailed} -gt 0 ]] ; then
+    exit 1
+fi
@@ -0,0 +1,62 @@
+#!/bin/bash
+#
+# Checks that uade123 --jump output is the linear output from the jump
+# position on. A song relative seek to x seconds must start at sample frame
+# floor(x * frequency). A seek past the song end must produce no audio.
+# The timeout counts from the song start, not from the jump position.
+#
+# Run from the top of the source tree after building it, e.g.
+# "make test", or give the uade123 executable as an argument.
+
+uade123=${1:-src/frontends/uade123/uade123}
+if [[ ! -x "${uade123}" ]] ; then
+    echo "${uade123} is not executable"
+    exit 1
+fi
+
+song=songs/AHX.Cruisin
+timeout=20
+frequency=44100
+
+tmpdir=$(mktemp -d)
+trap 'rm -rf "${tmpdir}"' EXIT
+
+render() {
+    local out=${1}
+    shift
+    "${uade123}" --basedir=. -P players/AbyssHighestExperience \
+        -u src/uadecore -S amigasrc/score/score -t "${timeout}" \
+        --frequency="${frequency}" -e raw -f "${out}" "$@" "${song}" \
+        >/dev/null 2>&1
+}
+
+render "${tmpdir}/linear.raw" || { echo "FAIL: linear render" ; exit 1 ; }
+linearsize=$(stat -c %s "${tmpdir}/linear.raw")
+
+nfailed=0
+# 0.005 is inside the first data chunk that uade_play() requests
+for pos in 0.005 5.5 12.345 ; do
+    render "${tmpdir}/seek.raw" --jump="${pos}"
+    offset=$(awk -v p="${pos}" -v f="${frequency}" \
+        'BEGIN { printf "%d", int(p * f) * 4 }')
+    if tail -c +$((offset + 1)) "${tmpdir}/linear.raw" |cmp -s - "${tmpdir}/seek.raw" ; then
+        echo "OK: --jump=${pos}"
+    else
+        echo "FAIL: --jump=${pos} does not start at byte ${offset}"
+        nfailed=$((nfailed + 1))
+    fi
+done
+
+# The song is about 95 seconds long
+timeout=120
+render "${tmpdir}/seek.raw" --jump=100
+if [[ -s "${tmpdir}/seek.raw" ]] ; then
+    echo "FAIL: --jump=100 is past the song end but produced audio"
+    nfailed=$((nfailed + 1))
+else
+    echo "OK: --jump=100"
+fi
+
+if [[ ${nfailed} -gt 0 ]] ; then
+    exit 1
+fi